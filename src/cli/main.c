@@ -41,7 +41,9 @@
 #include "control/conf.h"
 #include "develop/imageop.h"
 
+#include <gio/gio.h>
 #include <inttypes.h>
+#include <json-glib/json-glib.h>
 #include <libintl.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -62,6 +64,7 @@
 static void usage(const char *progname)
 {
   fprintf(stderr, "usage: %s [<input file or dir>] [<xmp file>] <output destination> [options] [--core <darktable options>]\n", progname);
+  fprintf(stderr, "       %s --server [--port <port>] [--jobs <n>] [--core <darktable options>]\n", progname);
   fprintf(stderr, "\n");
   fprintf(stderr, "options:\n");
   fprintf(stderr, "   --width <max width> default: 0 = full resolution\n");
@@ -83,6 +86,10 @@ static void usage(const char *progname)
   fprintf(stderr, "   --icc-file <file> specify icc filename, default to NONE\n");
   fprintf(stderr, "   --icc-intent <intent> specify icc intent, default to LAST\n");
   fprintf(stderr, "                     use --help icc-intent for list of supported intents\n");
+  fprintf(stderr, "   --server               read export jobs as json lines from stdin or --port\n");
+  fprintf(stderr, "                          and keep darktable initialized between them\n");
+  fprintf(stderr, "   --port <port>          with --server, listen on this port of 127.0.0.1\n");
+  fprintf(stderr, "   --jobs <n>             with --server, number of concurrent jobs, default: 1\n");
   fprintf(stderr, "   --verbose\n");
   fprintf(stderr, "   --help,-h [option]\n");
   fprintf(stderr, "   --version\n");
@@ -175,6 +182,539 @@ static dt_iop_color_intent_t get_icc_intent(const char* option)
 }
 #undef ICC_INTENT_FROM_STR
 
+/* server mode: keep darktable initialized and export the jobs read as json lines from stdin or a local tcp port.
+ * every job is an object like
+ *   { "id": 1, "input": "a.cr2", "xmp": "a.cr2.xmp", "output": "out/$(FILE_NAME)", "format": "jpg",
+ *     "width": 2048, "height": 0, "hq": true, "upscale": false, "export_masks": false,
+ *     "style": "...", "style_overwrite": false, "icc_type": "SRGB", "icc_file": "...", "icc_intent": "PERCEPTUAL",
+ *     "conf": { "plugins/imageio/format/jpeg/quality": 90 } }
+ * where only input and output are mandatory. "conf" entries are set while the job reads its format and storage
+ * parameters and reverted afterwards. every job is answered by one line with its id, status and timings. { "command": "quit" } stops the
+ * server.
+ */
+
+typedef struct dt_cli_client_t
+{
+  GOutputStream *out; // NULL replies on file
+  FILE *file;
+  GMutex lock;
+  GCond done;
+  int pending;
+} dt_cli_client_t;
+
+typedef struct dt_cli_job_t
+{
+  dt_cli_client_t *client;
+  gchar *line;
+  gint64 received;
+} dt_cli_job_t;
+
+typedef struct dt_cli_server_t
+{
+  GAsyncQueue *queue;
+  // import, xmp and the export setup run one job at a time, only the processing itself runs concurrently
+  GMutex setup_lock;
+  GCond input_free;
+  GHashTable *busy_inputs; // input files of the jobs in flight, they are removed from the library afterwards
+  gboolean quit;
+} dt_cli_server_t;
+
+// pushed once per worker to stop it
+static dt_cli_job_t _server_stop_job;
+
+static const gchar *_server_get_string(JsonObject *o, const char *name)
+{
+  JsonNode *node = json_object_get_member(o, name);
+  if(!node || !JSON_NODE_HOLDS_VALUE(node) || json_node_get_value_type(node) != G_TYPE_STRING) return NULL;
+  return json_node_get_string(node);
+}
+
+static int _server_get_int(JsonObject *o, const char *name, const int def)
+{
+  JsonNode *node = json_object_get_member(o, name);
+  if(!node || !JSON_NODE_HOLDS_VALUE(node) || json_node_get_value_type(node) == G_TYPE_STRING) return def;
+  return MAX((int)json_node_get_int(node), 0);
+}
+
+static gboolean _server_get_bool(JsonObject *o, const char *name, const gboolean def)
+{
+  JsonNode *node = json_object_get_member(o, name);
+  if(!node || !JSON_NODE_HOLDS_VALUE(node) || json_node_get_value_type(node) == G_TYPE_STRING) return def;
+  if(json_node_get_value_type(node) == G_TYPE_BOOLEAN) return json_node_get_boolean(node);
+  return json_node_get_int(node) != 0;
+}
+
+// the conf entries of a job only last till its parameters are read, so they neither leak into the next job nor
+// end up in darktablerc. user_data collects the previous values as dt_conf_string_entry_t, NULL when unset
+static void _server_set_conf(JsonObject *o, const gchar *name, JsonNode *node, gpointer user_data)
+{
+  if(!JSON_NODE_HOLDS_VALUE(node)) return;
+  GList **saved = (GList **)user_data;
+  dt_conf_string_entry_t *entry = g_malloc(sizeof(dt_conf_string_entry_t));
+  entry->key = g_strdup(name);
+  dt_pthread_mutex_lock(&darktable.conf->mutex);
+  entry->value = g_strdup(g_hash_table_lookup(darktable.conf->table, name));
+  dt_pthread_mutex_unlock(&darktable.conf->mutex);
+  *saved = g_list_prepend(*saved, entry);
+
+  const GType type = json_node_get_value_type(node);
+  if(type == G_TYPE_STRING)
+    dt_conf_set_string(name, json_node_get_string(node));
+  else if(type == G_TYPE_BOOLEAN)
+    dt_conf_set_bool(name, json_node_get_boolean(node));
+  else if(type == G_TYPE_DOUBLE)
+    dt_conf_set_float(name, json_node_get_double(node));
+  else
+    dt_conf_set_int(name, json_node_get_int(node));
+}
+
+// undo _server_set_conf(), latest first so a key given twice gets its original value back
+static void _server_restore_conf(GList *saved)
+{
+  dt_pthread_mutex_lock(&darktable.conf->mutex);
+  for(GList *iter = saved; iter; iter = g_list_next(iter))
+  {
+    dt_conf_string_entry_t *entry = (dt_conf_string_entry_t *)iter->data;
+    if(entry->value)
+      g_hash_table_insert(darktable.conf->table, g_strdup(entry->key), g_strdup(entry->value));
+    else
+      g_hash_table_remove(darktable.conf->table, entry->key);
+  }
+  dt_pthread_mutex_unlock(&darktable.conf->mutex);
+  g_list_free_full(saved, dt_conf_string_entry_free);
+}
+
+static void _server_reply(dt_cli_client_t *client, JsonBuilder *builder)
+{
+  JsonGenerator *generator = json_generator_new();
+  JsonNode *root = json_builder_get_root(builder);
+  json_generator_set_root(generator, root);
+  gchar *reply = json_generator_to_data(generator, NULL);
+  json_node_free(root);
+  g_object_unref(generator);
+
+  g_mutex_lock(&client->lock);
+  if(client->out)
+  {
+    g_output_stream_write_all(client->out, reply, strlen(reply), NULL, NULL, NULL);
+    g_output_stream_write_all(client->out, "\n", 1, NULL, NULL, NULL);
+    g_output_stream_flush(client->out, NULL, NULL);
+  }
+  else
+  {
+    fprintf(client->file, "%s\n", reply);
+    fflush(client->file);
+  }
+  g_mutex_unlock(&client->lock);
+  g_free(reply);
+}
+
+// returns NULL on success, or an error message
+static gchar *_server_export(dt_cli_server_t *server, JsonObject *o, gint64 *import_time)
+{
+  const gchar *input = _server_get_string(o, "input");
+  const gchar *xmp = _server_get_string(o, "xmp");
+  const gchar *output = _server_get_string(o, "output");
+  if(!input || !output) return g_strdup("input and output are mandatory");
+  if(!g_file_test(input, G_FILE_TEST_IS_REGULAR)) return g_strdup_printf("can't open file %s", input);
+
+  dt_colorspaces_color_profile_type_t icc_type = DT_COLORSPACE_NONE;
+  dt_iop_color_intent_t icc_intent = DT_INTENT_LAST;
+  const gchar *icc_filename = _server_get_string(o, "icc_file");
+  if(_server_get_string(o, "icc_type"))
+  {
+    gchar *str = g_ascii_strup(_server_get_string(o, "icc_type"), -1);
+    icc_type = get_icc_type(str);
+    g_free(str);
+    if(icc_type >= DT_COLORSPACE_LAST) return g_strdup("incorrect icc_type");
+  }
+  if(_server_get_string(o, "icc_intent"))
+  {
+    gchar *str = g_ascii_strup(_server_get_string(o, "icc_intent"), -1);
+    icc_intent = get_icc_intent(str);
+    g_free(str);
+    if(icc_intent >= DT_INTENT_LAST) return g_strdup("incorrect icc_intent");
+  }
+
+  // the disk storage appends the extension itself, so split it off the output as the one-shot mode does
+  gchar *output_filename = g_strdup(output);
+  gchar *output_ext = NULL;
+  if(_server_get_string(o, "format"))
+  {
+    const gchar *format = _server_get_string(o, "format");
+    output_ext = g_strdup(format[0] == '.' ? format + 1 : format);
+  }
+  if(g_file_test(output_filename, G_FILE_TEST_IS_DIR))
+  {
+    if(g_str_has_suffix(output_filename, "/")) output_filename[strlen(output_filename) - 1] = '\0';
+    gchar *pattern = g_strconcat(output_filename, "/$(FILE_NAME)", NULL);
+    g_free(output_filename);
+    output_filename = pattern;
+    if(!output_ext) output_ext = g_strdup("jpg");
+  }
+  else
+  {
+    char *ext = strrchr(output_filename, '.');
+    if(!output_ext && ext && strlen(ext) > 1 && strlen(ext) <= DT_MAX_OUTPUT_EXT_LENGTH + 1 && !strchr(ext, '/'))
+      output_ext = g_strdup(ext + 1);
+    if(ext && output_ext && !strcmp(ext + 1, output_ext)) *ext = '\0';
+  }
+  if(!output_ext)
+  {
+    g_free(output_filename);
+    return g_strdup("no output file extension given");
+  }
+  if(!strcmp(output_ext, "jpg") || !strcmp(output_ext, "tif"))
+  {
+    gchar *ext = g_strdup(!strcmp(output_ext, "jpg") ? "jpeg" : "tiff");
+    g_free(output_ext);
+    output_ext = ext;
+  }
+
+  gchar *err = NULL;
+  int32_t id = 0;
+  dt_imageio_module_format_t *format = NULL;
+  dt_imageio_module_storage_t *storage = NULL;
+  dt_imageio_module_data_t *sdata = NULL, *fdata = NULL;
+  GList *saved_conf = NULL;
+  const gboolean high_quality = _server_get_bool(o, "hq", TRUE);
+  const gboolean upscale = _server_get_bool(o, "upscale", FALSE);
+
+  g_mutex_lock(&server->setup_lock);
+
+  // the same file exported twice at once would share one library entry and history, wait for the other job
+  while(g_hash_table_contains(server->busy_inputs, input)) g_cond_wait(&server->input_free, &server->setup_lock);
+  g_hash_table_add(server->busy_inputs, g_strdup(input));
+
+  dt_film_t film;
+  dt_film_init(&film);
+  gchar *directory = g_path_get_dirname(input);
+  const int filmid = dt_film_new(&film, directory);
+  g_free(directory);
+  id = filmid > 0 ? dt_image_import(filmid, input, TRUE, TRUE) : 0;
+  if(!id)
+  {
+    err = g_strdup_printf("can't open file %s", input);
+    goto setup_done;
+  }
+
+  if(xmp)
+  {
+    dt_image_t *image = dt_image_cache_get(darktable.image_cache, id, 'w');
+    const int xmp_failed = dt_exif_xmp_read(image, xmp, 1);
+    // don't write new xmp:
+    dt_image_cache_write_release(darktable.image_cache, image, DT_IMAGE_CACHE_RELAXED);
+    if(xmp_failed)
+    {
+      err = g_strdup_printf("can't open xmp file %s", xmp);
+      goto setup_done;
+    }
+  }
+
+  JsonNode *conf = json_object_get_member(o, "conf");
+  if(conf && JSON_NODE_HOLDS_OBJECT(conf))
+    json_object_foreach_member(json_node_get_object(conf), _server_set_conf, &saved_conf);
+
+  storage = dt_imageio_get_storage_by_name("disk");
+  format = dt_imageio_get_format_by_name(output_ext);
+  if(!storage || !format)
+  {
+    err = storage ? g_strdup_printf("unknown extension '.%s'", output_ext)
+                  : g_strdup("cannot find disk storage module");
+    goto setup_done;
+  }
+  sdata = storage->get_params(storage);
+  fdata = format->get_params(format);
+  if(!sdata || !fdata)
+  {
+    err = g_strdup("failed to get export parameters");
+    goto setup_done;
+  }
+  g_strlcpy((char *)sdata, output_filename, DT_MAX_PATH_FOR_PARAMS);
+
+  uint32_t w, h, fw, fh, sw, sh;
+  fw = fh = sw = sh = 0;
+  storage->dimension(storage, sdata, &sw, &sh);
+  format->dimension(format, fdata, &fw, &fh);
+  w = (sw == 0 || fw == 0) ? MAX(sw, fw) : MIN(sw, fw);
+  h = (sh == 0 || fh == 0) ? MAX(sh, fh) : MIN(sh, fh);
+
+  fdata->max_width = _server_get_int(o, "width", 0);
+  fdata->max_height = _server_get_int(o, "height", 0);
+  fdata->max_width = (w != 0 && fdata->max_width > w) ? w : fdata->max_width;
+  fdata->max_height = (h != 0 && fdata->max_height > h) ? h : fdata->max_height;
+  fdata->style[0] = '\0';
+  fdata->style_append = !_server_get_bool(o, "style_overwrite", FALSE);
+  if(_server_get_string(o, "style"))
+    g_strlcpy((char *)fdata->style, _server_get_string(o, "style"), DT_MAX_STYLE_NAME_LENGTH);
+
+  if(storage->initialize_store)
+  {
+    GList *id_list = g_list_append(NULL, GINT_TO_POINTER(id));
+    storage->initialize_store(storage, sdata, &format, &fdata, &id_list, high_quality, upscale);
+    format->set_params(format, fdata, format->params_size(format));
+    storage->set_params(storage, sdata, storage->params_size(storage));
+    g_list_free(id_list);
+  }
+
+setup_done:
+  _server_restore_conf(saved_conf);
+  dt_film_cleanup(&film);
+  g_mutex_unlock(&server->setup_lock);
+  *import_time = g_get_monotonic_time();
+
+  if(!err)
+  {
+    dt_export_metadata_t metadata;
+    metadata.flags = dt_lib_export_metadata_default_flags();
+    metadata.list = NULL;
+    if(storage->store(storage, sdata, id, format, fdata, 1, 1, high_quality, upscale,
+                      _server_get_bool(o, "export_masks", FALSE), icc_type, icc_filename, icc_intent,
+                      &metadata) != 0)
+      err = g_strdup("export failed");
+    if(storage->finalize_store) storage->finalize_store(storage, sdata);
+  }
+  if(sdata) storage->free_params(storage, sdata);
+  if(fdata) format->free_params(format, fdata);
+
+  // keep the in-memory library small, the next job for this file imports it afresh
+  g_mutex_lock(&server->setup_lock);
+  if(id) dt_image_remove(id);
+  g_hash_table_remove(server->busy_inputs, input);
+  g_cond_broadcast(&server->input_free);
+  g_mutex_unlock(&server->setup_lock);
+
+  g_free(output_filename);
+  g_free(output_ext);
+  return err;
+}
+
+static void _server_run_job(dt_cli_server_t *server, dt_cli_job_t *job)
+{
+  const gint64 start = g_get_monotonic_time();
+  gint64 imported = start;
+  gchar *err = NULL;
+
+  JsonParser *parser = json_parser_new();
+  GError *error = NULL;
+  JsonObject *o = NULL;
+  if(!json_parser_load_from_data(parser, job->line, -1, &error))
+  {
+    err = g_strdup_printf("invalid job: %s", error->message);
+    g_error_free(error);
+  }
+  else if(!JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser)))
+    err = g_strdup("invalid job: not an object");
+  else
+  {
+    o = json_node_get_object(json_parser_get_root(parser));
+    err = _server_export(server, o, &imported);
+  }
+  const gint64 end = g_get_monotonic_time();
+
+  JsonBuilder *builder = json_builder_new();
+  json_builder_begin_object(builder);
+  if(o && json_object_has_member(o, "id"))
+  {
+    json_builder_set_member_name(builder, "id");
+    json_builder_add_value(builder, json_node_copy(json_object_get_member(o, "id")));
+  }
+  json_builder_set_member_name(builder, "status");
+  json_builder_add_string_value(builder, err ? "error" : "ok");
+  if(err)
+  {
+    json_builder_set_member_name(builder, "error");
+    json_builder_add_string_value(builder, err);
+  }
+  json_builder_set_member_name(builder, "queued_ms");
+  json_builder_add_double_value(builder, (start - job->received) / 1000.0);
+  json_builder_set_member_name(builder, "import_ms");
+  json_builder_add_double_value(builder, (imported - start) / 1000.0);
+  json_builder_set_member_name(builder, "export_ms");
+  json_builder_add_double_value(builder, (end - imported) / 1000.0);
+  json_builder_set_member_name(builder, "total_ms");
+  json_builder_add_double_value(builder, (end - job->received) / 1000.0);
+  json_builder_end_object(builder);
+  _server_reply(job->client, builder);
+  g_object_unref(builder);
+
+  g_free(err);
+  g_object_unref(parser);
+}
+
+static gpointer _server_worker(gpointer data)
+{
+  dt_cli_server_t *server = (dt_cli_server_t *)data;
+  while(TRUE)
+  {
+    dt_cli_job_t *job = g_async_queue_pop(server->queue);
+    if(job == &_server_stop_job) break;
+
+    _server_run_job(server, job);
+
+    dt_cli_client_t *client = job->client;
+    g_mutex_lock(&client->lock);
+    client->pending--;
+    g_cond_signal(&client->done);
+    g_mutex_unlock(&client->lock);
+    g_free(job->line);
+    free(job);
+  }
+  return NULL;
+}
+
+static gboolean _server_is_quit(const gchar *line)
+{
+  if(!strstr(line, "\"command\"")) return FALSE;
+  JsonParser *parser = json_parser_new();
+  gboolean quit = FALSE;
+  if(json_parser_load_from_data(parser, line, -1, NULL) && JSON_NODE_HOLDS_OBJECT(json_parser_get_root(parser)))
+    quit = !g_strcmp0(_server_get_string(json_node_get_object(json_parser_get_root(parser)), "command"), "quit");
+  g_object_unref(parser);
+  return quit;
+}
+
+// queue the jobs of one client until it closes its input or asks to quit, then wait for its jobs to finish
+static void _server_serve(dt_cli_server_t *server, dt_cli_client_t *client, GDataInputStream *in)
+{
+  while(!server->quit)
+  {
+    gchar *line = NULL;
+    if(in)
+      line = g_data_input_stream_read_line(in, NULL, NULL, NULL);
+    else
+    {
+      GString *str = g_string_new(NULL);
+      char buf[4096];
+      while(fgets(buf, sizeof(buf), stdin))
+      {
+        g_string_append(str, buf);
+        if(str->len && str->str[str->len - 1] == '\n') break;
+      }
+      line = (str->len || !feof(stdin)) ? g_string_free(str, FALSE) : NULL;
+      if(!line) g_string_free(str, TRUE);
+    }
+    if(!line) break;
+
+    g_strstrip(line);
+    if(!*line)
+    {
+      g_free(line);
+      continue;
+    }
+    if(_server_is_quit(line))
+    {
+      server->quit = TRUE;
+      g_free(line);
+      break;
+    }
+
+    dt_cli_job_t *job = malloc(sizeof(dt_cli_job_t));
+    job->client = client;
+    job->line = line;
+    job->received = g_get_monotonic_time();
+    g_mutex_lock(&client->lock);
+    client->pending++;
+    g_mutex_unlock(&client->lock);
+    g_async_queue_push(server->queue, job);
+  }
+
+  g_mutex_lock(&client->lock);
+  while(client->pending > 0) g_cond_wait(&client->done, &client->lock);
+  g_mutex_unlock(&client->lock);
+}
+
+static int _server_run(const int port, const int jobs)
+{
+  dt_cli_server_t server = { 0 };
+  server.queue = g_async_queue_new();
+  g_mutex_init(&server.setup_lock);
+  g_cond_init(&server.input_free);
+  server.busy_inputs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+  GThread **workers = malloc(sizeof(GThread *) * jobs);
+  for(int k = 0; k < jobs; k++) workers[k] = g_thread_new("cli-export", _server_worker, &server);
+
+  int res = 0;
+  if(port <= 0)
+  {
+    // stdout carries the replies only: they go to a duplicate of it, while stdout itself now points to stderr
+    // so whatever else prints there, dt_print() and the libraries, can't end up in the middle of a reply
+    fflush(stdout);
+    const int reply_fd = dup(STDOUT_FILENO);
+    FILE *replies = reply_fd >= 0 ? fdopen(reply_fd, "w") : NULL;
+    if(!replies || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+      fprintf(stderr, "[server] can't separate the replies from the other output on stdout\n");
+      if(replies)
+        fclose(replies);
+      else if(reply_fd >= 0)
+        close(reply_fd);
+      replies = stdout;
+    }
+
+    dt_cli_client_t client = { 0 };
+    g_mutex_init(&client.lock);
+    g_cond_init(&client.done);
+    client.file = replies;
+    _server_serve(&server, &client, NULL);
+    g_mutex_clear(&client.lock);
+    g_cond_clear(&client.done);
+    if(replies != stdout) fclose(replies);
+  }
+  else
+  {
+    // only listen on the loopback interface, the jobs name arbitrary files to read and write
+    GSocketListener *listener = g_socket_listener_new();
+    GSocketAddress *address = g_inet_socket_address_new_from_string("127.0.0.1", port);
+    GError *error = NULL;
+    if(!g_socket_listener_add_address(listener, address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, NULL,
+                                      &error))
+    {
+      fprintf(stderr, _("error: can't listen on port %d: %s\n"), port, error->message);
+      g_error_free(error);
+      res = 1;
+    }
+    else
+      fprintf(stderr, _("notice: waiting for export jobs on 127.0.0.1:%d\n"), port);
+
+    while(!res && !server.quit)
+    {
+      GSocketConnection *connection = g_socket_listener_accept(listener, NULL, NULL, &error);
+      if(!connection)
+      {
+        fprintf(stderr, "[server] accept failed: %s\n", error->message);
+        g_clear_error(&error);
+        continue;
+      }
+      dt_cli_client_t client = { 0 };
+      g_mutex_init(&client.lock);
+      g_cond_init(&client.done);
+      client.out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+      GDataInputStream *in = g_data_input_stream_new(g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+      _server_serve(&server, &client, in);
+      g_object_unref(in);
+      g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+      g_object_unref(connection);
+      g_mutex_clear(&client.lock);
+      g_cond_clear(&client.done);
+    }
+    g_object_unref(address);
+    g_socket_listener_close(listener);
+    g_object_unref(listener);
+  }
+
+  for(int k = 0; k < jobs; k++) g_async_queue_push(server.queue, &_server_stop_job);
+  for(int k = 0; k < jobs; k++) g_thread_join(workers[k]);
+  free(workers);
+
+  g_async_queue_unref(server.queue);
+  g_hash_table_destroy(server.busy_inputs);
+  g_mutex_clear(&server.setup_lock);
+  g_cond_clear(&server.input_free);
+  return res;
+}
+
 int main(int argc, char *arg[])
 {
 #ifdef __APPLE__
@@ -199,7 +739,8 @@ int main(int argc, char *arg[])
   int width = 0, height = 0, bpp = 0;
   gboolean verbose = FALSE, high_quality = TRUE, upscale = FALSE,
            style_overwrite = FALSE, custom_presets = TRUE, export_masks = FALSE,
-           output_to_dir = FALSE;
+           output_to_dir = FALSE, server = FALSE;
+  int server_port = 0, server_jobs = 1;
 
   GList* inputs = NULL;
 
@@ -381,6 +922,20 @@ int main(int argc, char *arg[])
           exit(1);
         }
       }
+      else if(!strcmp(arg[k], "--server"))
+      {
+        server = TRUE;
+      }
+      else if(!strcmp(arg[k], "--port") && argc > k + 1)
+      {
+        k++;
+        server_port = MAX(atoi(arg[k]), 0);
+      }
+      else if(!strcmp(arg[k], "--jobs") && argc > k + 1)
+      {
+        k++;
+        server_jobs = CLAMP(atoi(arg[k]), 1, 64);
+      }
       else if(!strcmp(arg[k], "-v") || !strcmp(arg[k], "--verbose"))
       {
         verbose = TRUE;
@@ -420,6 +975,35 @@ int main(int argc, char *arg[])
   for(; k < argc; k++) m_arg[m_argc++] = arg[k];
   m_arg[m_argc] = NULL;
 
+  if(server)
+  {
+    if(file_counter > 0 || inputs)
+    {
+      fprintf(stderr, _("error: --server takes its input and output files from the jobs\n"));
+      usage(arg[0]);
+      free(m_arg);
+      g_free(output_filename);
+      g_free(output_ext);
+      if(inputs)
+        g_list_free_full(inputs, g_free);
+      exit(1);
+    }
+    g_free(output_ext);
+
+    // init dt once, everything loaded here stays warm for all the jobs
+    if(dt_init(m_argc, m_arg, FALSE, custom_presets, NULL))
+    {
+      free(m_arg);
+      exit(1);
+    }
+    const int res = _server_run(server_port, server_jobs);
+    if(icc_filename)
+      g_free(icc_filename);
+    dt_cleanup();
+    free(m_arg);
+    exit(res);
+  }
+
   if( (inputs && file_counter < 1) || (!inputs && file_counter < 2) || file_counter > 3)
   {
     usage(arg[0]);
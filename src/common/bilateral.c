@@ -18,6 +18,8 @@
 
 #include "common/bilateral.h"
 #include "common/darktable.h" // for CLAMPS, dt_alloc_align, dt_free_align
+#include "common/float16.h"   // for dt_float_to_half, dt_half_to_float
+#include "control/conf.h"     // for dt_conf_get_bool
 #include <glib.h>             // for MIN, MAX
 #include <math.h>             // for roundf
 #include <stdlib.h>           // for size_t, free, malloc, NULL
@@ -58,6 +60,25 @@ void dt_bilateral_grid_size(dt_bilateral_t *b, const int width, const int height
 #endif
 }
 
+// whether to keep a half precision copy of the blurred grid for slicing
+static inline gboolean _use_half_grid(void)
+{
+  return dt_conf_get_bool("bilateral_half_precision_grid");
+}
+
+// memory needed by the CPU path: grid with per-thread partial rows for splatting,
+// an optional half precision copy of the grid and the per-thread row buffers for slicing
+static size_t _bilateral_cpu_memory_use(const dt_bilateral_t *const b, const int width)
+{
+  const size_t grid_size = b->size_x * b->size_y * b->size_z;
+  const size_t row_size = b->size_x * b->size_z;
+  const gboolean half = _use_half_grid();
+  size_t memory_use = (grid_size + 3 * darktable.num_openmp_threads * row_size) * sizeof(float);
+  memory_use += darktable.num_openmp_threads * (width + (half ? 2 * row_size : 0)) * sizeof(float);
+  if(half) memory_use += grid_size * sizeof(uint16_t);
+  return memory_use;
+}
+
 size_t dt_bilateral_memory_use(const int width,     // width of input image
                                const int height,    // height of input image
                                const float sigma_s, // spatial sigma (blur pixel coords)
@@ -65,12 +86,12 @@ size_t dt_bilateral_memory_use(const int width,     // width of input image
 {
   dt_bilateral_t b;
   dt_bilateral_grid_size(&b,width,height,100.0f,sigma_s,sigma_r);
-  size_t grid_size = b.size_x * b.size_y * b.size_z;
 #ifdef HAVE_OPENCL
   // OpenCL path needs two buffers
+  size_t grid_size = b.size_x * b.size_y * b.size_z;
   return 2 * grid_size * sizeof(float);
 #else
-  return (grid_size + 3 * darktable.num_openmp_threads * b.size_x * b.size_z) * sizeof(float);
+  return _bilateral_cpu_memory_use(&b, width);
 #endif /* HAVE_OPENCL */
 }
 
@@ -93,8 +114,7 @@ size_t dt_bilateral_singlebuffer_size(const int width,     // width of input ima
 {
   dt_bilateral_t b;
   dt_bilateral_grid_size(&b,width,height,100.0f,sigma_s,sigma_r);
-  size_t grid_size = b.size_x * b.size_y * b.size_z;
-  return (grid_size + 3 * darktable.num_openmp_threads * b.size_x * b.size_z) * sizeof(float);
+  return _bilateral_cpu_memory_use(&b, width);
 }
 
 #ifndef HAVE_OPENCL
@@ -109,21 +129,6 @@ size_t dt_bilateral_singlebuffer_size2(const int width,
 }
 #endif /* !HAVE_OPENCL */
 
-static size_t image_to_grid(const dt_bilateral_t *const b, const int i, const int j, const float L,
-                            float *xf, float *yf, float *zf)
-{
-  float x = CLAMPS(i / b->sigma_s, 0, b->size_x - 1);
-  float y = CLAMPS(j / b->sigma_s, 0, b->size_y - 1);
-  float z = CLAMPS(L / b->sigma_r, 0, b->size_z - 1);
-  const int xi = MIN((int)x, b->size_x - 2);
-  const int yi = MIN((int)y, b->size_y - 2);
-  const int zi = MIN((int)z, b->size_z - 2);
-  *xf = x - xi;
-  *yf = y - yi;
-  *zf = z - zi;
-  return ((xi + yi * b->size_x) * b->size_z) + zi;
-}
-
 static size_t image_to_relgrid(const dt_bilateral_t *const b, const int i, const float L, float *xf, float *zf)
 {
   float x = CLAMPS(i / b->sigma_s, 0, b->size_x - 1);
@@ -157,6 +162,10 @@ dt_bilateral_t *dt_bilateral_init(const int width,     // width of input image
   {
     fprintf(stderr,"[bilateral] unable to allocate buffer for %lux%lux%lu grid\n",b->size_x,b->size_y,b->size_z);
   }
+  // the half precision copy is filled by dt_bilateral_blur(), if we can't get it just slice from the float grid
+  b->hbuf = _use_half_grid()
+    ? dt_alloc_align(64, sizeof(uint16_t) * b->size_x * b->size_y * b->size_z)
+    : NULL;
   dt_print(DT_DEBUG_DEV, "[bilateral] created grid [%ld %ld %ld] with sigma (%f %f) (%f %f)\n",
            b->size_x, b->size_y, b->size_z, b->sigma_s, sigma_s, b->sigma_r, sigma_r);
   return b;
@@ -234,25 +243,38 @@ void dt_bilateral_splat(const dt_bilateral_t *b, const float *const in)
     }
   }
 
-  // merge the per-thread results into the final result
-  for (int slice = 1 ; slice < nthreads; slice++)
+  // merge the per-thread results into the final result.  the partial grids of later slices may overlap the
+  // final rows of earlier ones, so the slices have to be merged in order, but every column of the grid can be
+  // merged independently.  split the columns into cache-line sized chunks and merge those in parallel.
+  const int chunk = 16;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(buf, oy, nthreads, chunk) \
+  shared(b) \
+  schedule(static)
+#endif
+  for(int col = 0; col < oy; col += chunk)
   {
-    // compute the first row of the final grid which this slice splats
-    const int destrow = (int)(slice * b->sliceheight / b->sigma_s);
-    float *dest = buf + destrow * oy;
-    // now iterate over the grid rows splatted for this slice
-    for(int j = slice * b->slicerows; j < (slice+1)*b->slicerows; j++)
+    const int ncols = MIN(chunk, oy - col);
+    for (int slice = 1 ; slice < nthreads; slice++)
     {
-      float *src = buf + j * oy;
-      for(int i = 0; i < oy; i++)
+      // compute the first row of the final grid which this slice splats
+      const int destrow = (int)(slice * b->sliceheight / b->sigma_s);
+      float *dest = buf + (size_t)destrow * oy + col;
+      // now iterate over the grid rows splatted for this slice
+      for(int j = slice * b->slicerows; j < (slice+1)*b->slicerows; j++)
       {
-        dest[i] += src[i];
+        float *src = buf + (size_t)j * oy + col;
+        for(int i = 0; i < ncols; i++)
+        {
+          dest[i] += src[i];
+        }
+        dest += oy;
+        // clear elements in the part of the buffer which holds the final result now that we've read the partial
+        // result, since we'll be adding to those locations later
+        if (j < b->size_y)
+          memset(src, '\0', sizeof(float) * ncols);
       }
-      dest += oy;
-      // clear elements in the part of the buffer which holds the final result now that we've read the partial result,
-      // since we'll be adding to those locations later
-      if (j < b->size_y)
-        memset(buf + j*oy, '\0', sizeof(float) * oy);
     }
   }
 }
@@ -357,103 +379,183 @@ void dt_bilateral_blur(const dt_bilateral_t *b)
   blur_line(b->buf, oz, ox, oy, b->size_z, b->size_x, b->size_y);
   // -2 derivative of the gaussian up to 3 sigma: x*exp(-x*x)
   blur_line_z(b->buf, ox, oy, oz, b->size_x, b->size_y, b->size_z);
-}
-
 
+  // the grid is final now, store the copy for slicing
+  if(b->hbuf)
+  {
+    const size_t size_y = b->size_y;
+    float *const buf = b->buf;
+    uint16_t *const hbuf = b->hbuf;
 #ifdef _OPENMP
-#pragma omp declare simd aligned(out, in :64)
+#pragma omp parallel for default(none) \
+    dt_omp_firstprivate(buf, hbuf, oy, size_y) \
+    schedule(static)
 #endif
-void dt_bilateral_slice(const dt_bilateral_t *const b, const float *const in, float *out, const float detail)
+    for(size_t j = 0; j < size_y; j++)
+      dt_float_to_half_buf(hbuf + j * oy, buf + j * oy, oy);
+  }
+}
+
+// trilinear lookup of the grid at image column i and value L.  grid points to the grid row below the image row,
+// the next grid row follows at offset oy.  returns the unscaled grid value.
+static inline float _bilateral_grid_value(const float *const grid, const float L, const int i, const int size_x,
+                                          const int size_z, const float sigma_s, const float sigma_r,
+                                          const float yf)
 {
-  // detail: 0 is leave as is, -1 is bilateral filtered, +1 is contrast boost
-  const float norm = -detail * b->sigma_r * 0.04f;
-  const int ox = b->size_z;
-  const int oy = b->size_x * b->size_z;
-  const int oz = 1;
-  float *const buf = b->buf;
-  const int width = b->width;
-  const int height = b->height;
+  const int ox = size_z;
+  const int oy = size_x * size_z;
+  // same as image_to_relgrid(), but with all parameters in registers
+  const float x = CLAMPS(i / sigma_s, 0, size_x - 1);
+  const float z = CLAMPS(L / sigma_r, 0, size_z - 1);
+  const int xi = MIN((int)x, size_x - 2);
+  const int zi = MIN((int)z, size_z - 2);
+  const float xf = x - xi;
+  const float zf = z - zi;
+  const float *const g = grid + xi * ox + zi;
+  // interpolate along z, then along x and finally y
+  const float g00 = g[0] * (1.0f - zf) + g[1] * zf;
+  const float g10 = g[ox] * (1.0f - zf) + g[ox + 1] * zf;
+  const float g01 = g[oy] * (1.0f - zf) + g[oy + 1] * zf;
+  const float g11 = g[ox + oy] * (1.0f - zf) + g[ox + oy + 1] * zf;
+  return (1.0f - yf) * (g00 * (1.0f - xf) + g10 * xf) + yf * (g01 * (1.0f - xf) + g11 * xf);
+}
 
-  if (!buf) return;
+// trilinear lookup of the grid for one row of the image, writes the unscaled grid values for all pixels into row.
+__DT_CLONE_TARGETS__
+static void _bilateral_slice_row(const float *const grid, const float *const in, float *const row,
+                                 const int width, const int size_x, const int size_z, const float sigma_s,
+                                 const float sigma_r, const float yf)
+{
 #ifdef _OPENMP
-#pragma omp parallel for default(none) \
-  dt_omp_firstprivate(b, in, norm, ox, oy, oz, height, width, buf) \
-    shared(out) collapse(2)
+#pragma omp simd
 #endif
-  for(int j = 0; j < height; j++)
+  for(int i = 0; i < width; i++)
+    row[i] = _bilateral_grid_value(grid, in[4 * i], i, size_x, size_z, sigma_s, sigma_r, yf);
+}
+
+// apply the scaled grid value v to the pixel at index k
+static inline void _bilateral_store(const float *const in, float *const out, const size_t k, const float v,
+                                    const gboolean to_output)
+{
+  if(to_output)
+    out[k] = MAX(0.0f, out[k] + v);
+  else
   {
-    for(int i = 0; i < width; i++)
-    {
-      size_t index = 4 * (j * width + i);
-      float xf, yf, zf;
-      const float L = in[index];
-      // trilinear lookup:
-      const size_t gi = image_to_grid(b, i, j, L, &xf, &yf, &zf);
-      const float Lout = L
-                         + norm * (buf[gi] * (1.0f - xf) * (1.0f - yf) * (1.0f - zf)
-                                   + buf[gi + ox] * (xf) * (1.0f - yf) * (1.0f - zf)
-                                   + buf[gi + oy] * (1.0f - xf) * (yf) * (1.0f - zf)
-                                   + buf[gi + ox + oy] * (xf) * (yf) * (1.0f - zf)
-                                   + buf[gi + oz] * (1.0f - xf) * (1.0f - yf) * (zf)
-                                   + buf[gi + ox + oz] * (xf) * (1.0f - yf) * (zf)
-                                   + buf[gi + oy + oz] * (1.0f - xf) * (yf) * (zf)
-                                   + buf[gi + ox + oy + oz] * (xf) * (yf) * (zf));
-      out[index] = Lout;
-      // and copy color and mask
-      out[index + 1] = in[index + 1];
-      out[index + 2] = in[index + 2];
-      out[index + 3] = in[index + 3];
-    }
+    out[k] = in[k] + v;
+    // and copy color and mask
+    out[k + 1] = in[k + 1];
+    out[k + 2] = in[k + 2];
+    out[k + 3] = in[k + 3];
   }
 }
 
-#ifdef _OPENMP
-#pragma omp declare simd aligned(out, in :64)
-#endif
-void dt_bilateral_slice_to_output(const dt_bilateral_t *const b, const float *const in, float *out,
-                                  const float detail)
+// shared by dt_bilateral_slice() and dt_bilateral_slice_to_output().  the image is processed in the same
+// horizontal slices as used for splatting, so each thread walks down the grid and can keep the two grid rows
+// it currently needs converted from half precision if the grid is stored that way.
+static void _bilateral_slice(const dt_bilateral_t *const b, const float *const in, float *out, const float detail,
+                             const gboolean to_output)
 {
   // detail: 0 is leave as is, -1 is bilateral filtered, +1 is contrast boost
   const float norm = -detail * b->sigma_r * 0.04f;
-  const int ox = b->size_z;
   const int oy = b->size_x * b->size_z;
-  const int oz = 1;
-  float *const buf = b->buf;
   const int width = b->width;
   const int height = b->height;
+  const int size_x = b->size_x;
+  const int size_y = b->size_y;
+  const int size_z = b->size_z;
+  const float sigma_s = b->sigma_s;
+  const float sigma_r = b->sigma_r;
+  const int sliceheight = b->sliceheight;
+  const int numslices = b->numslices;
+  const float *const buf = b->buf;
+  const uint16_t *const hbuf = b->hbuf;
 
   if (!buf) return;
+
+  size_t padded_size;
+  float *const scratch = dt_alloc_perthread_float(width + (hbuf ? 2 * oy : 0), &padded_size);
+  if(!scratch)
+  {
+    // no memory for the row buffers, look up every pixel directly in the float grid
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+    dt_omp_firstprivate(in, out, norm, oy, width, height, size_x, size_y, size_z, sigma_s, sigma_r, buf, \
+                        to_output) \
+    schedule(static) collapse(2)
+#endif
+    for(int j = 0; j < height; j++)
+      for(int i = 0; i < width; i++)
+      {
+        const float y = CLAMPS(j / sigma_s, 0, size_y - 1);
+        const int yi = MIN((int)y, size_y - 2);
+        const size_t k = (size_t)4 * (j * width + i);
+        const float v = _bilateral_grid_value(buf + (size_t)yi * oy, in[k], i, size_x, size_z, sigma_s, sigma_r,
+                                              y - yi);
+        _bilateral_store(in, out, k, norm * v, to_output);
+      }
+    return;
+  }
+
 #ifdef _OPENMP
 #pragma omp parallel for default(none) \
-  dt_omp_firstprivate(b, in, norm, oy, oz, ox, buf, width, height) \
-  shared(out) collapse(2)
+  dt_omp_firstprivate(in, out, norm, oy, width, height, size_x, size_y, size_z, sigma_s, sigma_r, sliceheight, \
+                      numslices, buf, hbuf, scratch, padded_size, to_output) \
+  schedule(static)
 #endif
-  for(int j = 0; j < height; j++)
+  for(int slice = 0; slice < numslices; slice++)
   {
-    for(int i = 0; i < width; i++)
+    float *const row = dt_get_perthread(scratch, padded_size);
+    float *const gridrows = row + width;
+    int cached_yi = -1;
+    const int firstrow = slice * sliceheight;
+    const int lastrow = MIN((slice + 1) * sliceheight, height);
+    for(int j = firstrow; j < lastrow; j++)
     {
-      size_t index = 4 * (j * width + i);
-      float xf, yf, zf;
-      const float L = in[index];
-      // trilinear lookup:
-      const size_t gi = image_to_grid(b, i, j, L, &xf, &yf, &zf);
-      const float Lout = norm * (buf[gi] * (1.0f - xf) * (1.0f - yf) * (1.0f - zf)
-                                 + buf[gi + ox] * (xf) * (1.0f - yf) * (1.0f - zf)
-                                 + buf[gi + oy] * (1.0f - xf) * (yf) * (1.0f - zf)
-                                 + buf[gi + ox + oy] * (xf) * (yf) * (1.0f - zf)
-                                 + buf[gi + oz] * (1.0f - xf) * (1.0f - yf) * (zf)
-                                 + buf[gi + ox + oz] * (xf) * (1.0f - yf) * (zf)
-                                 + buf[gi + oy + oz] * (1.0f - xf) * (yf) * (zf)
-                                 + buf[gi + ox + oy + oz] * (xf) * (yf) * (zf));
-      out[index] = MAX(0.0f, out[index] + Lout);
+      const float y = CLAMPS(j / sigma_s, 0, size_y - 1);
+      const int yi = MIN((int)y, size_y - 2);
+      const float yf = y - yi;
+      const float *grid = buf + (size_t)yi * oy;
+      if(hbuf)
+      {
+        if(cached_yi >= 0 && yi == cached_yi + 1)
+        {
+          // moved down by one grid row, only the new lower row needs converting
+          memcpy(gridrows, gridrows + oy, sizeof(float) * oy);
+          dt_half_to_float_buf(gridrows + oy, hbuf + (size_t)(yi + 1) * oy, oy);
+          cached_yi = yi;
+        }
+        else if(yi != cached_yi)
+        {
+          dt_half_to_float_buf(gridrows, hbuf + (size_t)yi * oy, 2 * oy);
+          cached_yi = yi;
+        }
+        grid = gridrows;
+      }
+      const size_t index = (size_t)4 * j * width;
+      _bilateral_slice_row(grid, in + index, row, width, size_x, size_z, sigma_s, sigma_r, yf);
+
+      for(int i = 0; i < width; i++) _bilateral_store(in, out, index + 4 * i, norm * row[i], to_output);
     }
   }
+  dt_free_align(scratch);
+}
+
+void dt_bilateral_slice(const dt_bilateral_t *const b, const float *const in, float *out, const float detail)
+{
+  _bilateral_slice(b, in, out, detail, FALSE);
+}
+
+void dt_bilateral_slice_to_output(const dt_bilateral_t *const b, const float *const in, float *out,
+                                  const float detail)
+{
+  _bilateral_slice(b, in, out, detail, TRUE);
 }
 
 void dt_bilateral_free(dt_bilateral_t *b)
 {
   if(!b) return;
   dt_free_align(b->buf);
+  dt_free_align(b->hbuf);
   free(b);
 }
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stddef.h> // for size_t
+#include <stdint.h> // for uint16_t
 
 typedef struct dt_bilateral_t
 {
@@ -27,6 +28,7 @@ typedef struct dt_bilateral_t
   int numslices, sliceheight, slicerows; //height--in input image, rows--in grid
   float sigma_s, sigma_r;
   float *buf __attribute__((aligned(64)));
+  uint16_t *hbuf; // blurred grid in half precision for slicing, NULL if slicing from buf
 } __attribute__((packed)) dt_bilateral_t;
 
 size_t dt_bilateral_memory_use(const int width,      // width of input image
@@ -42,13 +42,13 @@ typedef struct dt_undo_colorlabels_t
 int dt_colorlabels_get_labels(const int imgid)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT color FROM main.color_labels WHERE imgid = ?1", -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db,
+                                           "SELECT color FROM main.color_labels WHERE imgid = ?1", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   int colors = 0;
   while(sqlite3_step(stmt) == SQLITE_ROW)
     colors |= (1<<sqlite3_column_int(stmt, 0));
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   return colors;
 }
 
@@ -92,33 +92,32 @@ static void _colorlabels_undo_data_free(gpointer data)
 void dt_colorlabels_remove_labels(const int imgid)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "DELETE FROM main.color_labels WHERE imgid=?1", -1,
-                              &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "DELETE FROM main.color_labels WHERE imgid=?1", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 }
 
 void dt_colorlabels_set_label(const int imgid, const int color)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "INSERT INTO main.color_labels (imgid, color) VALUES (?1, ?2)", -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db,
+                                  "INSERT INTO main.color_labels (imgid, color) VALUES (?1, ?2)",
+                                  &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, color);
   sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 }
 
 void dt_colorlabels_remove_label(const int imgid, const int color)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "DELETE FROM main.color_labels WHERE imgid=?1 AND color=?2", -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "DELETE FROM main.color_labels WHERE imgid=?1 AND color=?2", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, color);
   sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 }
 
 typedef enum dt_colorlabels_actions_t
@@ -219,19 +218,19 @@ int dt_colorlabels_check_label(const int imgid, const int color)
 {
   if(imgid <= 0) return 0;
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT * FROM main.color_labels WHERE imgid=?1 AND color=?2 LIMIT 1",
-                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db,
+                                           "SELECT * FROM main.color_labels WHERE imgid=?1 AND color=?2 LIMIT 1",
+                                           &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, color);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
-    sqlite3_finalize(stmt);
+    DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
     return 1;
   }
   else
   {
-    sqlite3_finalize(stmt);
+    DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
     return 0;
   }
 }
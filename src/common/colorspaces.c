@@ -1164,6 +1164,78 @@ static dt_colorspaces_color_profile_t *_create_profile(dt_colorspaces_color_prof
   return prof;
 }
 
+static dt_colorspaces_display_lut_t *_display_lut_create(cmsHTRANSFORM transform)
+{
+  if(!transform) return NULL;
+  const int n = DT_COLORSPACES_DISPLAY_LUT_SIZE;
+  dt_colorspaces_display_lut_t *lut = malloc(sizeof(dt_colorspaces_display_lut_t));
+  uint8_t *nodes = malloc(sizeof(uint8_t) * 4 * n * n * n);
+  if(!lut || !nodes)
+  {
+    free(lut);
+    free(nodes);
+    return NULL;
+  }
+
+  int node[DT_COLORSPACES_DISPLAY_LUT_SIZE];
+  for(int k = 0; k < n; k++) node[k] = (255 * k + (n - 1) / 2) / (n - 1);
+  for(int v = 0, k = 0; v < 256; v++)
+  {
+    while(k < n - 2 && v >= node[k + 1]) k++;
+    const int step = node[k + 1] - node[k];
+    lut->cell[v] = k;
+    lut->frac[v] = ((v - node[k]) * 256 + step / 2) / step;
+  }
+
+  for(int r = 0; r < n; r++)
+    for(int g = 0; g < n; g++)
+      for(int b = 0; b < n; b++)
+      {
+        uint8_t *px = nodes + 4 * ((r * n + g) * n + b);
+        px[0] = node[r];
+        px[1] = node[g];
+        px[2] = node[b];
+        px[3] = 0;
+      }
+  // one call for the whole grid, the output keeps lcms' BGRA order
+  memset(lut->table, 0, sizeof(lut->table));
+  cmsDoTransform(transform, nodes, lut->table, n * n * n);
+  free(nodes);
+  return lut;
+}
+
+void dt_colorspaces_display_lut_apply(const dt_colorspaces_display_lut_t *lut, const uint8_t *in, uint8_t *out,
+                                      const size_t npixels)
+{
+  const int n = DT_COLORSPACES_DISPLAY_LUT_SIZE;
+  const int dr = 4 * n * n, dg = 4 * n, db = 4;
+  for(size_t k = 0; k < npixels; k++, in += 4, out += 4)
+  {
+    const int fr = lut->frac[in[0]], fg = lut->frac[in[1]], fb = lut->frac[in[2]];
+    const uint8_t *c0 = lut->table + 4 * ((lut->cell[in[0]] * n + lut->cell[in[1]]) * n + lut->cell[in[2]]);
+
+    // tetrahedral interpolation: walk from the cell origin to the opposite corner along the axes
+    // in order of decreasing fraction
+    int o1, o2, w1, w2, w3;
+    if(fr >= fg)
+    {
+      if(fg >= fb)      { o1 = dr;      o2 = dr + dg; w1 = fr; w2 = fg; w3 = fb; }
+      else if(fr >= fb) { o1 = dr;      o2 = dr + db; w1 = fr; w2 = fb; w3 = fg; }
+      else              { o1 = db;      o2 = dr + db; w1 = fb; w2 = fr; w3 = fg; }
+    }
+    else
+    {
+      if(fb >= fg)      { o1 = db;      o2 = dg + db; w1 = fb; w2 = fg; w3 = fr; }
+      else if(fb >= fr) { o1 = dg;      o2 = dg + db; w1 = fg; w2 = fb; w3 = fr; }
+      else              { o1 = dg;      o2 = dr + dg; w1 = fg; w2 = fr; w3 = fb; }
+    }
+    const uint8_t *c1 = c0 + o1, *c2 = c0 + o2, *c3 = c0 + dr + dg + db;
+    for(int c = 0; c < 3; c++)
+      out[c] = (c0[c] * 256 + w1 * (c1[c] - c0[c]) + w2 * (c2[c] - c1[c]) + w3 * (c3[c] - c2[c]) + 128) >> 8;
+    out[3] = 0;
+  }
+}
+
 // this function is basically thread safe, at least when not called on the global darktable.color_profiles
 static void _update_display_transforms(dt_colorspaces_t *self)
 {
@@ -1173,6 +1245,12 @@ static void _update_display_transforms(dt_colorspaces_t *self)
   if(self->transform_adobe_rgb_to_display) cmsDeleteTransform(self->transform_adobe_rgb_to_display);
   self->transform_adobe_rgb_to_display = NULL;
 
+  free(self->lut_srgb_to_display);
+  self->lut_srgb_to_display = NULL;
+
+  free(self->lut_adobe_rgb_to_display);
+  self->lut_adobe_rgb_to_display = NULL;
+
   const dt_colorspaces_color_profile_t *display_dt_profile = _get_profile(self, self->display_type,
                                                                           self->display_filename,
                                                                           DT_PROFILE_DIRECTION_DISPLAY);
@@ -1195,6 +1273,9 @@ static void _update_display_transforms(dt_colorspaces_t *self)
                                                             TYPE_BGRA_8,
                                                             self->display_intent,
                                                             0);
+
+  self->lut_srgb_to_display = _display_lut_create(self->transform_srgb_to_display);
+  self->lut_adobe_rgb_to_display = _display_lut_create(self->transform_adobe_rgb_to_display);
 }
 
 static void _update_display2_transforms(dt_colorspaces_t *self)
@@ -1627,6 +1708,12 @@ void dt_colorspaces_cleanup(dt_colorspaces_t *self)
   if(self->transform_adobe_rgb_to_display2) cmsDeleteTransform(self->transform_adobe_rgb_to_display2);
   self->transform_adobe_rgb_to_display2 = NULL;
 
+  free(self->lut_srgb_to_display);
+  self->lut_srgb_to_display = NULL;
+
+  free(self->lut_adobe_rgb_to_display);
+  self->lut_adobe_rgb_to_display = NULL;
+
   for(GList *iter = self->profiles; iter; iter = g_list_next(iter))
   {
     dt_colorspaces_color_profile_t *p = (dt_colorspaces_color_profile_t *)iter->data;
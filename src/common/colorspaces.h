@@ -101,6 +101,19 @@ typedef enum dt_colorspaces_profile_direction_t
                              | DT_PROFILE_DIRECTION_DISPLAY2
 } dt_colorspaces_profile_direction_t;
 
+// number of grid nodes per channel of the display lut
+#define DT_COLORSPACES_DISPLAY_LUT_SIZE 33
+
+/** 8 bit 3D lut sampled from one of the display transforms. it maps RGBA_8 to BGRA_8 like the transform
+ *  itself, but is a lot cheaper to apply than going through lcms for every thumbnail redraw. */
+typedef struct dt_colorspaces_display_lut_t
+{
+  uint8_t cell[256];  // grid cell an 8 bit input value falls into
+  uint16_t frac[256]; // position inside that cell, 0..256
+  uint8_t table[DT_COLORSPACES_DISPLAY_LUT_SIZE * DT_COLORSPACES_DISPLAY_LUT_SIZE
+                * DT_COLORSPACES_DISPLAY_LUT_SIZE * 4];
+} dt_colorspaces_display_lut_t;
+
 typedef struct dt_colorspaces_t
 {
   GList *profiles;
@@ -133,6 +146,9 @@ typedef struct dt_colorspaces_t
   cmsHTRANSFORM transform_srgb_to_display, transform_adobe_rgb_to_display;
   cmsHTRANSFORM transform_srgb_to_display2, transform_adobe_rgb_to_display2;
 
+  // luts sampled from the two display transforms above, NULL if the transform doesn't exist
+  dt_colorspaces_display_lut_t *lut_srgb_to_display, *lut_adobe_rgb_to_display;
+
 } dt_colorspaces_t;
 
 typedef struct dt_colorspaces_color_profile_t
@@ -228,6 +244,10 @@ void dt_colorspaces_update_display_transforms();
 /** same for display2 */
 void dt_colorspaces_update_display2_transforms();
 
+/** apply a display lut to npixels RGBA_8 pixels, writing BGRA_8 like the transform it was sampled from */
+void dt_colorspaces_display_lut_apply(const dt_colorspaces_display_lut_t *lut, const uint8_t *in, uint8_t *out,
+                                      const size_t npixels);
+
 /** Calculate CAM->XYZ, XYZ->CAM matrices **/
 int dt_colorspaces_conversion_matrices_xyz(const char *name, float in_XYZ_to_CAM[9], double XYZ_to_CAM[4][3], double CAM_to_XYZ[3][4]);
 
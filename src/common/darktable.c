@@ -27,6 +27,9 @@
 #ifdef __APPLE__
 #include <sys/malloc.h>
 #endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 #include "common/collection.h"
 #include "common/colorspaces.h"
@@ -50,9 +53,12 @@
 #include "common/l10n.h"
 #include "common/mipmap_cache.h"
 #include "common/noiseprofiles.h"
+#include "common/numa.h"
 #include "common/opencl.h"
 #include "common/points.h"
 #include "common/resource_limits.h"
+#include "common/sidecar_writer.h"
+#include "common/tag_index.h"
 #include "common/undo.h"
 #include "control/conf.h"
 #include "control/control.h"
@@ -123,7 +129,7 @@ static int usage(const char *argv0)
   printf("  --configdir <user config directory>\n");
   printf("  -d {all,cache,camctl,camsupport,control,dev,fswatch,imageio,input,\n");
   printf("      ioporder,lighttable,lua,masks,memory,nan,opencl,params,perf,demosaic\n");
-  printf("      pwstorage,print,signal,sql,undo}\n");
+  printf("      pipe,pwstorage,print,signal,sql,undo}\n");
   printf("  --d-signal <signal> \n");
   printf("  --d-signal-act <all,raise,connect,disconnect");
 #ifdef DT_HAVE_SIGNAL_TRACE
@@ -404,6 +410,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   }
   dt_pthread_mutex_init(&(darktable.plugin_threadsafe), NULL);
   dt_pthread_mutex_init(&(darktable.dev_threadsafe), NULL);
+  dt_pthread_mutex_init(&(darktable.iop_pool_threadsafe), NULL);
   dt_pthread_mutex_init(&(darktable.capabilities_threadsafe), NULL);
   dt_pthread_mutex_init(&(darktable.exiv2_threadsafe), NULL);
   dt_pthread_mutex_init(&(darktable.readFile_mutex), NULL);
@@ -620,6 +627,8 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
           darktable.unmuted |= DT_DEBUG_PARAMS; // iop module params checks on console
         else if(!strcmp(argv[k + 1], "demosaic"))
           darktable.unmuted |= DT_DEBUG_DEMOSAIC;
+        else if(!strcmp(argv[k + 1], "pipe"))
+          darktable.unmuted |= DT_DEBUG_PIPE; // pixelpipe setup, e.g. the colorspace conversions
         else
           return usage(argv[0]);
         k++;
@@ -888,6 +897,9 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   dt_conf_init(darktable.conf, darktablerc, config_override);
   g_slist_free_full(config_override, g_free);
 
+  // large buffer allocation needs the config backend
+  dt_numa_init();
+
   // set the interface language and prepare selection for prefs
   darktable.l10n = dt_l10n_init(init_gui);
 
@@ -978,6 +990,10 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
     dt_database_perform_maintenance(darktable.db);
   }
 
+  // only filled on first use, from then on kept in sync with the database by the tagging code
+  darktable.tag_index = (dt_tag_index_t *)calloc(1, sizeof(dt_tag_index_t));
+  dt_tag_index_init(darktable.tag_index);
+
   // Initialize the signal system
   darktable.signals = dt_control_signal_init();
 
@@ -1052,6 +1068,10 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   darktable.image_cache = (dt_image_cache_t *)calloc(1, sizeof(dt_image_cache_t));
   dt_image_cache_init(darktable.image_cache);
 
+  // only write sidecars in the background if there is a gui to keep responsive
+  darktable.sidecar_writer = (dt_sidecar_writer_t *)calloc(1, sizeof(dt_sidecar_writer_t));
+  dt_sidecar_writer_init(darktable.sidecar_writer, init_gui);
+
   darktable.mipmap_cache = (dt_mipmap_cache_t *)calloc(1, sizeof(dt_mipmap_cache_t));
   dt_mipmap_cache_init(darktable.mipmap_cache);
 
@@ -1254,7 +1274,16 @@ void dt_cleanup()
     dt_dbus_destroy(darktable.dbus);
 
     dt_control_shutdown(darktable.control);
+  }
+
+  // writes all pending sidecars. the jobs are stopped now, so nothing can queue any more writes, but control,
+  // gui, image cache and database still have to be there as writing may log errors.
+  dt_sidecar_writer_cleanup(darktable.sidecar_writer);
+  free(darktable.sidecar_writer);
+  darktable.sidecar_writer = NULL;
 
+  if(init_gui)
+  {
     dt_lib_cleanup(darktable.lib);
     free(darktable.lib);
   }
@@ -1268,7 +1297,11 @@ void dt_cleanup()
     dt_imageio_cleanup(darktable.imageio);
     free(darktable.imageio);
     free(darktable.gui);
+    darktable.gui = NULL;
   }
+  dt_tag_index_cleanup(darktable.tag_index);
+  free(darktable.tag_index);
+  darktable.tag_index = NULL;
   dt_image_cache_cleanup(darktable.image_cache);
   free(darktable.image_cache);
   dt_mipmap_cache_cleanup(darktable.mipmap_cache);
@@ -1353,6 +1386,7 @@ void dt_cleanup()
   }
   dt_pthread_mutex_destroy(&(darktable.plugin_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.dev_threadsafe));
+  dt_pthread_mutex_destroy(&(darktable.iop_pool_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.capabilities_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.exiv2_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.readFile_mutex));
@@ -1402,7 +1436,19 @@ void *dt_alloc_align(size_t alignment, size_t size)
   return ((char*)ptr) + alignment ;
 #else
   void *ptr = NULL;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if(darktable.huge_pages && aligned_size >= DT_NUMA_LARGE_BUFFER_SIZE)
+  {
+    // large image buffers start on a huge page boundary and are backed by transparent huge pages, which
+    // saves the TLB misses of the full-image loops
+    if(posix_memalign(&ptr, MAX(alignment, DT_NUMA_HUGE_PAGE_SIZE), aligned_size)) return NULL;
+    madvise(ptr, aligned_size, MADV_HUGEPAGE);
+    dt_numa_first_touch(ptr, aligned_size);
+    return ptr;
+  }
+#endif
   if(posix_memalign(&ptr, alignment, aligned_size)) return NULL;
+  if(aligned_size >= DT_NUMA_LARGE_BUFFER_SIZE) dt_numa_first_touch(ptr, aligned_size);
   return ptr;
 #endif
 }
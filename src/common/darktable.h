@@ -261,6 +261,7 @@ typedef enum dt_debug_thread_t
   DT_DEBUG_SIGNAL         = 1 << 20,
   DT_DEBUG_PARAMS         = 1 << 21,
   DT_DEBUG_DEMOSAIC       = 1 << 22,
+  DT_DEBUG_PIPE           = 1 << 23,
 } dt_debug_thread_t;
 
 typedef struct dt_codepath_t
@@ -274,9 +275,12 @@ typedef struct darktable_t
 {
   dt_codepath_t codepath;
   int32_t num_openmp_threads;
+  int32_t numa_nodes;
+  gboolean huge_pages;
 
   int32_t unmuted;
   GList *iop;
+  GList *iop_pool; // module sets of finished headless develop objects, see dt_iop_load_modules_ext()
   GList *iop_order_list;
   GList *iop_order_rules;
   GList *capabilities;
@@ -290,6 +294,8 @@ typedef struct darktable_t
   struct dt_gui_gtk_t *gui;
   struct dt_mipmap_cache_t *mipmap_cache;
   struct dt_image_cache_t *image_cache;
+  struct dt_sidecar_writer_t *sidecar_writer;
+  struct dt_tag_index_t *tag_index;
   struct dt_bauhaus_t *bauhaus;
   const struct dt_database_t *db;
   const struct dt_pwstorage_t *pwstorage;
@@ -304,7 +310,8 @@ typedef struct darktable_t
   struct dt_colorspaces_t *color_profiles;
   struct dt_l10n_t *l10n;
   dt_pthread_mutex_t db_image[DT_IMAGE_DBLOCKS];
-  dt_pthread_mutex_t dev_threadsafe;
+  dt_pthread_mutex_t dev_threadsafe; // guards memory.history while a history is read
+  dt_pthread_mutex_t iop_pool_threadsafe;
   dt_pthread_mutex_t plugin_threadsafe;
   dt_pthread_mutex_t capabilities_threadsafe;
   dt_pthread_mutex_t exiv2_threadsafe;
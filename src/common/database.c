@@ -23,6 +23,7 @@
 #include "common/database.h"
 #include "common/darktable.h"
 #include "common/debug.h"
+#include "common/dtpthread.h"
 #include "common/file_location.h"
 #include "common/iop_order.h"
 #include "common/styles.h"
@@ -41,6 +42,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -65,8 +67,123 @@ typedef struct dt_database_t
 
   gchar *error_message, *error_dbfilename;
   int error_other_pid;
+
+  /* idle prepared statements, see dt_database_prepare_cached() */
+  dt_pthread_mutex_t stmt_cache_lock;
+  GHashTable *stmt_cache; // sql text -> GQueue of statements
+  int stmt_cache_count;
+  uint64_t stmt_cache_hits, stmt_cache_misses;
+
+  /* read-only connections for background threads, see dt_database_prepare_cached_readonly() */
+  dt_pthread_mutex_t readers_lock;
+  GList *readers; // all of them, doesn't change after init
+  GQueue *readers_idle;
+  gboolean wal;
+  uint64_t reader_hits, reader_misses;
 } dt_database_t;
 
+typedef struct dt_database_reader_t
+{
+  sqlite3 *handle;
+  GHashTable *stmt_cache; // like the one of the primary connection, only used by the thread holding the reader
+} dt_database_reader_t;
+
+// upper limit of idle statements kept around, statements given back on top of that are finalized
+#define DT_DATABASE_STMT_CACHE_MAX 256
+
+static void _stmt_finalize(gpointer data)
+{
+  sqlite3_finalize((sqlite3_stmt *)data);
+}
+
+static void _stmt_cache_queue_free(gpointer data)
+{
+  g_queue_free_full((GQueue *)data, _stmt_finalize);
+}
+
+gchar *_get_pragma_string_val(sqlite3 *db, const char *pragma);
+
+static void _readers_open(dt_database_t *db)
+{
+  const int count = CLAMP(dt_conf_get_int("database/reader_connections"), 0, 8);
+  // readers need the files, in-memory databases are private to their connection
+  if(count == 0 || !g_strcmp0(db->dbfilename_library, ":memory:") || !g_strcmp0(db->dbfilename_data, ":memory:"))
+    return;
+
+  // with write-ahead logging readers neither block the primary connection nor get blocked by it
+  gchar *mode_main = _get_pragma_string_val(db->handle, "main.journal_mode = WAL");
+  gchar *mode_data = _get_pragma_string_val(db->handle, "data.journal_mode = WAL");
+  db->wal = !g_strcmp0(mode_main, "wal") && !g_strcmp0(mode_data, "wal");
+  g_free(mode_main);
+  g_free(mode_data);
+  if(!db->wal)
+  {
+    fprintf(stderr, "[init] can't switch the database to write-ahead logging, no read-only connections\n");
+    sqlite3_exec(db->handle, "PRAGMA main.journal_mode = MEMORY", NULL, NULL, NULL);
+    sqlite3_exec(db->handle, "PRAGMA data.journal_mode = MEMORY", NULL, NULL, NULL);
+    return;
+  }
+
+  for(int k = 0; k < count; k++)
+  {
+    sqlite3 *handle = NULL;
+    sqlite3_stmt *stmt = NULL;
+    // attached databases are opened read-only as well
+    if(sqlite3_open_v2(db->dbfilename_library, &handle, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL)
+       != SQLITE_OK
+       || sqlite3_prepare_v2(handle, "ATTACH DATABASE ?1 AS data", -1, &stmt, NULL) != SQLITE_OK
+       || sqlite3_bind_text(stmt, 1, db->dbfilename_data, -1, SQLITE_TRANSIENT) != SQLITE_OK
+       || sqlite3_step(stmt) != SQLITE_DONE)
+    {
+      fprintf(stderr, "[init] can't open read-only database connection: %s\n", sqlite3_errmsg(handle));
+      sqlite3_finalize(stmt);
+      sqlite3_close(handle);
+      break;
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_busy_timeout(handle, 1000);
+
+    dt_database_reader_t *reader = g_malloc0(sizeof(dt_database_reader_t));
+    reader->handle = handle;
+    reader->stmt_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _stmt_cache_queue_free);
+    db->readers = g_list_prepend(db->readers, reader);
+    g_queue_push_tail(db->readers_idle, reader);
+  }
+
+  dt_print(DT_DEBUG_SQL, "[init] %d read-only database connections\n", g_list_length(db->readers));
+}
+
+static void _readers_close(dt_database_t *db)
+{
+  for(GList *l = db->readers; l; l = g_list_next(l))
+  {
+    dt_database_reader_t *reader = (dt_database_reader_t *)l->data;
+    g_hash_table_destroy(reader->stmt_cache);
+    sqlite3_close(reader->handle);
+    g_free(reader);
+  }
+  g_list_free(db->readers);
+  db->readers = NULL;
+  g_queue_clear(db->readers_idle);
+
+  // leave the files in the usual rollback journal mode when we are done
+  if(db->wal)
+  {
+    sqlite3_exec(db->handle, "PRAGMA main.journal_mode = DELETE", NULL, NULL, NULL);
+    sqlite3_exec(db->handle, "PRAGMA data.journal_mode = DELETE", NULL, NULL, NULL);
+    db->wal = FALSE;
+  }
+}
+
+static void _stmt_cache_clear(const dt_database_t *db)
+{
+  dt_database_t *d = (dt_database_t *)db;
+  dt_pthread_mutex_lock(&d->stmt_cache_lock);
+  g_hash_table_remove_all(d->stmt_cache);
+  d->stmt_cache_count = 0;
+  dt_pthread_mutex_unlock(&d->stmt_cache_lock);
+}
+
 
 /* migrates database from old place to new */
 static void _database_migrate_to_xdg_structure();
@@ -2862,6 +2979,10 @@ start:
   dt_database_t *db = (dt_database_t *)g_malloc0(sizeof(dt_database_t));
   db->dbfilename_data = g_strdup(dbfilename_data);
   db->dbfilename_library = g_strdup(dbfilename_library);
+  dt_pthread_mutex_init(&db->stmt_cache_lock, NULL);
+  db->stmt_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _stmt_cache_queue_free);
+  dt_pthread_mutex_init(&db->readers_lock, NULL);
+  db->readers_idle = g_queue_new();
 
   /* make sure the folder exists. this might not be the case for new databases */
   /* also check if a database backup is needed */
@@ -3372,6 +3493,9 @@ start:
   }
 #endif
 
+  // the schema is in place now, open the read-only connections
+  _readers_open(db);
+
 error:
   g_free(dbname);
 
@@ -3380,6 +3504,19 @@ error:
 
 void dt_database_destroy(const dt_database_t *db)
 {
+  dt_print(DT_DEBUG_SQL | DT_DEBUG_PERF,
+           "[sql] statement cache: %" PRIu64 " prepares avoided, %" PRIu64 " statements prepared\n",
+           db->stmt_cache_hits, db->stmt_cache_misses);
+  dt_print(DT_DEBUG_SQL | DT_DEBUG_PERF,
+           "[sql] read-only connections: %" PRIu64 " queries served, %" PRIu64 " fell back to the main connection\n",
+           db->reader_hits, db->reader_misses);
+  _readers_close((dt_database_t *)db);
+  g_queue_free(db->readers_idle);
+  dt_pthread_mutex_destroy(&((dt_database_t *)db)->readers_lock);
+  _stmt_cache_clear(db);
+  g_hash_table_destroy(db->stmt_cache);
+  dt_pthread_mutex_destroy(&((dt_database_t *)db)->stmt_cache_lock);
+
   sqlite3_close(db->handle);
   if (db->lockfile_data)
   {
@@ -3403,6 +3540,127 @@ sqlite3 *dt_database_get(const dt_database_t *db)
   return db ? db->handle : NULL;
 }
 
+sqlite3_stmt *dt_database_prepare_cached(const struct dt_database_t *db, const char *sql)
+{
+  dt_database_t *d = (dt_database_t *)db;
+  sqlite3_stmt *stmt = NULL;
+
+  dt_pthread_mutex_lock(&d->stmt_cache_lock);
+  GQueue *idle = g_hash_table_lookup(d->stmt_cache, sql);
+  if(idle) stmt = g_queue_pop_head(idle);
+  if(stmt)
+  {
+    d->stmt_cache_count--;
+    d->stmt_cache_hits++;
+  }
+  else
+    d->stmt_cache_misses++;
+  dt_pthread_mutex_unlock(&d->stmt_cache_lock);
+
+  if(!stmt && sqlite3_prepare_v2(d->handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+  {
+    fprintf(stderr, "sqlite3 error: query \"%s\": %s\n", sql, sqlite3_errmsg(d->handle));
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+  }
+
+  return stmt;
+}
+
+sqlite3_stmt *dt_database_prepare_cached_readonly(const struct dt_database_t *db, const char *sql)
+{
+  dt_database_t *d = (dt_database_t *)db;
+
+  // the gui thread keeps the main connection. so do callers while a transaction is open there,
+  // they might want to see their own uncommitted changes.
+  if(!d->readers || !darktable.control || pthread_equal(darktable.control->gui_thread, pthread_self())
+     || !sqlite3_get_autocommit(d->handle))
+    return dt_database_prepare_cached(db, sql);
+
+  dt_pthread_mutex_lock(&d->readers_lock);
+  dt_database_reader_t *reader = g_queue_pop_head(d->readers_idle);
+  if(reader)
+    d->reader_hits++;
+  else
+    d->reader_misses++;
+  dt_pthread_mutex_unlock(&d->readers_lock);
+
+  // all readers are busy
+  if(!reader) return dt_database_prepare_cached(db, sql);
+
+  // the reader stays with the statement until it is released
+  sqlite3_stmt *stmt = NULL;
+  GQueue *idle = g_hash_table_lookup(reader->stmt_cache, sql);
+  if(idle) stmt = g_queue_pop_head(idle);
+  if(!stmt && sqlite3_prepare_v2(reader->handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+  {
+    fprintf(stderr, "sqlite3 error: query \"%s\" on read-only connection: %s\n", sql,
+            sqlite3_errmsg(reader->handle));
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+  }
+
+  if(stmt) return stmt;
+
+  dt_pthread_mutex_lock(&d->readers_lock);
+  g_queue_push_head(d->readers_idle, reader);
+  dt_pthread_mutex_unlock(&d->readers_lock);
+  return dt_database_prepare_cached(db, sql);
+}
+
+void dt_database_release_cached(const struct dt_database_t *db, sqlite3_stmt *stmt)
+{
+  if(!stmt) return;
+  dt_database_t *d = (dt_database_t *)db;
+
+  // make it look like a freshly prepared statement for the next user
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  // statements of a reader go back into its own cache, then the reader is free again
+  sqlite3 *handle = sqlite3_db_handle(stmt);
+  if(handle != d->handle)
+  {
+    for(GList *l = d->readers; l; l = g_list_next(l))
+    {
+      dt_database_reader_t *reader = (dt_database_reader_t *)l->data;
+      if(reader->handle != handle) continue;
+
+      const char *sql = sqlite3_sql(stmt);
+      GQueue *idle = g_hash_table_lookup(reader->stmt_cache, sql);
+      if(!idle)
+      {
+        idle = g_queue_new();
+        g_hash_table_insert(reader->stmt_cache, g_strdup(sql), idle);
+      }
+      g_queue_push_head(idle, stmt);
+
+      dt_pthread_mutex_lock(&d->readers_lock);
+      g_queue_push_head(d->readers_idle, reader);
+      dt_pthread_mutex_unlock(&d->readers_lock);
+      return;
+    }
+  }
+
+  dt_pthread_mutex_lock(&d->stmt_cache_lock);
+  if(d->stmt_cache_count < DT_DATABASE_STMT_CACHE_MAX)
+  {
+    const char *sql = sqlite3_sql(stmt);
+    GQueue *idle = g_hash_table_lookup(d->stmt_cache, sql);
+    if(!idle)
+    {
+      idle = g_queue_new();
+      g_hash_table_insert(d->stmt_cache, g_strdup(sql), idle);
+    }
+    g_queue_push_head(idle, stmt);
+    d->stmt_cache_count++;
+    stmt = NULL;
+  }
+  dt_pthread_mutex_unlock(&d->stmt_cache_lock);
+
+  sqlite3_finalize(stmt);
+}
+
 const gchar *dt_database_get_path(const struct dt_database_t *db)
 {
   return db->dbfilename_library;
@@ -3465,6 +3723,9 @@ gboolean dt_database_get_lock_acquired(const dt_database_t *db)
 
 void dt_database_cleanup_busy_statements(const struct dt_database_t *db)
 {
+  // the cached statements are not busy, don't leave dangling pointers in the cache
+  _stmt_cache_clear(db);
+
   sqlite3_stmt *stmt = NULL;
   while( (stmt = sqlite3_next_stmt(db->handle, NULL)) != NULL)
   {
@@ -28,6 +28,15 @@ struct dt_database_t *dt_database_init(const char *alternative, const gboolean l
 void dt_database_destroy(const struct dt_database_t *);
 /** get handle */
 struct sqlite3 *dt_database_get(const struct dt_database_t *);
+/** get a prepared statement for a constant query. it is taken from a cache of idle statements if possible
+    and has to be given back with dt_database_release_cached() instead of sqlite3_finalize() */
+struct sqlite3_stmt *dt_database_prepare_cached(const struct dt_database_t *db, const char *sql);
+/** same for read-only queries on the main and data databases. called from a background thread the statement
+    runs on one of the read-only connections if one is free, so it doesn't wait for the main connection.
+    the memory tables can't be reached that way. */
+struct sqlite3_stmt *dt_database_prepare_cached_readonly(const struct dt_database_t *db, const char *sql);
+/** reset a statement from dt_database_prepare_cached*() and put it back into the cache */
+void dt_database_release_cached(const struct dt_database_t *db, struct sqlite3_stmt *stmt);
 /** Returns database path */
 const gchar *dt_database_get_path(const struct dt_database_t *db);
 /** test if database was already locked by another instance */
@@ -98,6 +98,29 @@
     __DT_DEBUG_SQL_QUERY__(b)                                                                                     \
   } while(0)
 
+// same for constant queries run very often, the statement comes from the statement cache of the database
+// (not the sqlite3 handle) and is given back with DT_DEBUG_SQLITE3_RELEASE instead of sqlite3_finalize
+#define DT_DEBUG_SQLITE3_PREPARE_CACHED(a, b, c)                                                                  \
+  do                                                                                                              \
+  {                                                                                                               \
+    dt_print(DT_DEBUG_SQL, "[sql] %s:%d, function %s(): prepare cached \"%s\"\n", __FILE__, __LINE__,             \
+             __FUNCTION__, (b));                                                                                  \
+    *(c) = dt_database_prepare_cached(a, b);                                                                      \
+    __DT_DEBUG_SQL_QUERY__(b)                                                                                     \
+  } while(0)
+
+// read-only queries on main and data, see dt_database_prepare_cached_readonly()
+#define DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(a, b, c)                                                         \
+  do                                                                                                              \
+  {                                                                                                               \
+    dt_print(DT_DEBUG_SQL, "[sql] %s:%d, function %s(): prepare cached read-only \"%s\"\n", __FILE__, __LINE__, \
+             __FUNCTION__, (b));                                                                                  \
+    *(c) = dt_database_prepare_cached_readonly(a, b);                                                             \
+    __DT_DEBUG_SQL_QUERY__(b)                                                                                     \
+  } while(0)
+
+#define DT_DEBUG_SQLITE3_RELEASE(a, b) dt_database_release_cached(a, b)
+
 #define DT_DEBUG_SQLITE3_BIND_INT(a, b, c) __DT_DEBUG_ASSERT__(sqlite3_bind_int(a, b, c))
 #define DT_DEBUG_SQLITE3_BIND_INT64(a, b, c) __DT_DEBUG_ASSERT__(sqlite3_bind_int64(a, b, c))
 #define DT_DEBUG_SQLITE3_BIND_DOUBLE(a, b, c) __DT_DEBUG_ASSERT__(sqlite3_bind_double(a, b, c))
@@ -25,6 +25,7 @@ extern "C" {
 
 #include <errno.h>
 #include <glib.h>
+#include <inttypes.h>
 #include <sqlite3.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -39,6 +40,7 @@ extern "C" {
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <list>
 #include <sstream>
 #include <string>
 
@@ -65,6 +67,7 @@ extern "C" {
 #include "common/metadata.h"
 #include "common/ratings.h"
 #include "common/tags.h"
+#include "common/tag_index.h"
 #include "common/iop_order.h"
 #include "common/variables.h"
 #include "common/utility.h"
@@ -279,8 +282,10 @@ static const char *_exif_get_exiv2_tag_type(const char *tagname)
 class Lock
 {
 public:
-  Lock() { dt_pthread_mutex_lock(&darktable.exiv2_threadsafe); }
-  ~Lock() { dt_pthread_mutex_unlock(&darktable.exiv2_threadsafe); }
+  Lock(dt_pthread_mutex_t *m = &darktable.exiv2_threadsafe) : mutex(m) { dt_pthread_mutex_lock(mutex); }
+  ~Lock() { dt_pthread_mutex_unlock(mutex); }
+private:
+  dt_pthread_mutex_t *mutex;
 };
 
 #define read_metadata_threadsafe(image)                       \
@@ -289,6 +294,73 @@ public:
   image->readMetadata();                                      \
 }
 
+// parsed metadata of an image file. import, thumbnail generation and export all need the
+// metadata of the same original, so we keep the last few around instead of parsing the
+// file (and its maker notes) again every time. entries are keyed by path, mtime and size,
+// so a changed file is read again.
+#define DT_EXIF_METADATA_CACHE_SIZE 64
+
+typedef struct dt_exif_metadata_t
+{
+  Exiv2::ExifData exifData;
+  Exiv2::IptcData iptcData;
+  Exiv2::XmpData xmpData;
+  int width, height;
+} dt_exif_metadata_t;
+
+typedef struct dt_exif_metadata_cache_entry_t
+{
+  std::string path;
+  time_t mtime;
+  off_t size;
+  dt_exif_metadata_t metadata;
+} dt_exif_metadata_cache_entry_t;
+
+static std::list<dt_exif_metadata_cache_entry_t> _exif_metadata_cache; // most recently used first
+static dt_pthread_mutex_t _exif_metadata_cache_mutex;
+static uint64_t _exif_metadata_cache_hits = 0, _exif_metadata_cache_misses = 0;
+
+// fills metadata with a copy of what is in the file, so the caller is free to modify it.
+// throws like Exiv2::ImageFactory::open() and readMetadata() do.
+static void _exif_read_metadata_cached(const char *path, dt_exif_metadata_t &metadata)
+{
+  struct stat statbuf;
+  const bool cacheable = !stat(path, &statbuf) && S_ISREG(statbuf.st_mode);
+  if(cacheable)
+  {
+    Lock lock(&_exif_metadata_cache_mutex);
+    for(auto it = _exif_metadata_cache.begin(); it != _exif_metadata_cache.end(); ++it)
+    {
+      if(it->mtime == statbuf.st_mtime && it->size == statbuf.st_size && it->path == path)
+      {
+        _exif_metadata_cache.splice(_exif_metadata_cache.begin(), _exif_metadata_cache, it);
+        metadata = it->metadata;
+        _exif_metadata_cache_hits++;
+        return;
+      }
+    }
+  }
+
+  std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
+  assert(image.get() != 0);
+  read_metadata_threadsafe(image);
+  metadata.exifData = image->exifData();
+  metadata.iptcData = image->iptcData();
+  metadata.xmpData = image->xmpData();
+  metadata.width = image->pixelWidth();
+  metadata.height = image->pixelHeight();
+
+  if(cacheable)
+  {
+    Lock lock(&_exif_metadata_cache_mutex);
+    _exif_metadata_cache_misses++;
+    // drop an outdated version of this file
+    _exif_metadata_cache.remove_if([path](const dt_exif_metadata_cache_entry_t &e) { return e.path == path; });
+    _exif_metadata_cache.push_front({ path, statbuf.st_mtime, statbuf.st_size, metadata });
+    if(_exif_metadata_cache.size() > DT_EXIF_METADATA_CACHE_SIZE) _exif_metadata_cache.pop_back();
+  }
+}
+
 static void _exif_import_tags(dt_image_t *img, Exiv2::XmpData::iterator &pos);
 static void read_xmp_timestamps(Exiv2::XmpData &xmpData, dt_image_t *img);
 
@@ -670,10 +742,9 @@ void dt_exif_img_check_usercrop(dt_image_t *img, const char *filename)
 {
   try
   {
-    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(filename)));
-    assert(image.get() != 0);
-    read_metadata_threadsafe(image);
-    Exiv2::ExifData &exifData = image->exifData();
+    dt_exif_metadata_t metadata;
+    _exif_read_metadata_cached(filename, metadata);
+    Exiv2::ExifData &exifData = metadata.exifData;
     if(!exifData.empty()) dt_check_usercrop(exifData, img);
     return;
   }
@@ -1379,12 +1450,24 @@ int dt_exif_get_thumbnail(const char *path, uint8_t **buffer, size_t *size, char
   {
     std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
     assert(image.get() != 0);
-    read_metadata_threadsafe(image);
+
+    // the preview loaders locate the embedded images through the exif and xmp data, so hand them the
+    // cached metadata instead of parsing the file again. only the preview itself is read from the file.
+    dt_exif_metadata_t metadata;
+    _exif_read_metadata_cached(path, metadata);
+    image->setExifData(metadata.exifData);
+    image->setXmpData(metadata.xmpData);
 
     // Get a list of preview images available in the image. The list is sorted
     // by the preview image pixel size, starting with the smallest preview.
+    Exiv2::PreviewPropertiesList list = Exiv2::PreviewManager(*image).getPreviewProperties();
+    if(list.empty())
+    {
+      // some formats only know their previews after a full read, e.g. native previews of psd files
+      read_metadata_threadsafe(image);
+      list = Exiv2::PreviewManager(*image).getPreviewProperties();
+    }
     Exiv2::PreviewManager loader(*image);
-    Exiv2::PreviewPropertiesList list = loader.getPreviewProperties();
     if(list.empty())
     {
       dt_print(DT_DEBUG_LIGHTTABLE, "[exiv2 dt_exif_get_thumbnail] couldn't find thumbnail for %s", path);
@@ -1439,13 +1522,12 @@ int dt_exif_read(dt_image_t *img, const char *path)
 
   try
   {
-    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
-    assert(image.get() != 0);
-    read_metadata_threadsafe(image);
+    dt_exif_metadata_t metadata;
+    _exif_read_metadata_cached(path, metadata);
     bool res = true;
 
     // EXIF metadata
-    Exiv2::ExifData &exifData = image->exifData();
+    Exiv2::ExifData &exifData = metadata.exifData;
     if(!exifData.empty())
     {
       res = _exif_decode_exif_data(img, exifData);
@@ -1468,19 +1550,19 @@ int dt_exif_read(dt_image_t *img, const char *path)
     dt_exif_apply_default_metadata(img);
 
     // IPTC metadata.
-    Exiv2::IptcData &iptcData = image->iptcData();
+    Exiv2::IptcData &iptcData = metadata.iptcData;
     if(!iptcData.empty()) res = _exif_decode_iptc_data(img, iptcData) && res;
 
     // XMP metadata
-    Exiv2::XmpData &xmpData = image->xmpData();
+    Exiv2::XmpData &xmpData = metadata.xmpData;
     if(!xmpData.empty())
       res = _exif_decode_xmp_data(img, xmpData, -1, true) && res;
 
     // Initialize size - don't wait for full raw to be loaded to get this
     // information. If use_embedded_thumbnail is set, it will take a
     // change in development history to have this information
-    img->height = image->pixelHeight();
-    img->width = image->pixelWidth();
+    img->height = metadata.height;
+    img->width = metadata.width;
 
     return res ? 0 : 1;
   }
@@ -1572,10 +1654,9 @@ int dt_exif_read_blob(uint8_t **buf, const char *path, const int imgid, const in
   *buf = NULL;
   try
   {
-    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
-    assert(image.get() != 0);
-    read_metadata_threadsafe(image);
-    Exiv2::ExifData &exifData = image->exifData();
+    dt_exif_metadata_t metadata;
+    _exif_read_metadata_cached(path, metadata);
+    Exiv2::ExifData &exifData = metadata.exifData;
 
     // get rid of thumbnails
     Exiv2::ExifThumb(exifData).erase();
@@ -2103,6 +2184,7 @@ static void _exif_import_tags(dt_image_t *img, Exiv2::XmpData::iterator &pos)
   sqlite3_finalize(stmt_sel_id);
   sqlite3_finalize(stmt_ins_tags);
   sqlite3_finalize(stmt_ins_tagged);
+  dt_tag_index_image_reload(darktable.tag_index, img->id);
 }
 
 typedef struct history_entry_t
@@ -3829,13 +3911,10 @@ int dt_exif_xmp_attach_export(const int imgid, const char *filename, void *metad
     try
     {
       // initialize XMP and IPTC data with the one from the original file
-      std::unique_ptr<Exiv2::Image> input_image(Exiv2::ImageFactory::open(WIDEN(input_filename)));
-      if(input_image.get() != 0)
-      {
-        read_metadata_threadsafe(input_image);
-        img->setIptcData(input_image->iptcData());
-        img->setXmpData(input_image->xmpData());
-      }
+      dt_exif_metadata_t metadata;
+      _exif_read_metadata_cached(input_filename, metadata);
+      img->setIptcData(metadata.iptcData);
+      img->setXmpData(metadata.xmpData);
     }
     catch(Exiv2::AnyError &e)
     {
@@ -4026,9 +4105,37 @@ int dt_exif_xmp_attach_export(const int imgid, const char *filename, void *metad
   }
 }
 
+// checksum of the xmp packet generated from the database alone, without merging an existing sidecar.
+// used by the sidecar writer to detect that nothing changed since the last write without touching the file.
+char *dt_exif_xmp_database_checksum(const int imgid)
+{
+  try
+  {
+    Exiv2::XmpData xmpData;
+    std::string xmpPacket;
+    _exif_xmp_read_data(xmpData, imgid);
+    if(Exiv2::XmpParser::encode(xmpPacket, xmpData,
+       Exiv2::XmpParser::useCompactFormat | Exiv2::XmpParser::omitPacketWrapper) != 0)
+      return NULL;
+    return g_compute_checksum_for_string(G_CHECKSUM_MD5, xmpPacket.c_str(), -1);
+  }
+  catch(Exiv2::AnyError &e)
+  {
+    std::cerr << "[dt_exif_xmp_database_checksum] " << imgid << ": caught exiv2 exception '" << e << "'\n";
+    return NULL;
+  }
+}
+
 // write xmp sidecar file:
 int dt_exif_xmp_write(const int imgid, const char *filename)
 {
+  return dt_exif_xmp_write_with_status(imgid, filename, NULL);
+}
+
+int dt_exif_xmp_write_with_status(const int imgid, const char *filename, gboolean *written)
+{
+  if(written) *written = FALSE;
+
   // refuse to write sidecar for non-existent image:
   char imgfname[PATH_MAX] = { 0 };
   gboolean from_cache = TRUE;
@@ -4046,22 +4153,23 @@ int dt_exif_xmp_write(const int imgid, const char *filename)
       // we want to avoid writing the sidecar file if it didn't change to avoid issues when using the same images
       // from different computers. sample use case: images on NAS, several computers using them NOT AT THE SAME TIME and
       // the xmp crawler is used to find changed sidecars.
+      // the file is read once and used for both the checksum and the decoding of foreign keys.
       errno = 0;
       size_t end;
       unsigned char *content = (unsigned char*)dt_read_file(filename, &end);
       if(content)
       {
         checksum_old = g_compute_checksum_for_data(G_CHECKSUM_MD5, content, end);
+        xmpPacket.assign(reinterpret_cast<char *>(content), end);
         free(content);
       }
       else
       {
         fprintf(stderr, "cannot read xmp file '%s': '%s'\n", filename, strerror(errno));
         dt_control_log(_("cannot read xmp file '%s': '%s'"), filename, strerror(errno));
+        Exiv2::DataBuf buf = Exiv2::readFile(WIDEN(filename));
+        xmpPacket.assign(reinterpret_cast<char *>(buf.pData_), buf.size_);
       }
-
-      Exiv2::DataBuf buf = Exiv2::readFile(WIDEN(filename));
-      xmpPacket.assign(reinterpret_cast<char *>(buf.pData_), buf.size_);
       Exiv2::XmpParser::decode(xmpData, xmpPacket);
       // because XmpSeq or XmpBag are added to the list, we first have
       // to remove these so that we don't end up with a string of duplicates
@@ -4105,6 +4213,7 @@ int dt_exif_xmp_write(const int imgid, const char *filename)
         fprintf(fout, "%s", xml_header);
         fprintf(fout, "%s", xmpPacket.c_str());
         fclose(fout);
+        if(written) *written = TRUE;
       }
       else
       {
@@ -4220,6 +4329,8 @@ static void dt_exif_log_handler(int log_level, const char *message)
 
 void dt_exif_init()
 {
+  dt_pthread_mutex_init(&_exif_metadata_cache_mutex, NULL);
+
   // preface the exiv2 messages with "[exiv2] "
   Exiv2::LogMsg::setHandler(&dt_exif_log_handler);
 
@@ -4249,6 +4360,11 @@ void dt_exif_init()
 
 void dt_exif_cleanup()
 {
+  dt_print(DT_DEBUG_CACHE, "[exif] metadata cache: %" PRIu64 " hits, %" PRIu64 " misses\n",
+           _exif_metadata_cache_hits, _exif_metadata_cache_misses);
+  _exif_metadata_cache.clear();
+  dt_pthread_mutex_destroy(&_exif_metadata_cache_mutex);
+
   Exiv2::XmpParser::terminate();
 }
 
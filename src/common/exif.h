@@ -54,6 +54,12 @@ int dt_exif_write_blob(uint8_t *blob, uint32_t size, const char *path, const int
 /** write xmp sidecar file. */
 int dt_exif_xmp_write(const int imgid, const char *filename);
 
+/** write xmp sidecar file, *written tells whether the file content actually changed. */
+int dt_exif_xmp_write_with_status(const int imgid, const char *filename, gboolean *written);
+
+/** md5 of the xmp packet built from the database only, NULL on failure. free with g_free(). */
+char *dt_exif_xmp_database_checksum(const int imgid);
+
 /** write xmp packet inside an image. */
 int dt_exif_xmp_attach_export(const int imgid, const char *filename, void *metadata);
 
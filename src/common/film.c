@@ -21,6 +21,7 @@
 #include "common/debug.h"
 #include "common/dtpthread.h"
 #include "common/image_cache.h"
+#include "common/tag_index.h"
 #include "common/tags.h"
 #include "control/conf.h"
 #include "control/control.h"
@@ -445,6 +446,7 @@ void dt_film_remove(const int id)
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, id);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_invalidate(darktable.tag_index);
   // dt_control_update_recent_films();
 
   DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_FILMROLLS_CHANGED);
@@ -0,0 +1,114 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// conversion between 32 bit floats and IEEE 754 half precision floats stored as uint16_t.
+// uses the F16C instructions if the compiler targets them, a bit twiddling version otherwise.
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+typedef union dt_fp32_t
+{
+  uint32_t u;
+  float f;
+} dt_fp32_t;
+
+static inline float dt_half_to_float(const uint16_t h)
+{
+#if defined(__F16C__)
+  return _cvtsh_ss(h);
+#else
+  /* from https://gist.github.com/rygorous/2156668 */
+  const dt_fp32_t magic = { 113 << 23 };
+  const uint32_t shifted_exp = 0x7c00 << 13; // exponent mask after shift
+  dt_fp32_t o;
+
+  o.u = (h & 0x7fff) << 13;           // exponent/mantissa bits
+  const uint32_t exp = shifted_exp & o.u; // just the exponent
+  o.u += (127 - 15) << 23;            // exponent adjust
+
+  // handle exponent special cases
+  if(exp == shifted_exp)  // Inf/NaN?
+    o.u += (128 - 16) << 23;          // extra exp adjust
+  else if(exp == 0)       // Zero/Denormal?
+  {
+    o.u += 1 << 23;                   // extra exp adjust
+    o.f -= magic.f;                   // renormalize
+  }
+
+  o.u |= (h & 0x8000) << 16;          // sign bit
+  return o.f;
+#endif
+}
+
+static inline uint16_t dt_float_to_half(const float f)
+{
+#if defined(__F16C__)
+  return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+  /* round to nearest even, from https://gist.github.com/rygorous/2156668 */
+  const uint32_t f32infty = 255u << 23;
+  const uint32_t f16max = (127u + 16u) << 23;
+  const dt_fp32_t denorm_magic = { ((127u - 15u) + (23u - 10u) + 1u) << 23 };
+  dt_fp32_t v = { .f = f };
+  uint16_t o;
+
+  const uint32_t sign = v.u & 0x80000000u;
+  v.u ^= sign;
+
+  if(v.u >= f16max)               // result is Inf or NaN (all exponent bits set)
+    o = (v.u > f32infty) ? 0x7e00 : 0x7c00; // NaN->qNaN and Inf->Inf
+  else if(v.u < (113u << 23))     // resulting half is subnormal or zero
+  {
+    // use a magic value to align our 10 mantissa bits at the bottom of
+    // the float. as long as FP addition is round-to-nearest-even this
+    // just works.
+    v.f += denorm_magic.f;
+    o = v.u - denorm_magic.u;
+  }
+  else
+  {
+    const uint32_t mant_odd = (v.u >> 13) & 1; // resulting mantissa is odd
+    v.u += ((15u - 127u) << 23) + 0xfffu;      // update exponent, rounding bias part 1
+    v.u += mant_odd;                           // rounding bias part 2
+    o = v.u >> 13;                             // take the bits!
+  }
+
+  return o | (sign >> 16);
+#endif
+}
+
+// convert n values, e.g. one row of a buffer
+static inline void dt_float_to_half_buf(uint16_t *const out, const float *const in, const size_t n)
+{
+  for(size_t k = 0; k < n; k++) out[k] = dt_float_to_half(in[k]);
+}
+
+static inline void dt_half_to_float_buf(float *const out, const uint16_t *const in, const size_t n)
+{
+  for(size_t k = 0; k < n; k++) out[k] = dt_half_to_float(in[k]);
+}
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
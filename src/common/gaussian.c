@@ -150,8 +150,170 @@ error:
 }
 
 
+// the blocked code path filters strips of GAUSS_BLOCK_COLS neighbouring columns at once and writes its result
+// transposed, so that the vertical and the horizontal pass both become a column pass over contiguous rows.
+// results are collected in tiles of GAUSS_BLOCK_ROWS rows before they are transposed into the output.
+// it is used for images of at least GAUSS_BLOCK_MIN_PIXELS pixels, below that the full columns fit into the
+// cache anyway.
+#define GAUSS_BLOCK_COLS 16
+#define GAUSS_BLOCK_ROWS 16
+#define GAUSS_BLOCK_LANES (4 * GAUSS_BLOCK_COLS)
+#define GAUSS_BLOCK_MIN_PIXELS (512 * 512)
+
+static inline int _gaussian_use_blocked(const dt_gaussian_t *g)
+{
+  return g->channels <= 4 && (size_t)g->width * g->height >= GAUSS_BLOCK_MIN_PIXELS;
+}
+
+// transpose a tile of nrows x ncols pixels into out, which has a row length of height pixels
+static inline void _gaussian_store_tile(float *const out, const float *const tile, const int height,
+                                        const int ncols, const int nrows, const int ch, const gboolean add)
+{
+  for(int c = 0; c < ncols; c++)
+  {
+    float *const o = out + (size_t)c * height * ch;
+    const float *const t = tile + c * ch;
+    if(ch == 4)
+    {
+      for(int r = 0; r < nrows; r++)
+        for(int k = 0; k < 4; k++)
+          o[r * 4 + k] = add ? o[r * 4 + k] + t[r * GAUSS_BLOCK_LANES + k] : t[r * GAUSS_BLOCK_LANES + k];
+    }
+    else
+    {
+      for(int r = 0; r < nrows; r++)
+        for(int k = 0; k < ch; k++)
+          o[r * ch + k] = add ? o[r * ch + k] + t[r * GAUSS_BLOCK_LANES + k] : t[r * GAUSS_BLOCK_LANES + k];
+    }
+  }
+}
+
+// recursive filter along the columns of in (width x height pixels with ch channels each),
+// stores the result transposed into out (height x width pixels).
+__DT_CLONE_TARGETS__
+static void _gaussian_columns_transposed(const float *const in, float *const out, const int width,
+                                         const int height, const int ch, const float *const Labmin,
+                                         const float *const Labmax, const float a0, const float a1,
+                                         const float a2, const float a3, const float b1, const float b2,
+                                         const float coefp, const float coefn)
+{
+  const int nstrips = (width + GAUSS_BLOCK_COLS - 1) / GAUSS_BLOCK_COLS;
+
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(in, out, width, height, ch, nstrips, Labmin, Labmax) \
+  dt_omp_firstprivate(a0, a1, a2, a3, b1, b2, coefp, coefn) \
+  schedule(static)
+#endif
+  for(int s = 0; s < nstrips; s++)
+  {
+    const int i0 = s * GAUSS_BLOCK_COLS;
+    const int ncols = MIN(GAUSS_BLOCK_COLS, width - i0);
+    const int lanes = ncols * ch;
+
+    // one simd lane per channel of each column in the strip
+    float DT_ALIGNED_ARRAY lmin[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY lmax[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY xp[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY xa[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY yb[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY yp[GAUSS_BLOCK_LANES];
+    float DT_ALIGNED_ARRAY tile[GAUSS_BLOCK_ROWS * GAUSS_BLOCK_LANES];
+
+    for(int l = 0; l < lanes; l++)
+    {
+      lmin[l] = Labmin[l % ch];
+      lmax[l] = Labmax[l % ch];
+    }
+
+    // forward filter
+    const float *const first = in + (size_t)i0 * ch;
+    for(int l = 0; l < lanes; l++)
+    {
+      xp[l] = CLAMPF(first[l], lmin[l], lmax[l]);
+      yb[l] = xp[l] * coefp;
+      yp[l] = yb[l];
+    }
+
+    for(int j0 = 0; j0 < height; j0 += GAUSS_BLOCK_ROWS)
+    {
+      const int nrows = MIN(GAUSS_BLOCK_ROWS, height - j0);
+      for(int r = 0; r < nrows; r++)
+      {
+        const float *const row = in + ((size_t)(j0 + r) * width + i0) * ch;
+        float *const yc = tile + r * GAUSS_BLOCK_LANES;
+#ifdef _OPENMP
+#pragma omp simd aligned(lmin, lmax, xp, yb, yp, yc : 64)
+#endif
+        for(int l = 0; l < lanes; l++)
+        {
+          const float xc = CLAMPF(row[l], lmin[l], lmax[l]);
+          yc[l] = (a0 * xc) + (a1 * xp[l]) - (b1 * yp[l]) - (b2 * yb[l]);
+          xp[l] = xc;
+          yb[l] = yp[l];
+          yp[l] = yc[l];
+        }
+      }
+      _gaussian_store_tile(out + ((size_t)i0 * height + j0) * ch, tile, height, ncols, nrows, ch, FALSE);
+    }
+
+    // backward filter, xp and yp take the roles of xn and yn, yb the one of ya
+    const float *const last = in + ((size_t)(height - 1) * width + i0) * ch;
+    for(int l = 0; l < lanes; l++)
+    {
+      xp[l] = CLAMPF(last[l], lmin[l], lmax[l]);
+      xa[l] = xp[l];
+      yp[l] = xp[l] * coefn;
+      yb[l] = yp[l];
+    }
+
+    for(int j0 = ((height - 1) / GAUSS_BLOCK_ROWS) * GAUSS_BLOCK_ROWS; j0 >= 0; j0 -= GAUSS_BLOCK_ROWS)
+    {
+      const int nrows = MIN(GAUSS_BLOCK_ROWS, height - j0);
+      for(int r = nrows - 1; r >= 0; r--)
+      {
+        const float *const row = in + ((size_t)(j0 + r) * width + i0) * ch;
+        float *const yc = tile + r * GAUSS_BLOCK_LANES;
+#ifdef _OPENMP
+#pragma omp simd aligned(lmin, lmax, xp, xa, yb, yp, yc : 64)
+#endif
+        for(int l = 0; l < lanes; l++)
+        {
+          const float xc = CLAMPF(row[l], lmin[l], lmax[l]);
+          yc[l] = (a2 * xp[l]) + (a3 * xa[l]) - (b1 * yp[l]) - (b2 * yb[l]);
+          xa[l] = xp[l];
+          xp[l] = xc;
+          yb[l] = yp[l];
+          yp[l] = yc[l];
+        }
+      }
+      _gaussian_store_tile(out + ((size_t)i0 * height + j0) * ch, tile, height, ncols, nrows, ch, TRUE);
+    }
+  }
+}
+
+// cache blocked version of dt_gaussian_blur: the vertical pass writes the transposed image into g->buf,
+// the horizontal pass filters its columns and transposes back into out.
+static void _gaussian_blur_blocked(dt_gaussian_t *g, const float *const in, float *const out)
+{
+  const int width = g->width;
+  const int height = g->height;
+  const int ch = MIN(4, g->channels);
+
+  float a0, a1, a2, a3, b1, b2, coefp, coefn;
+
+  compute_gauss_params(g->sigma, g->order, &a0, &a1, &a2, &a3, &b1, &b2, &coefp, &coefn);
+
+  _gaussian_columns_transposed(in, g->buf, width, height, ch, g->min, g->max, a0, a1, a2, a3, b1, b2, coefp,
+                               coefn);
+  _gaussian_columns_transposed(g->buf, out, height, width, ch, g->min, g->max, a0, a1, a2, a3, b1, b2, coefp,
+                               coefn);
+}
+
+
 void dt_gaussian_blur(dt_gaussian_t *g, const float *const in, float *const out)
 {
+  if(_gaussian_use_blocked(g)) return _gaussian_blur_blocked(g, in, out);
 
   const int width = g->width;
   const int height = g->height;
@@ -483,7 +645,7 @@ static void dt_gaussian_blur_4c_sse(dt_gaussian_t *g, const float *const in, flo
 
 void dt_gaussian_blur_4c(dt_gaussian_t *g, const float *const in, float *const out)
 {
-  if(darktable.codepath.OPENMP_SIMD) return dt_gaussian_blur(g, in, out);
+  if(darktable.codepath.OPENMP_SIMD || _gaussian_use_blocked(g)) return dt_gaussian_blur(g, in, out);
 #if defined(__SSE__)
   else if(darktable.codepath.SSE2)
     return dt_gaussian_blur_4c_sse(g, in, out);
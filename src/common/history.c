@@ -474,103 +474,187 @@ int dt_history_merge_module_into_history(dt_develop_t *dev_dest, dt_develop_t *d
   return module_added;
 }
 
-static int _history_copy_and_paste_on_image_merge(int32_t imgid, int32_t dest_imgid, GList *ops, const gboolean copy_full)
+// the source side of a paste, decoded once and shared by all destination images
+typedef struct _history_paste_t
 {
-  GList *modules_used = NULL;
-
-  dt_develop_t _dev_src = { 0 };
-  dt_develop_t _dev_dest = { 0 };
-
-  dt_develop_t *dev_src = &_dev_src;
-  dt_develop_t *dev_dest = &_dev_dest;
+  int32_t imgid;
+  gboolean merge;
+  GList *ops;
+  gboolean copy_full;
+
+  // source history loaded into a develop, only needed to merge modules
+  dt_develop_t dev_src;
+  gboolean dev_src_loaded;
+  GList *mod_list;
+
+  // module order of the source image
+  GList *iop_list;
+
+  // modules skipped when copying the whole history and the history end of the source image
+  gchar *skip_modules;
+  int history_end;
+} _history_paste_t;
+
+static void _history_paste_init(_history_paste_t *p, const int32_t imgid, const gboolean merge, GList *ops,
+                                const gboolean copy_iop_order, const gboolean copy_full)
+{
+  memset(p, 0, sizeof(_history_paste_t));
+  p->imgid = imgid;
+  p->merge = merge;
+  p->ops = ops;
+  p->copy_full = copy_full;
 
-  // we will do the copy/paste on memory so we can deal with masks
-  dt_dev_init(dev_src, FALSE);
-  dt_dev_init(dev_dest, FALSE);
+  if(copy_iop_order) p->iop_list = dt_ioppr_get_iop_order_list(imgid, FALSE);
 
-  dev_src->iop = dt_iop_load_modules_ext(dev_src, TRUE);
-  dev_dest->iop = dt_iop_load_modules_ext(dev_dest, TRUE);
+  if(merge || ops)
+  {
+    dt_develop_t *dev_src = &p->dev_src;
 
-  dt_dev_read_history_ext(dev_src, imgid, TRUE);
+    // we will do the copy/paste on memory so we can deal with masks
+    dt_dev_init(dev_src, FALSE);
+    dev_src->iop = dt_iop_load_modules_ext(dev_src, TRUE);
+    dt_dev_read_history_ext(dev_src, imgid, TRUE);
 
-  // This prepends the default modules and converts just in case it's an empty history
-  dt_dev_read_history_ext(dev_dest, dest_imgid, TRUE);
+    dt_ioppr_check_iop_order(dev_src, imgid, "_history_paste_init ");
 
-  dt_ioppr_check_iop_order(dev_src, imgid, "_history_copy_and_paste_on_image_merge ");
-  dt_ioppr_check_iop_order(dev_dest, dest_imgid, "_history_copy_and_paste_on_image_merge ");
+    dt_dev_pop_history_items_ext(dev_src, dev_src->history_end);
 
-  dt_dev_pop_history_items_ext(dev_src, dev_src->history_end);
-  dt_dev_pop_history_items_ext(dev_dest, dev_dest->history_end);
+    dt_ioppr_check_iop_order(dev_src, imgid, "_history_paste_init 1");
 
-  dt_ioppr_check_iop_order(dev_src, imgid, "_history_copy_and_paste_on_image_merge 1");
-  dt_ioppr_check_iop_order(dev_dest, dest_imgid, "_history_copy_and_paste_on_image_merge 1");
+    p->dev_src_loaded = TRUE;
 
-  GList *mod_list = NULL;
+    GList *mod_list = NULL;
 
-  if(ops)
-  {
-    if (DT_IOP_ORDER_INFO) fprintf(stderr," selected ops");
-    // copy only selected history entries
-    for(const GList *l = g_list_last(ops); l; l = g_list_previous(l))
+    if(ops)
     {
-      const unsigned int num = GPOINTER_TO_UINT(l->data);
+      if (DT_IOP_ORDER_INFO) fprintf(stderr," selected ops");
+      // copy only selected history entries
+      for(const GList *l = g_list_last(ops); l; l = g_list_previous(l))
+      {
+        const unsigned int num = GPOINTER_TO_UINT(l->data);
 
-      const dt_dev_history_item_t *hist = g_list_nth_data(dev_src->history, num);
+        const dt_dev_history_item_t *hist = g_list_nth_data(dev_src->history, num);
 
-      if(hist)
-      {
-        if (!dt_iop_is_hidden(hist->module))
+        if(hist)
         {
-          if (DT_IOP_ORDER_INFO)
-            fprintf(stderr,"\n  module %20s, multiprio %i",  hist->module->op, hist->module->multi_priority);
+          if (!dt_iop_is_hidden(hist->module))
+          {
+            if (DT_IOP_ORDER_INFO)
+              fprintf(stderr,"\n  module %20s, multiprio %i",  hist->module->op, hist->module->multi_priority);
 
-          mod_list = g_list_prepend(mod_list, hist->module);
+            mod_list = g_list_prepend(mod_list, hist->module);
+          }
+        }
+      }
+    }
+    else
+    {
+      if (DT_IOP_ORDER_INFO) fprintf(stderr," all modules");
+      // we will copy all modules
+      for(GList *modules_src = dev_src->iop; modules_src; modules_src = g_list_next(modules_src))
+      {
+        dt_iop_module_t *mod_src = (dt_iop_module_t *)(modules_src->data);
+
+        // copy from history only if
+        if((_search_history_by_module(dev_src, mod_src) != NULL) // module is in history of source image
+           && !(mod_src->default_enabled && mod_src->enabled
+                && !memcmp(mod_src->params, mod_src->default_params, mod_src->params_size) // it's not a enabled by default module with unmodified settings
+                && !dt_iop_is_hidden(mod_src))
+           && (copy_full || !dt_history_module_skip_copy(mod_src->flags()))
+          )
+        {
+          mod_list = g_list_prepend(mod_list, mod_src);
         }
       }
     }
+    if (DT_IOP_ORDER_INFO) fprintf(stderr,"\nvvvvv\n");
+
+    p->mod_list = g_list_reverse(mod_list);   // list was built in reverse order, so un-reverse it
   }
-  else
+
+  if(!merge && !ops)
   {
-    if (DT_IOP_ORDER_INFO) fprintf(stderr," all modules");
-    // we will copy all modules
-    for(GList *modules_src = dev_src->iop; modules_src; modules_src = g_list_next(modules_src))
+    // let's build the list of IOP to not copy
+    if(!copy_full)
     {
-      dt_iop_module_t *mod_src = (dt_iop_module_t *)(modules_src->data);
-
-      // copy from history only if
-      if((_search_history_by_module(dev_src, mod_src) != NULL) // module is in history of source image
-         && !(mod_src->default_enabled && mod_src->enabled
-              && !memcmp(mod_src->params, mod_src->default_params, mod_src->params_size) // it's not a enabled by default module with unmodified settings
-              && !dt_iop_is_hidden(mod_src))
-         && (copy_full || !dt_history_module_skip_copy(mod_src->flags()))
-        )
+      for(GList *modules = darktable.iop; modules; modules = g_list_next(modules))
       {
-        mod_list = g_list_prepend(mod_list, mod_src);
+        dt_iop_module_so_t *module = (dt_iop_module_so_t *)modules->data;
+
+        if(dt_history_module_skip_copy(module->flags()))
+        {
+          if(p->skip_modules)
+            p->skip_modules = dt_util_dstrcat(p->skip_modules, ",");
+
+          p->skip_modules = dt_util_dstrcat(p->skip_modules, "'%s'", module->op);
+        }
       }
     }
+
+    if(!p->skip_modules)
+      p->skip_modules = dt_util_dstrcat(p->skip_modules, "'@'");
+
+    sqlite3_stmt *stmt;
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                                "SELECT history_end FROM main.images WHERE id = ?1",
+                                -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      if(sqlite3_column_type(stmt, 0) != SQLITE_NULL)
+        p->history_end = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
   }
-  if (DT_IOP_ORDER_INFO) fprintf(stderr,"\nvvvvv\n");
+}
+
+static void _history_paste_cleanup(_history_paste_t *p)
+{
+  if(p->dev_src_loaded) dt_dev_cleanup(&p->dev_src);
+  g_list_free(p->mod_list);
+  g_list_free_full(p->iop_list, g_free);
+  g_free(p->skip_modules);
+}
+
+static int _history_copy_and_paste_on_image_merge(_history_paste_t *p, const int32_t dest_imgid)
+{
+  GList *modules_used = NULL;
 
-  mod_list = g_list_reverse(mod_list);   // list was built in reverse order, so un-reverse it
+  dt_develop_t _dev_dest = { 0 };
+
+  dt_develop_t *dev_src = &p->dev_src;
+  dt_develop_t *dev_dest = &_dev_dest;
+
+  dt_dev_init(dev_dest, FALSE);
+
+  dev_dest->iop = dt_iop_load_modules_ext(dev_dest, TRUE);
+
+  // This prepends the default modules and converts just in case it's an empty history
+  dt_dev_read_history_ext(dev_dest, dest_imgid, TRUE);
+
+  dt_ioppr_check_iop_order(dev_dest, dest_imgid, "_history_copy_and_paste_on_image_merge ");
+
+  dt_dev_pop_history_items_ext(dev_dest, dev_dest->history_end);
+
+  dt_ioppr_check_iop_order(dev_dest, dest_imgid, "_history_copy_and_paste_on_image_merge 1");
 
   // update iop-order list to have entries for the new modules
-  dt_ioppr_update_for_modules(dev_dest, mod_list, FALSE);
+  dt_ioppr_update_for_modules(dev_dest, p->mod_list, FALSE);
 
-  for(GList *l = mod_list; l; l = g_list_next(l))
+  for(GList *l = p->mod_list; l; l = g_list_next(l))
   {
     dt_iop_module_t *mod = (dt_iop_module_t *)l->data;
     dt_history_merge_module_into_history(dev_dest, dev_src, mod, &modules_used, FALSE);
   }
 
   // update iop-order list to have entries for the new modules
-  dt_ioppr_update_for_modules(dev_dest, mod_list, FALSE);
+  dt_ioppr_update_for_modules(dev_dest, p->mod_list, FALSE);
 
   dt_ioppr_check_iop_order(dev_dest, dest_imgid, "_history_copy_and_paste_on_image_merge 2");
 
   // write history and forms to db
   dt_dev_write_history_ext(dev_dest, dest_imgid);
 
-  dt_dev_cleanup(dev_src);
   dt_dev_cleanup(dev_dest);
 
   g_list_free(modules_used);
@@ -578,8 +662,9 @@ static int _history_copy_and_paste_on_image_merge(int32_t imgid, int32_t dest_im
   return 0;
 }
 
-static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const int32_t dest_imgid, GList *ops, const gboolean copy_full)
+static int _history_copy_and_paste_on_image_overwrite(_history_paste_t *p, const int32_t dest_imgid)
 {
+  const int32_t imgid = p->imgid;
   int ret_val = 0;
   sqlite3_stmt *stmt;
 
@@ -607,30 +692,8 @@ static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const
   sqlite3_finalize(stmt);
 
   // the user wants an exact duplicate of the history, so just copy the db
-  if(!ops)
+  if(!p->ops)
   {
-    // let's build the list of IOP to not copy
-    gchar *skip_modules = NULL;
-
-    if(!copy_full)
-    {
-      for(GList *modules = darktable.iop; modules; modules = g_list_next(modules))
-      {
-        dt_iop_module_so_t *module = (dt_iop_module_so_t *)modules->data;
-
-        if(dt_history_module_skip_copy(module->flags()))
-        {
-          if(skip_modules)
-            skip_modules = dt_util_dstrcat(skip_modules, ",");
-
-          skip_modules = dt_util_dstrcat(skip_modules, "'%s'", module->op);
-        }
-      }
-    }
-
-    if(!skip_modules)
-      skip_modules = dt_util_dstrcat(skip_modules, "'@'");
-
     gchar *query = g_strdup_printf
       ("INSERT INTO main.history "
        "            (imgid,num,module,operation,op_params,enabled,blendop_params, "
@@ -640,7 +703,7 @@ static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const
        " FROM main.history"
        " WHERE imgid=?2"
        "       AND operation NOT IN (%s)"
-       " ORDER BY num", skip_modules);
+       " ORDER BY num", p->skip_modules);
 
     DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
     DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, dest_imgid);
@@ -656,7 +719,7 @@ static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const
        " SELECT ?1, num, formid, form, name, version, points, points_count, source "
        "  FROM main.masks_history"
        "  WHERE imgid = ?2"
-       "    AND num NOT IN (SELECT num FROM history WHERE imgid=?2 AND OPERATION IN (%s))", skip_modules);
+       "    AND num NOT IN (SELECT num FROM history WHERE imgid=?2 AND OPERATION IN (%s))", p->skip_modules);
 
     DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
     DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, dest_imgid);
@@ -664,26 +727,14 @@ static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const
     sqlite3_step(stmt);
     sqlite3_finalize(stmt);
 
-    g_free(skip_modules);
-
-    int history_end = 0;
-    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                                "SELECT history_end FROM main.images WHERE id = ?1",
-                                -1, &stmt, NULL);
-    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
-    if(sqlite3_step(stmt) == SQLITE_ROW)
-    {
-      if(sqlite3_column_type(stmt, 0) != SQLITE_NULL)
-        history_end = sqlite3_column_int(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
+    g_free(query);
 
     DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
                                 "UPDATE main.images SET history_end = ?2"
                                 " WHERE id = ?1",
                                 -1, &stmt, NULL);
     DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, dest_imgid);
-    DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, history_end);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, p->history_end);
     sqlite3_step(stmt);
     sqlite3_finalize(stmt);
 
@@ -726,83 +777,135 @@ static int _history_copy_and_paste_on_image_overwrite(const int32_t imgid, const
   else
   {
     // since the history and masks where deleted we can do a merge
-    ret_val = _history_copy_and_paste_on_image_merge(imgid, dest_imgid, ops, copy_full);
+    ret_val = _history_copy_and_paste_on_image_merge(p, dest_imgid);
   }
 
   return ret_val;
 }
 
-int dt_history_copy_and_paste_on_image(const int32_t imgid, const int32_t dest_imgid,
-                                       const gboolean merge, GList *ops,
-                                       const gboolean copy_iop_order, const gboolean copy_full)
+int dt_history_copy_and_paste_on_list(const int32_t imgid, const GList *list,
+                                      const gboolean merge, GList *ops,
+                                      const gboolean copy_iop_order, const gboolean copy_full)
 {
-  if(imgid == dest_imgid) return 1;
-
   if(imgid == -1)
   {
     dt_control_log(_("you need to copy history from an image before you paste it onto another"));
     return 1;
   }
 
-  dt_lock_image_pair(imgid, dest_imgid);
+  GList *dest = NULL;
+  for(const GList *l = list; l; l = g_list_next(l))
+    if(GPOINTER_TO_INT(l->data) != imgid) dest = g_list_prepend(dest, l->data);
+  if(!dest) return 1;
+  dest = g_list_reverse(dest);
+
+  const double start = dt_get_wtime();
 
   // be sure the current history is written before pasting some other history data
   const dt_view_t *cv = dt_view_manager_get_current_view(darktable.view_manager);
   if(cv->view((dt_view_t *)cv) == DT_VIEW_DARKROOM) dt_dev_write_history(darktable.develop);
 
-  dt_undo_lt_history_t *hist = dt_history_snapshot_item_init();
-  hist->imgid = dest_imgid;
-  dt_history_snapshot_undo_create(hist->imgid, &hist->before, &hist->before_history_end);
-
-  if(copy_iop_order)
-  {
-    GList *iop_list = dt_ioppr_get_iop_order_list(imgid, FALSE);
-    dt_ioppr_write_iop_order_list(iop_list, dest_imgid);
-    g_list_free_full(iop_list, g_free);
-  }
+  // the source history and the list of modules to paste are the same for all images
+  _history_paste_t paste;
+  _history_paste_init(&paste, imgid, merge, ops, copy_iop_order, copy_full);
 
   int ret_val = 0;
-  if(merge)
-    ret_val = _history_copy_and_paste_on_image_merge(imgid, dest_imgid, ops, copy_full);
-  else
-    ret_val = _history_copy_and_paste_on_image_overwrite(imgid, dest_imgid, ops, copy_full);
+  int count = 0;
 
-  dt_history_snapshot_undo_create(hist->imgid, &hist->after, &hist->after_history_end);
   dt_undo_start_group(darktable.undo, DT_UNDO_LT_HISTORY);
-  dt_undo_record(darktable.undo, NULL, DT_UNDO_LT_HISTORY, (dt_undo_data_t)hist,
-                 dt_history_snapshot_undo_pop, dt_history_snapshot_undo_lt_history_data_free);
+
+  for(const GList *l = dest; l; l = g_list_next(l))
+  {
+    const int32_t dest_imgid = GPOINTER_TO_INT(l->data);
+
+    dt_lock_image_pair(imgid, dest_imgid);
+
+    dt_undo_lt_history_t *hist = dt_history_snapshot_item_init();
+    hist->imgid = dest_imgid;
+    dt_history_snapshot_undo_create(hist->imgid, &hist->before, &hist->before_history_end);
+
+    // all changes of one image in a single transaction. a savepoint, as reading the history of the image
+    // on the way (_dev_merge_history()) nests one of its own
+    DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "SAVEPOINT history_paste", NULL, NULL, NULL);
+
+    if(paste.iop_list) dt_ioppr_write_iop_order_list(paste.iop_list, dest_imgid);
+
+    const int failed = merge ? _history_copy_and_paste_on_image_merge(&paste, dest_imgid)
+                             : _history_copy_and_paste_on_image_overwrite(&paste, dest_imgid);
+    ret_val |= failed;
+
+    // an image that failed keeps its history as it was
+    if(failed)
+      DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "ROLLBACK TO history_paste", NULL, NULL, NULL);
+    DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "RELEASE history_paste", NULL, NULL, NULL);
+
+    dt_history_snapshot_undo_create(hist->imgid, &hist->after, &hist->after_history_end);
+    dt_undo_record(darktable.undo, NULL, DT_UNDO_LT_HISTORY, (dt_undo_data_t)hist,
+                   dt_history_snapshot_undo_pop, dt_history_snapshot_undo_lt_history_data_free);
+
+    /* set change_timestamp */
+    dt_image_cache_set_change_timestamp(darktable.image_cache, dest_imgid);
+
+    dt_unlock_image_pair(imgid, dest_imgid);
+    count++;
+  }
+
   dt_undo_end_group(darktable.undo);
 
+  _history_paste_cleanup(&paste);
+
+  // from here on everything is done once for the whole list
+
   /* attach changed tag reflecting actual change */
   guint tagid = 0;
   dt_tag_new("darktable|changed", &tagid);
-  dt_tag_attach(tagid, dest_imgid, FALSE, FALSE);
-  /* set change_timestamp */
-  dt_image_cache_set_change_timestamp(darktable.image_cache, dest_imgid);
+  dt_tag_attach_images(tagid, dest, FALSE);
 
-  /* if current image in develop reload history */
-  if(dt_dev_is_current_image(darktable.develop, dest_imgid))
+  for(const GList *l = dest; l; l = g_list_next(l))
   {
-    dt_dev_reload_history_items(darktable.develop);
-    dt_dev_modulegroups_set(darktable.develop, dt_dev_modulegroups_get(darktable.develop));
-  }
+    const int32_t dest_imgid = GPOINTER_TO_INT(l->data);
+
+    /* if current image in develop reload history */
+    if(dt_dev_is_current_image(darktable.develop, dest_imgid))
+    {
+      dt_dev_reload_history_items(darktable.develop);
+      dt_dev_modulegroups_set(darktable.develop, dt_dev_modulegroups_get(darktable.develop));
+    }
 
-  /* update xmp file */
-  dt_image_synch_xmp(dest_imgid);
+    dt_mipmap_cache_remove(darktable.mipmap_cache, dest_imgid);
 
-  dt_mipmap_cache_remove(darktable.mipmap_cache, dest_imgid);
+    /* update the aspect ratio. recompute only if really needed for performance reasons */
+    if(darktable.collection->params.sort == DT_COLLECTION_SORT_ASPECT_RATIO)
+      dt_image_set_aspect_ratio(dest_imgid, FALSE);
+    else
+      dt_image_reset_aspect_ratio(dest_imgid, FALSE);
+  }
   dt_image_reset_final_size(imgid);
 
-  /* update the aspect ratio. recompute only if really needed for performance reasons */
-  if(darktable.collection->params.sort == DT_COLLECTION_SORT_ASPECT_RATIO)
-    dt_image_set_aspect_ratio(dest_imgid, FALSE);
-  else
-    dt_image_reset_aspect_ratio(dest_imgid, FALSE);
+  /* update xmp files */
+  dt_image_synch_xmps(dest);
 
-  // signal that the mipmap need to be updated
-  DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_DEVELOP_MIPMAP_UPDATED, dest_imgid);
+  // signal that the mipmaps need to be updated, a single signal for all thumbnails if there are several
+  DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_DEVELOP_MIPMAP_UPDATED,
+                                g_list_next(dest) ? -1 : GPOINTER_TO_INT(dest->data));
 
-  dt_unlock_image_pair(imgid, dest_imgid);
+  dt_print(DT_DEBUG_PERF, "[history] pasted history of image %d onto %d images in %.3f secs\n", imgid, count,
+           dt_get_wtime() - start);
+
+  g_list_free(dest);
+
+  return ret_val;
+}
+
+int dt_history_copy_and_paste_on_image(const int32_t imgid, const int32_t dest_imgid,
+                                       const gboolean merge, GList *ops,
+                                       const gboolean copy_iop_order, const gboolean copy_full)
+{
+  if(imgid == dest_imgid) return 1;
+
+  GList *list = g_list_prepend(NULL, GINT_TO_POINTER(dest_imgid));
+  const int ret_val = dt_history_copy_and_paste_on_list(imgid, list, merge, ops, copy_iop_order, copy_full);
+  g_list_free(list);
 
   return ret_val;
 }
@@ -1642,15 +1745,11 @@ gboolean dt_history_paste_on_list(const GList *list, gboolean undo)
   if(mode == 0) merge = TRUE;
 
   if(undo) dt_undo_start_group(darktable.undo, DT_UNDO_LT_HISTORY);
-  for(GList *l = (GList *)list; l; l = g_list_next(l))
-  {
-    const int dest = GPOINTER_TO_INT(l->data);
-    dt_history_copy_and_paste_on_image(darktable.view_manager->copy_paste.copied_imageid,
-                                       dest, merge,
-                                       darktable.view_manager->copy_paste.selops,
-                                       darktable.view_manager->copy_paste.copy_iop_order,
-                                       darktable.view_manager->copy_paste.full_copy);
-  }
+  dt_history_copy_and_paste_on_list(darktable.view_manager->copy_paste.copied_imageid,
+                                    list, merge,
+                                    darktable.view_manager->copy_paste.selops,
+                                    darktable.view_manager->copy_paste.copy_iop_order,
+                                    darktable.view_manager->copy_paste.full_copy);
   if(undo) dt_undo_end_group(darktable.undo);
   return TRUE;
 }
@@ -1681,15 +1780,11 @@ gboolean dt_history_paste_parts_on_list(const GList *list, gboolean undo)
   }
 
   if(undo) dt_undo_start_group(darktable.undo, DT_UNDO_LT_HISTORY);
-  for (const GList *l = l_copy; l; l = g_list_next(l))
-  {
-    const int dest = GPOINTER_TO_INT(l->data);
-    dt_history_copy_and_paste_on_image(darktable.view_manager->copy_paste.copied_imageid,
-                                       dest, merge,
-                                       darktable.view_manager->copy_paste.selops,
-                                       darktable.view_manager->copy_paste.copy_iop_order,
-                                       darktable.view_manager->copy_paste.full_copy);
-  }
+  dt_history_copy_and_paste_on_list(darktable.view_manager->copy_paste.copied_imageid,
+                                    l_copy, merge,
+                                    darktable.view_manager->copy_paste.selops,
+                                    darktable.view_manager->copy_paste.copy_iop_order,
+                                    darktable.view_manager->copy_paste.full_copy);
   if(undo) dt_undo_end_group(darktable.undo);
 
   g_list_free(l_copy);
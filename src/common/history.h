@@ -67,6 +67,10 @@ int dt_history_merge_module_into_history(struct dt_develop_t *dev_dest, struct d
 /** copy history from imgid and pasts on dest_imgid, merge or overwrite... */
 int dt_history_copy_and_paste_on_image(int32_t imgid, int32_t dest_imgid, gboolean merge, GList *ops, gboolean copy_iop_order, const gboolean copy_full);
 
+/** as above for all images of list. the source history is read only once, each image is written in one
+    transaction and xmp files, thumbnails and the changed tag are updated in a single pass at the end */
+int dt_history_copy_and_paste_on_list(int32_t imgid, const GList *list, gboolean merge, GList *ops, gboolean copy_iop_order, const gboolean copy_full);
+
 /** delete all history for the given image */
 void dt_history_delete_on_image(int32_t imgid);
 
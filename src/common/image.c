@@ -34,6 +34,8 @@
 #include "common/undo.h"
 #include "common/history.h"
 #include "common/selection.h"
+#include "common/sidecar_writer.h"
+#include "common/tag_index.h"
 #include "control/conf.h"
 #include "control/control.h"
 #include "control/jobs.h"
@@ -258,15 +260,14 @@ const char *dt_image_film_roll_name(const char *path)
 void dt_image_film_roll_directory(const dt_image_t *img, char *pathname, size_t pathname_len)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT folder FROM main.film_rolls WHERE id = ?1",
-                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db, "SELECT folder FROM main.film_rolls WHERE id = ?1", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, img->film_id);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     const char *f = (char *)sqlite3_column_text(stmt, 0);
     g_strlcpy(pathname, f, pathname_len);
   }
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   pathname[pathname_len - 1] = '\0';
 }
 
@@ -274,8 +275,7 @@ void dt_image_film_roll_directory(const dt_image_t *img, char *pathname, size_t
 void dt_image_film_roll(const dt_image_t *img, char *pathname, size_t pathname_len)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT folder FROM main.film_rolls WHERE id = ?1",
-                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db, "SELECT folder FROM main.film_rolls WHERE id = ?1", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, img->film_id);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
@@ -287,7 +287,7 @@ void dt_image_film_roll(const dt_image_t *img, char *pathname, size_t pathname_l
   {
     g_strlcpy(pathname, _("orphaned image"), pathname_len);
   }
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   pathname[pathname_len - 1] = '\0';
 }
 
@@ -317,16 +317,17 @@ gboolean dt_image_safe_remove(const int32_t imgid)
 void dt_image_full_path(const int32_t imgid, char *pathname, size_t pathname_len, gboolean *from_cache)
 {
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT folder || '" G_DIR_SEPARATOR_S "' || filename FROM main.images i, main.film_rolls f WHERE "
-                              "i.film_id = f.id and i.id = ?1",
-                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db,
+                                           "SELECT folder || '" G_DIR_SEPARATOR_S "' || filename"
+                                           " FROM main.images i, main.film_rolls f"
+                                           " WHERE i.film_id = f.id and i.id = ?1",
+                                           &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     g_strlcpy(pathname, (char *)sqlite3_column_text(stmt, 0), pathname_len);
   }
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 
   if(*from_cache)
   {
@@ -345,10 +346,11 @@ static void _image_local_copy_full_path(const int32_t imgid, char *pathname, siz
   sqlite3_stmt *stmt;
 
   *pathname = '\0';
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT folder || '" G_DIR_SEPARATOR_S "' || filename FROM main.images i, main.film_rolls f "
-                              "WHERE i.film_id = f.id AND i.id = ?1",
-                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db,
+                                           "SELECT folder || '" G_DIR_SEPARATOR_S "' || filename"
+                                           " FROM main.images i, main.film_rolls f"
+                                           " WHERE i.film_id = f.id AND i.id = ?1",
+                                           &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
@@ -375,7 +377,7 @@ static void _image_local_copy_full_path(const int32_t imgid, char *pathname, siz
 
     g_free(md5_filename);
   }
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 }
 
 void dt_image_path_append_version_no_db(int version, char *pathname, size_t pathname_len)
@@ -402,12 +404,11 @@ void dt_image_path_append_version(const int32_t imgid, char *pathname, size_t pa
   // get duplicate suffix
   int version = 0;
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT version FROM main.images WHERE id = ?1", -1,
-                              &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db, "SELECT version FROM main.images WHERE id = ?1", &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
 
   if(sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 
   dt_image_path_append_version_no_db(version, pathname, pathname_len);
 }
@@ -1095,6 +1096,7 @@ static int32_t _image_duplicate_with_version_ext(const int32_t imgid, const int3
     }
     g_list_free(tags);
 #endif
+    dt_tag_index_image_reload(darktable.tag_index, newid);
 
     if(darktable.develop->image_storage.id == imgid)
     {
@@ -1205,6 +1207,7 @@ void dt_image_remove(const int32_t imgid)
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_image_removed(darktable.tag_index, imgid);
 
   // also clear all thumbnails in mipmap_cache.
   dt_mipmap_cache_remove(darktable.mipmap_cache, imgid);
@@ -2124,6 +2127,7 @@ int32_t dt_image_copy_rename(const int32_t imgid, const int32_t filmid, const gc
         }
         g_list_free(tags);
 #endif
+        dt_tag_index_image_reload(darktable.tag_index, newid);
         // get max_version of image duplicates in destination filmroll
         int32_t max_version = -1;
         DT_DEBUG_SQLITE3_PREPARE_V2
@@ -2341,7 +2345,7 @@ int dt_image_local_copy_reset(const int32_t imgid)
 
     // first sync the xmp with the original picture
 
-    dt_image_write_sidecar_file(imgid);
+    dt_image_write_sidecar_file_sync(imgid);
 
     // delete image from cache directory only if there is no other local cache image referencing it
     // for example duplicates are all referencing the same base picture.
@@ -2378,43 +2382,15 @@ int dt_image_local_copy_reset(const int32_t imgid)
 
 void dt_image_write_sidecar_file(const int32_t imgid)
 {
-  // TODO: compute hash and don't write if not needed!
-  // write .xmp file
+  // write .xmp file in the background, repeated requests for the same image are coalesced
   if(imgid > 0 && dt_conf_get_bool("write_sidecar_files"))
-  {
-    char filename[PATH_MAX] = { 0 };
-
-    // FIRST: check if the original file is present
-    gboolean from_cache = FALSE;
-    dt_image_full_path(imgid, filename, sizeof(filename), &from_cache);
-
-    if (!g_file_test(filename, G_FILE_TEST_EXISTS))
-    {
-      // OTHERWISE: check if the local copy exists
-      from_cache = TRUE;
-      dt_image_full_path(imgid, filename, sizeof(filename), &from_cache);
-
-      //  nothing to do, the original is not accessible and there is no local copy
-      if (!from_cache) return;
-    }
-
-    dt_image_path_append_version(imgid, filename, sizeof(filename));
-    g_strlcat(filename, ".xmp", sizeof(filename));
+    dt_sidecar_writer_queue(darktable.sidecar_writer, imgid);
+}
 
-    if(!dt_exif_xmp_write(imgid, filename))
-    {
-      // put the timestamp into db. this can't be done in exif.cc since that code gets called
-      // for the copy exporter, too
-      sqlite3_stmt *stmt;
-      DT_DEBUG_SQLITE3_PREPARE_V2
-        (dt_database_get(darktable.db),
-         "UPDATE main.images SET write_timestamp = STRFTIME('%s', 'now') WHERE id = ?1",
-         -1, &stmt, NULL);
-      DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
-      sqlite3_step(stmt);
-      sqlite3_finalize(stmt);
-    }
-  }
+void dt_image_write_sidecar_file_sync(const int32_t imgid)
+{
+  if(imgid > 0 && dt_conf_get_bool("write_sidecar_files"))
+    dt_sidecar_writer_write(darktable.sidecar_writer, imgid);
 }
 
 void dt_image_synch_xmps(const GList *img)
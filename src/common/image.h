@@ -375,6 +375,8 @@ gboolean dt_image_safe_remove(const int32_t imgid);
 void dt_image_local_copy_synch(void);
 // xmp functions:
 void dt_image_write_sidecar_file(const int32_t imgid);
+// same as above, but the file is written before returning
+void dt_image_write_sidecar_file_sync(const int32_t imgid);
 void dt_image_synch_xmp(const int selected);
 void dt_image_synch_xmps(const GList *img);
 void dt_image_synch_all_xmp(const gchar *pathname);
@@ -27,146 +27,175 @@
 #include <sqlite3.h>
 #include <inttypes.h>
 
+// the columns _image_cache_read_row() expects, in this order
+#define DT_IMAGE_CACHE_COLUMNS                                                                                        \
+  "id, group_id, film_id, width, height, filename, maker, model, lens, exposure,"                                     \
+  "       aperture, iso, focal_length, datetime_taken, flags, crop, orientation,"                                     \
+  "       focus_distance, raw_parameters, longitude, latitude, altitude, color_matrix,"                               \
+  "       colorspace, version, raw_black, raw_maximum, aspect_ratio, exposure_bias,"                                  \
+  "       import_timestamp, change_timestamp, export_timestamp, print_timestamp"
+
+// prefetch at most that many images at once, the cache holds some thousands
+#define DT_IMAGE_CACHE_PREFETCH_MAX 500
+
+static void _image_cache_read_row(dt_image_t *img, sqlite3_stmt *stmt)
+{
+  img->id = sqlite3_column_int(stmt, 0);
+  img->group_id = sqlite3_column_int(stmt, 1);
+  img->film_id = sqlite3_column_int(stmt, 2);
+  img->width = sqlite3_column_int(stmt, 3);
+  img->height = sqlite3_column_int(stmt, 4);
+  img->crop_x = img->crop_y = img->crop_width = img->crop_height = 0;
+  img->filename[0] = img->exif_maker[0] = img->exif_model[0] = img->exif_lens[0]
+      = img->exif_datetime_taken[0] = '\0';
+  char *str;
+  str = (char *)sqlite3_column_text(stmt, 5);
+  if(str) g_strlcpy(img->filename, str, sizeof(img->filename));
+  str = (char *)sqlite3_column_text(stmt, 6);
+  if(str) g_strlcpy(img->exif_maker, str, sizeof(img->exif_maker));
+  str = (char *)sqlite3_column_text(stmt, 7);
+  if(str) g_strlcpy(img->exif_model, str, sizeof(img->exif_model));
+  str = (char *)sqlite3_column_text(stmt, 8);
+  if(str) g_strlcpy(img->exif_lens, str, sizeof(img->exif_lens));
+  img->exif_exposure = sqlite3_column_double(stmt, 9);
+  img->exif_aperture = sqlite3_column_double(stmt, 10);
+  img->exif_iso = sqlite3_column_double(stmt, 11);
+  img->exif_focal_length = sqlite3_column_double(stmt, 12);
+  str = (char *)sqlite3_column_text(stmt, 13);
+  if(str) g_strlcpy(img->exif_datetime_taken, str, sizeof(img->exif_datetime_taken));
+  img->flags = sqlite3_column_int(stmt, 14);
+  img->loader = LOADER_UNKNOWN;
+  img->exif_crop = sqlite3_column_double(stmt, 15);
+  img->orientation = sqlite3_column_int(stmt, 16);
+  img->exif_focus_distance = sqlite3_column_double(stmt, 17);
+  if(img->exif_focus_distance >= 0 && img->orientation >= 0) img->exif_inited = 1;
+  uint32_t tmp = sqlite3_column_int(stmt, 18);
+  memcpy(&img->legacy_flip, &tmp, sizeof(dt_image_raw_parameters_t));
+  if(sqlite3_column_type(stmt, 19) == SQLITE_FLOAT)
+    img->geoloc.longitude = sqlite3_column_double(stmt, 19);
+  else
+    img->geoloc.longitude = NAN;
+  if(sqlite3_column_type(stmt, 20) == SQLITE_FLOAT)
+    img->geoloc.latitude = sqlite3_column_double(stmt, 20);
+  else
+    img->geoloc.latitude = NAN;
+  if(sqlite3_column_type(stmt, 21) == SQLITE_FLOAT)
+    img->geoloc.elevation = sqlite3_column_double(stmt, 21);
+  else
+    img->geoloc.elevation = NAN;
+  const void *color_matrix = sqlite3_column_blob(stmt, 22);
+  if(color_matrix)
+    memcpy(img->d65_color_matrix, color_matrix, sizeof(img->d65_color_matrix));
+  else
+    img->d65_color_matrix[0] = NAN;
+  g_free(img->profile);
+  img->profile = NULL;
+  img->profile_size = 0;
+  img->colorspace = sqlite3_column_int(stmt, 23);
+  img->version = sqlite3_column_int(stmt, 24);
+  img->raw_black_level = sqlite3_column_int(stmt, 25);
+  for(uint8_t i = 0; i < 4; i++) img->raw_black_level_separate[i] = 0;
+  img->raw_white_point = sqlite3_column_int(stmt, 26);
+  if(sqlite3_column_type(stmt, 27) == SQLITE_FLOAT)
+    img->aspect_ratio = sqlite3_column_double(stmt, 27);
+  else
+    img->aspect_ratio = 0.0;
+  if(sqlite3_column_type(stmt, 28) == SQLITE_FLOAT)
+    img->exif_exposure_bias = sqlite3_column_double(stmt, 28);
+  else
+    img->exif_exposure_bias = NAN;
+  img->import_timestamp = sqlite3_column_int(stmt, 29);
+  img->change_timestamp = sqlite3_column_int(stmt, 30);
+  img->export_timestamp = sqlite3_column_int(stmt, 31);
+  img->print_timestamp = sqlite3_column_int(stmt, 32);
+
+  // buffer size? colorspace?
+  if(img->flags & DT_IMAGE_LDR)
+  {
+    img->buf_dsc.channels = 4;
+    img->buf_dsc.datatype = TYPE_FLOAT;
+    img->buf_dsc.cst = iop_cs_rgb;
+  }
+  else if(img->flags & DT_IMAGE_HDR)
+  {
+    if(img->flags & DT_IMAGE_RAW)
+    {
+      img->buf_dsc.channels = 1;
+      img->buf_dsc.datatype = TYPE_FLOAT;
+      img->buf_dsc.cst = iop_cs_RAW;
+    }
+    else
+    {
+      img->buf_dsc.channels = 4;
+      img->buf_dsc.datatype = TYPE_FLOAT;
+      img->buf_dsc.cst = iop_cs_rgb;
+    }
+  }
+  else
+  {
+    // raw
+    img->buf_dsc.channels = 1;
+    img->buf_dsc.datatype = TYPE_UINT16;
+    img->buf_dsc.cst = iop_cs_RAW;
+  }
+}
+
 void dt_image_cache_allocate(void *data, dt_cache_entry_t *entry)
 {
+  dt_image_cache_t *cache = (dt_image_cache_t *)data;
   entry->cost = sizeof(dt_image_t);
 
-  dt_image_t *img = (dt_image_t *)g_malloc(sizeof(dt_image_t));
+  // loaded by dt_image_cache_prefetch() already?
+  dt_pthread_mutex_lock(&cache->prefetch_lock);
+  dt_image_t *img = (dt_image_t *)g_hash_table_lookup(cache->prefetched, GINT_TO_POINTER(entry->key));
+  if(img) g_hash_table_steal(cache->prefetched, GINT_TO_POINTER(entry->key));
+  dt_pthread_mutex_unlock(&cache->prefetch_lock);
+  if(img)
+  {
+    entry->data = img;
+    img->cache_entry = entry;
+    return;
+  }
+
+  img = (dt_image_t *)g_malloc(sizeof(dt_image_t));
   dt_image_init(img);
   entry->data = img;
   // load stuff from db and store in cache:
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(
-      dt_database_get(darktable.db),
-      "SELECT id, group_id, film_id, width, height, filename, maker, model, lens, exposure,"
-      "       aperture, iso, focal_length, datetime_taken, flags, crop, orientation,"
-      "       focus_distance, raw_parameters, longitude, latitude, altitude, color_matrix,"
-      "       colorspace, version, raw_black, raw_maximum, aspect_ratio, exposure_bias,"
-      "       import_timestamp, change_timestamp, export_timestamp, print_timestamp"
-      "  FROM main.images"
-      "  WHERE id = ?1",
-      -1, &stmt, NULL);
+  // called from the thumbnail and export workers a lot, use a read-only connection if one is free
+  DT_DEBUG_SQLITE3_PREPARE_CACHED_READONLY(darktable.db,
+                                           "SELECT " DT_IMAGE_CACHE_COLUMNS
+                                           "  FROM main.images"
+                                           "  WHERE id = ?1",
+                                           &stmt);
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, entry->key);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
-    img->id = sqlite3_column_int(stmt, 0);
-    img->group_id = sqlite3_column_int(stmt, 1);
-    img->film_id = sqlite3_column_int(stmt, 2);
-    img->width = sqlite3_column_int(stmt, 3);
-    img->height = sqlite3_column_int(stmt, 4);
-    img->crop_x = img->crop_y = img->crop_width = img->crop_height = 0;
-    img->filename[0] = img->exif_maker[0] = img->exif_model[0] = img->exif_lens[0]
-        = img->exif_datetime_taken[0] = '\0';
-    char *str;
-    str = (char *)sqlite3_column_text(stmt, 5);
-    if(str) g_strlcpy(img->filename, str, sizeof(img->filename));
-    str = (char *)sqlite3_column_text(stmt, 6);
-    if(str) g_strlcpy(img->exif_maker, str, sizeof(img->exif_maker));
-    str = (char *)sqlite3_column_text(stmt, 7);
-    if(str) g_strlcpy(img->exif_model, str, sizeof(img->exif_model));
-    str = (char *)sqlite3_column_text(stmt, 8);
-    if(str) g_strlcpy(img->exif_lens, str, sizeof(img->exif_lens));
-    img->exif_exposure = sqlite3_column_double(stmt, 9);
-    img->exif_aperture = sqlite3_column_double(stmt, 10);
-    img->exif_iso = sqlite3_column_double(stmt, 11);
-    img->exif_focal_length = sqlite3_column_double(stmt, 12);
-    str = (char *)sqlite3_column_text(stmt, 13);
-    if(str) g_strlcpy(img->exif_datetime_taken, str, sizeof(img->exif_datetime_taken));
-    img->flags = sqlite3_column_int(stmt, 14);
-    img->loader = LOADER_UNKNOWN;
-    img->exif_crop = sqlite3_column_double(stmt, 15);
-    img->orientation = sqlite3_column_int(stmt, 16);
-    img->exif_focus_distance = sqlite3_column_double(stmt, 17);
-    if(img->exif_focus_distance >= 0 && img->orientation >= 0) img->exif_inited = 1;
-    uint32_t tmp = sqlite3_column_int(stmt, 18);
-    memcpy(&img->legacy_flip, &tmp, sizeof(dt_image_raw_parameters_t));
-    if(sqlite3_column_type(stmt, 19) == SQLITE_FLOAT)
-      img->geoloc.longitude = sqlite3_column_double(stmt, 19);
-    else
-      img->geoloc.longitude = NAN;
-    if(sqlite3_column_type(stmt, 20) == SQLITE_FLOAT)
-      img->geoloc.latitude = sqlite3_column_double(stmt, 20);
-    else
-      img->geoloc.latitude = NAN;
-    if(sqlite3_column_type(stmt, 21) == SQLITE_FLOAT)
-      img->geoloc.elevation = sqlite3_column_double(stmt, 21);
-    else
-      img->geoloc.elevation = NAN;
-    const void *color_matrix = sqlite3_column_blob(stmt, 22);
-    if(color_matrix)
-      memcpy(img->d65_color_matrix, color_matrix, sizeof(img->d65_color_matrix));
-    else
-      img->d65_color_matrix[0] = NAN;
-    g_free(img->profile);
-    img->profile = NULL;
-    img->profile_size = 0;
-    img->colorspace = sqlite3_column_int(stmt, 23);
-    img->version = sqlite3_column_int(stmt, 24);
-    img->raw_black_level = sqlite3_column_int(stmt, 25);
-    for(uint8_t i = 0; i < 4; i++) img->raw_black_level_separate[i] = 0;
-    img->raw_white_point = sqlite3_column_int(stmt, 26);
-    if(sqlite3_column_type(stmt, 27) == SQLITE_FLOAT)
-      img->aspect_ratio = sqlite3_column_double(stmt, 27);
-    else
-      img->aspect_ratio = 0.0;
-    if(sqlite3_column_type(stmt, 28) == SQLITE_FLOAT)
-      img->exif_exposure_bias = sqlite3_column_double(stmt, 28);
-    else
-      img->exif_exposure_bias = NAN;
-    img->import_timestamp = sqlite3_column_int(stmt, 29);
-    img->change_timestamp = sqlite3_column_int(stmt, 30);
-    img->export_timestamp = sqlite3_column_int(stmt, 31);
-    img->print_timestamp = sqlite3_column_int(stmt, 32);
-
-    // buffer size? colorspace?
-    if(img->flags & DT_IMAGE_LDR)
-    {
-      img->buf_dsc.channels = 4;
-      img->buf_dsc.datatype = TYPE_FLOAT;
-      img->buf_dsc.cst = iop_cs_rgb;
-    }
-    else if(img->flags & DT_IMAGE_HDR)
-    {
-      if(img->flags & DT_IMAGE_RAW)
-      {
-        img->buf_dsc.channels = 1;
-        img->buf_dsc.datatype = TYPE_FLOAT;
-        img->buf_dsc.cst = iop_cs_RAW;
-      }
-      else
-      {
-        img->buf_dsc.channels = 4;
-        img->buf_dsc.datatype = TYPE_FLOAT;
-        img->buf_dsc.cst = iop_cs_rgb;
-      }
-    }
-    else
-    {
-      // raw
-      img->buf_dsc.channels = 1;
-      img->buf_dsc.datatype = TYPE_UINT16;
-      img->buf_dsc.cst = iop_cs_RAW;
-    }
+    _image_cache_read_row(img, stmt);
   }
   else
   {
     img->id = -1;
     fprintf(stderr, "[image_cache_allocate] failed to open image %" PRIu32 " from database: %s\n", entry->key,
-            sqlite3_errmsg(dt_database_get(darktable.db)));
+            sqlite3_errmsg(sqlite3_db_handle(stmt)));
   }
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   img->cache_entry = entry; // init backref
   // could downgrade lock write->read on entry->lock if we were using concurrencykit..
   dt_image_refresh_makermodel(img);
 }
 
-void dt_image_cache_deallocate(void *data, dt_cache_entry_t *entry)
+static void _image_cache_free_image(dt_image_t *img)
 {
-  dt_image_t *img = (dt_image_t *)entry->data;
   g_free(img->profile);
   g_free(img);
 }
 
+void dt_image_cache_deallocate(void *data, dt_cache_entry_t *entry)
+{
+  _image_cache_free_image((dt_image_t *)entry->data);
+}
+
 void dt_image_cache_init(dt_image_cache_t *cache)
 {
   // the image cache does no serialization.
@@ -181,12 +210,17 @@ void dt_image_cache_init(dt_image_cache_t *cache)
   dt_cache_set_allocate_callback(&cache->cache, &dt_image_cache_allocate, cache);
   dt_cache_set_cleanup_callback(&cache->cache, &dt_image_cache_deallocate, cache);
 
+  dt_pthread_mutex_init(&cache->prefetch_lock, NULL);
+  cache->prefetched = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)_image_cache_free_image);
+
   dt_print(DT_DEBUG_CACHE, "[image_cache] has %d entries\n", num);
 }
 
 void dt_image_cache_cleanup(dt_image_cache_t *cache)
 {
   dt_cache_cleanup(&cache->cache);
+  g_hash_table_destroy(cache->prefetched);
+  dt_pthread_mutex_destroy(&cache->prefetch_lock);
 }
 
 void dt_image_cache_print(dt_image_cache_t *cache)
@@ -206,6 +240,63 @@ dt_image_t *dt_image_cache_get(dt_image_cache_t *cache, const int32_t imgid, cha
   return img;
 }
 
+void dt_image_cache_prefetch(dt_image_cache_t *cache, const GList *imgs)
+{
+  // only the ones we don't have yet
+  GString *ids = g_string_new(NULL);
+  int count = 0;
+  for(const GList *l = imgs; l && count < DT_IMAGE_CACHE_PREFETCH_MAX; l = g_list_next(l))
+  {
+    const int32_t imgid = GPOINTER_TO_INT(l->data);
+    if(imgid <= 0 || dt_cache_contains(&cache->cache, imgid)) continue;
+    g_string_append_printf(ids, count ? ",%d" : "%d", imgid);
+    count++;
+  }
+  if(count < 2)
+  {
+    // nothing to gain over the lookup in dt_image_cache_allocate()
+    g_string_free(ids, TRUE);
+    return;
+  }
+
+  const double start = dt_get_wtime();
+  gchar *query = g_strdup_printf("SELECT " DT_IMAGE_CACHE_COLUMNS " FROM main.images WHERE id IN (%s)", ids->str);
+  g_string_free(ids, TRUE);
+
+  // read all rows without holding the cache lock, dt_image_cache_allocate() picks them up below
+  GList *loaded = NULL;
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    dt_image_t *img = (dt_image_t *)g_malloc(sizeof(dt_image_t));
+    dt_image_init(img);
+    _image_cache_read_row(img, stmt);
+    dt_image_refresh_makermodel(img);
+    loaded = g_list_prepend(loaded, GINT_TO_POINTER(img->id));
+    dt_pthread_mutex_lock(&cache->prefetch_lock);
+    g_hash_table_replace(cache->prefetched, GINT_TO_POINTER(img->id), img);
+    dt_pthread_mutex_unlock(&cache->prefetch_lock);
+  }
+  sqlite3_finalize(stmt);
+  g_free(query);
+
+  for(GList *l = loaded; l; l = g_list_next(l))
+  {
+    const int32_t imgid = GPOINTER_TO_INT(l->data);
+    dt_cache_entry_t *entry = dt_cache_get(&cache->cache, imgid, 'r');
+    dt_cache_release(&cache->cache, entry);
+    // someone else was faster, drop our copy
+    dt_pthread_mutex_lock(&cache->prefetch_lock);
+    g_hash_table_remove(cache->prefetched, GINT_TO_POINTER(imgid));
+    dt_pthread_mutex_unlock(&cache->prefetch_lock);
+  }
+
+  dt_print(DT_DEBUG_CACHE | DT_DEBUG_PERF, "[image_cache_prefetch] %d images in %.3f secs\n", g_list_length(loaded),
+           dt_get_wtime() - start);
+  g_list_free(loaded);
+}
+
 dt_image_t *dt_image_cache_testget(dt_image_cache_t *cache, const int32_t imgid, char mode)
 {
   if(imgid <= 0) return NULL;
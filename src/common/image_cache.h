@@ -24,6 +24,10 @@
 typedef struct dt_image_cache_t
 {
   dt_cache_t cache;
+
+  // image structs loaded by dt_image_cache_prefetch(), waiting to be inserted into the cache
+  dt_pthread_mutex_t prefetch_lock;
+  GHashTable *prefetched;
 }
 dt_image_cache_t;
 
@@ -51,6 +55,11 @@ void dt_image_cache_print(dt_image_cache_t *cache);
 // point where sql and xmp can be synched (unsafe setting).
 dt_image_t *dt_image_cache_get(dt_image_cache_t *cache, const int32_t imgid, char mode);
 
+// loads the image structs of the given list of image ids (GINT_TO_POINTER) with one query
+// and puts them into the cache, so that the following dt_image_cache_get() don't hit the database.
+// images already in the cache are skipped, only the first few hundred of the list are loaded.
+void dt_image_cache_prefetch(dt_image_cache_t *cache, const GList *imgs);
+
 // same as read_get, but doesn't block and returns NULL if the image
 // is currently unavailable.
 dt_image_t *dt_image_cache_testget(dt_image_cache_t *cache, const int32_t imgid, char mode);
@@ -646,6 +646,255 @@ int dt_imageio_export(const int32_t imgid, const char *filename, dt_imageio_modu
                                         storage, storage_params, num, total, metadata);
 }
 
+int dt_imageio_encoder_threads(void)
+{
+  const int threads = dt_conf_get_int("export_encoder_threads");
+  return threads > 0 ? threads : dt_get_num_threads();
+}
+
+// runs once a file has been written: attach the xmp and tell lua and the signal listeners about it
+static void _export_file_written(const int32_t imgid, const char *filename, dt_imageio_module_format_t *format,
+                                 dt_imageio_module_data_t *format_params, const gboolean thumbnail_export,
+                                 const gboolean copy_metadata, dt_imageio_module_storage_t *storage,
+                                 dt_imageio_module_data_t *storage_params, dt_export_metadata_t *metadata)
+{
+  /* now write xmp into that container, if possible */
+  if(copy_metadata && (format->flags(format_params) & FORMAT_FLAGS_SUPPORT_XMP))
+  {
+    dt_exif_xmp_attach_export(imgid, filename, metadata);
+    // no need to cancel the export if this fail
+  }
+
+  if(!thumbnail_export && strcmp(format->mime(format_params), "memory")
+    && !(format->flags(format_params) & FORMAT_FLAGS_NO_TMPFILE))
+  {
+#ifdef USE_LUA
+    //Synchronous calling of lua intermediate-export-image events
+    dt_lua_lock();
+
+    lua_State *L = darktable.lua_state.state;
+
+    luaA_push(L, dt_lua_image_t, &imgid);
+
+    lua_pushstring(L, filename);
+
+    luaA_push_type(L, format->parameter_lua_type, format_params);
+
+    if (storage)
+      luaA_push_type(L, storage->parameter_lua_type, storage_params);
+    else
+      lua_pushnil(L);
+
+    dt_lua_event_trigger(L, "intermediate-export-image", 4);
+
+    dt_lua_unlock();
+#endif
+
+    DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_IMAGE_EXPORT_TMPFILE, imgid, filename, format,
+                            format_params, storage, storage_params);
+  }
+}
+
+// an image processed by the export whose encoding and writing is left to the writer thread
+typedef struct dt_imageio_export_write_t
+{
+  int32_t imgid;
+  char filename[PATH_MAX];
+  void *buf;
+  void *format_params; // copy of the persistent part of the format parameters
+  gboolean ignore_exif, copy_metadata;
+  int sRGB, num, total;
+  dt_colorspaces_color_profile_type_t icc_type;
+  gchar *icc_filename;
+  dt_imageio_module_storage_t *storage;
+  dt_imageio_module_data_t *storage_params;
+  dt_export_metadata_t *metadata;
+} dt_imageio_export_write_t;
+
+struct dt_imageio_export_writer_t
+{
+  dt_imageio_module_format_t *format;
+  dt_imageio_module_data_t *format_params; // the writer thread's own, like every export thread has one
+  GThread *thread;
+  GAsyncQueue *queue;
+  GMutex lock;
+  GCond done;
+  int pending, depth, failed;
+};
+
+// the writer of the export job running on this thread, if any
+static GPrivate _export_writer;
+
+// pushed to stop the writer thread
+static dt_imageio_export_write_t _export_write_stop;
+
+static gpointer _export_writer_run(gpointer data)
+{
+  dt_imageio_export_writer_t *writer = (dt_imageio_export_writer_t *)data;
+  dt_imageio_module_format_t *format = writer->format;
+  dt_imageio_module_data_t *format_params = writer->format_params;
+
+  while(TRUE)
+  {
+    dt_imageio_export_write_t *w = g_async_queue_pop(writer->queue);
+    if(w == &_export_write_stop) break;
+
+    memcpy(format_params, w->format_params, format->params_size(format));
+
+    dt_times_t start;
+    dt_get_times(&start);
+    int length = 0;
+    uint8_t *exif_profile = NULL;
+    if(!w->ignore_exif)
+    {
+      char pathname[PATH_MAX] = { 0 };
+      gboolean from_cache = TRUE;
+      dt_image_full_path(w->imgid, pathname, sizeof(pathname), &from_cache);
+      length = dt_exif_read_blob(&exif_profile, pathname, w->imgid, w->sRGB, format_params->width,
+                                 format_params->height, 0);
+    }
+    const int res = format->write_image(format_params, w->filename, w->buf, w->icc_type, w->icc_filename,
+                                        exif_profile, length, w->imgid, w->num, w->total, NULL, FALSE);
+    free(exif_profile);
+    dt_free_align(w->buf);
+    dt_show_times_f(&start, "[export]", "writing `%s' in the background", w->filename);
+
+    if(res)
+    {
+      fprintf(stderr, "[export] could not write file `%s'!\n", w->filename);
+      dt_control_log(_("could not export to file `%s'!"), w->filename);
+      g_unlink(w->filename);
+    }
+    else
+      _export_file_written(w->imgid, w->filename, format, format_params, FALSE, w->copy_metadata, w->storage,
+                           w->storage_params, w->metadata);
+
+    g_free(w->icc_filename);
+    free(w->format_params);
+    free(w);
+
+    g_mutex_lock(&writer->lock);
+    if(res) writer->failed++;
+    writer->pending--;
+    g_cond_signal(&writer->done);
+    g_mutex_unlock(&writer->lock);
+  }
+  return NULL;
+}
+
+dt_imageio_export_writer_t *dt_imageio_export_writer_new(dt_imageio_module_format_t *format, const int depth)
+{
+  dt_imageio_export_writer_t *writer = calloc(1, sizeof(dt_imageio_export_writer_t));
+  if(!writer) return NULL;
+  writer->format = format;
+  writer->format_params = format->get_params(format);
+  if(!writer->format_params)
+  {
+    free(writer);
+    return NULL;
+  }
+  writer->depth = MAX(depth, 1);
+  writer->queue = g_async_queue_new();
+  g_mutex_init(&writer->lock);
+  g_cond_init(&writer->done);
+  writer->thread = g_thread_new("export-writer", _export_writer_run, writer);
+  return writer;
+}
+
+void dt_imageio_export_writer_set_current(dt_imageio_export_writer_t *writer)
+{
+  g_private_set(&_export_writer, writer);
+}
+
+int dt_imageio_export_writer_failed(dt_imageio_export_writer_t *writer)
+{
+  if(!writer) return 0;
+  g_mutex_lock(&writer->lock);
+  const int failed = writer->failed;
+  g_mutex_unlock(&writer->lock);
+  return failed;
+}
+
+int dt_imageio_export_writer_finish(dt_imageio_export_writer_t *writer)
+{
+  if(!writer) return 0;
+  if(g_private_get(&_export_writer) == writer) g_private_set(&_export_writer, NULL);
+
+  g_async_queue_push(writer->queue, &_export_write_stop);
+  g_thread_join(writer->thread);
+  const int failed = writer->failed;
+
+  writer->format->free_params(writer->format, writer->format_params);
+  g_async_queue_unref(writer->queue);
+  g_mutex_clear(&writer->lock);
+  g_cond_clear(&writer->done);
+  free(writer);
+  return failed;
+}
+
+// hand the processed image over to the writer of this thread. returns FALSE if it has to be written right away.
+static gboolean _export_write_deferred(dt_dev_pixelpipe_t *pipe, uint8_t *outbuf, const int bpp,
+                                       const int32_t imgid, const char *filename,
+                                       dt_imageio_module_format_t *format, dt_imageio_module_data_t *format_params,
+                                       const gboolean ignore_exif, const gboolean thumbnail_export,
+                                       const gboolean copy_metadata, const gboolean export_masks, const int sRGB,
+                                       dt_colorspaces_color_profile_type_t icc_type, const gchar *icc_filename,
+                                       dt_imageio_module_storage_t *storage,
+                                       dt_imageio_module_data_t *storage_params, const int num, const int total,
+                                       dt_export_metadata_t *metadata)
+{
+  dt_imageio_export_writer_t *writer = g_private_get(&_export_writer);
+  // masks are read from the pipe while writing, and formats without a temporary file collect the images
+  if(!writer || writer->format != format || thumbnail_export || export_masks
+     || (format->flags(format_params) & FORMAT_FLAGS_NO_TMPFILE))
+    return FALSE;
+
+  dt_imageio_export_write_t *w = calloc(1, sizeof(dt_imageio_export_write_t));
+  if(!w) return FALSE;
+  w->format_params = malloc(format->params_size(format));
+  // the output usually is the last cache line of the pipe, take it over instead of copying it
+  w->buf = dt_dev_pixelpipe_cache_steal(&pipe->cache, outbuf);
+  if(!w->buf)
+  {
+    const size_t size = (size_t)format_params->width * format_params->height * 4 * (bpp / 8);
+    w->buf = dt_alloc_align(64, size);
+    if(w->buf) memcpy(w->buf, outbuf, size);
+  }
+  if(!w->buf || !w->format_params)
+  {
+    dt_free_align(w->buf);
+    free(w->format_params);
+    free(w);
+    return FALSE;
+  }
+
+  memcpy(w->format_params, format_params, format->params_size(format));
+  w->imgid = imgid;
+  g_strlcpy(w->filename, filename, sizeof(w->filename));
+  w->ignore_exif = ignore_exif;
+  w->copy_metadata = copy_metadata;
+  w->sRGB = sRGB;
+  w->num = num;
+  w->total = total;
+  w->icc_type = icc_type;
+  w->icc_filename = g_strdup(icc_filename);
+  w->storage = storage;
+  w->storage_params = storage_params;
+  w->metadata = metadata;
+
+  // claim the file name now, so that storages looking for a unique one don't pick it again meanwhile
+  FILE *f = g_fopen(filename, "ab");
+  if(f) fclose(f);
+
+  // bounded: wait for the previous image to be written before queueing this one
+  g_mutex_lock(&writer->lock);
+  while(writer->pending >= writer->depth) g_cond_wait(&writer->done, &writer->lock);
+  writer->pending++;
+  g_mutex_unlock(&writer->lock);
+  g_async_queue_push(writer->queue, w);
+  return TRUE;
+}
+
 // internal function: to avoid exif blob reading + 8-bit byteorder flag + high-quality override
 int dt_imageio_export_with_flags(const int32_t imgid, const char *filename,
                                  dt_imageio_module_format_t *format, dt_imageio_module_data_t *format_params,
@@ -1010,6 +1259,16 @@ int dt_imageio_export_with_flags(const int32_t imgid, const char *filename,
   format_params->width = processed_width;
   format_params->height = processed_height;
 
+  if(_export_write_deferred(&pipe, outbuf, bpp, imgid, filename, format, format_params, ignore_exif,
+                            thumbnail_export, copy_metadata, export_masks, sRGB, icc_type, icc_filename, storage,
+                            storage_params, num, total, metadata))
+  {
+    dt_dev_pixelpipe_cleanup(&pipe);
+    dt_dev_cleanup(&dev);
+    dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
+    return 0;
+  }
+
   if(!ignore_exif)
   {
     int length;
@@ -1040,41 +1299,8 @@ int dt_imageio_export_with_flags(const int32_t imgid, const char *filename,
   dt_dev_cleanup(&dev);
   dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
 
-  /* now write xmp into that container, if possible */
-  if(copy_metadata && (format->flags(format_params) & FORMAT_FLAGS_SUPPORT_XMP))
-  {
-    dt_exif_xmp_attach_export(imgid, filename, metadata);
-    // no need to cancel the export if this fail
-  }
-
-  if(!thumbnail_export && strcmp(format->mime(format_params), "memory")
-    && !(format->flags(format_params) & FORMAT_FLAGS_NO_TMPFILE))
-  {
-#ifdef USE_LUA
-    //Synchronous calling of lua intermediate-export-image events
-    dt_lua_lock();
-
-    lua_State *L = darktable.lua_state.state;
-
-    luaA_push(L, dt_lua_image_t, &imgid);
-
-    lua_pushstring(L, filename);
-
-    luaA_push_type(L, format->parameter_lua_type, format_params);
-
-    if (storage)
-      luaA_push_type(L, storage->parameter_lua_type, storage_params);
-    else
-      lua_pushnil(L);
-
-    dt_lua_event_trigger(L, "intermediate-export-image", 4);
-
-    dt_lua_unlock();
-#endif
-
-    DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_IMAGE_EXPORT_TMPFILE, imgid, filename, format,
-                            format_params, storage, storage_params);
-  }
+  _export_file_written(imgid, filename, format, format_params, thumbnail_export, copy_metadata, storage,
+                       storage_params, metadata);
 
   return 0; // success
 
@@ -88,6 +88,19 @@ int dt_imageio_export_with_flags(const int32_t imgid, const char *filename,
                                  dt_imageio_module_storage_t *storage, dt_imageio_module_data_t *storage_params,
                                  int num, int total, dt_export_metadata_t *metadata);
 
+// number of threads the format modules may compress an image with
+int dt_imageio_encoder_threads(void);
+
+// background writer of an export job: encodes and writes the processed images in the order they come in,
+// while the export thread goes on with the next image. set it as current on the export thread to have
+// dt_imageio_export() hand over its images. finishing waits for the pending writes and returns how many failed.
+typedef struct dt_imageio_export_writer_t dt_imageio_export_writer_t;
+dt_imageio_export_writer_t *dt_imageio_export_writer_new(struct dt_imageio_module_format_t *format, const int depth);
+void dt_imageio_export_writer_set_current(dt_imageio_export_writer_t *writer);
+// number of images the writer failed to write so far
+int dt_imageio_export_writer_failed(dt_imageio_export_writer_t *writer);
+int dt_imageio_export_writer_finish(dt_imageio_export_writer_t *writer);
+
 size_t dt_imageio_write_pos(int i, int j, int wd, int ht, float fwd, float fht,
                             dt_image_orientation_t orientation);
 
@@ -158,7 +158,7 @@ int dt_imageio_jpeg_decompress_header(const void *in, size_t length, dt_imageio_
 static int decompress_jsc(dt_imageio_jpeg_t *jpg, uint8_t *out)
 {
   uint8_t *tmp = out;
-  while(jpg->dinfo.output_scanline < jpg->dinfo.image_height)
+  while(jpg->dinfo.output_scanline < jpg->dinfo.output_height)
   {
     if(jpeg_read_scanlines(&(jpg->dinfo), &tmp, 1) != 1)
     {
@@ -175,14 +175,14 @@ static int decompress_plain(dt_imageio_jpeg_t *jpg, uint8_t *out)
   JSAMPROW row_pointer[1];
   row_pointer[0] = (uint8_t *)dt_alloc_align(64, (size_t)jpg->dinfo.output_width * jpg->dinfo.num_components);
   uint8_t *tmp = out;
-  while(jpg->dinfo.output_scanline < jpg->dinfo.image_height)
+  while(jpg->dinfo.output_scanline < jpg->dinfo.output_height)
   {
     if(jpeg_read_scanlines(&(jpg->dinfo), row_pointer, 1) != 1)
     {
       dt_free_align(row_pointer[0]);
       return 1;
     }
-    for(unsigned int i = 0; i < jpg->dinfo.image_width; i++)
+    for(unsigned int i = 0; i < jpg->dinfo.output_width; i++)
     {
       for(int k = 0; k < 3; k++) tmp[4 * i + k] = row_pointer[0][3 * i + k];
     }
@@ -192,6 +192,21 @@ static int decompress_plain(dt_imageio_jpeg_t *jpg, uint8_t *out)
   return 0;
 }
 
+void dt_imageio_jpeg_decompress_scaled(dt_imageio_jpeg_t *jpg, const int min_width, const int min_height)
+{
+  // the idct can scale by 1/2, 1/4 and 1/8 for free, take the smallest that still covers the requested size
+  int denom = 8;
+  while(denom > 1 && ((jpg->dinfo.image_width + denom - 1) / denom < min_width
+                      || (jpg->dinfo.image_height + denom - 1) / denom < min_height))
+    denom /= 2;
+  jpg->dinfo.scale_num = 1;
+  jpg->dinfo.scale_denom = denom;
+  // same rounding as jpeg_calc_output_dimensions(), which we can't call here as it might error out on the
+  // color space before dt_imageio_jpeg_decompress() had a chance to fall back to plain rgb
+  jpg->width = (jpg->dinfo.image_width + denom - 1) / denom;
+  jpg->height = (jpg->dinfo.image_height + denom - 1) / denom;
+}
+
 int dt_imageio_jpeg_decompress(dt_imageio_jpeg_t *jpg, uint8_t *out)
 {
   struct dt_imageio_jpeg_error_mgr jerr;
@@ -598,7 +613,7 @@ int dt_imageio_jpeg_read_header(const char *filename, dt_imageio_jpeg_t *jpg)
 static int read_jsc(dt_imageio_jpeg_t *jpg, uint8_t *out)
 {
   uint8_t *tmp = out;
-  while(jpg->dinfo.output_scanline < jpg->dinfo.image_height)
+  while(jpg->dinfo.output_scanline < jpg->dinfo.output_height)
   {
     if(jpeg_read_scanlines(&(jpg->dinfo), &tmp, 1) != 1)
     {
@@ -34,6 +34,25 @@
 // the number of segments for the piecewise linear interpolation
 #define num_gamma 6
 
+// the blocked code path processes the finest levels of the pyramids tile by tile,
+// so that the input tile and the pyramids of all gamma levels stay in cache.
+// number of fine levels processed per tile, the coarser ones are small enough to
+// be processed on the whole image:
+#define ll_block_levels 4
+// edge length of the inner part of a tile in finest level pixels. has to be
+// a multiple of 1<<ll_block_levels so the tiles align on all pyramid levels:
+#define ll_block_size 256
+// overlap around the inner part, so that the boundary conditions at the tile
+// edges do not reach into the inner part (multiple of 1<<ll_block_levels, too).
+// each reduce step reads two pixels to either side on the finer level, so on level
+// ll_block_levels of the gaussian pyramids only values more than 2*(2^4-1) = 30
+// (rounded up: 32) pixels inside the tile are exact. assembling the output expands
+// these down through the finer levels again, which reaches another 30 pixels out:
+#define ll_block_overlap_reduce (2 << ll_block_levels)
+#define ll_block_overlap (4 << ll_block_levels)
+// edge length of a tile including the overlap
+#define ll_block_full (ll_block_size + 2 * ll_block_overlap)
+
 //#define DEBUG_DUMP
 
 // downsample width/height to given level
@@ -560,6 +579,352 @@ void apply_curve(
   pad_by_replication(out, w, h, padding);
 }
 
+// branch free version of curve_scalar(), the compiler turns this into 8-wide
+// (or wider) code in the simd loop of apply_curve_block()
+#ifdef _OPENMP
+#pragma omp declare simd uniform(g, sigma, shadows, highlights, clarity)
+#endif
+static inline float curve_blend(
+    const float x,
+    const float g,
+    const float sigma,
+    const float shadows,
+    const float highlights,
+    const float clarity)
+{
+  const float c = x-g;
+  // c < 0 selects the highlights side and flips the sign of sigma
+  const float ssigma = c < 0.0f ? -sigma : sigma;
+  const float shadhi = c < 0.0f ? highlights : shadows;
+  // linear part valid for |c| > 2*sigma
+  const float vlin = g + ssigma + shadhi * (c-ssigma);
+  // quadratic bezier blending in the midtones
+  const float t = CLAMPS(c / (2.0f*ssigma), 0.0f, 1.0f);
+  const float t2 = t * t;
+  const float mt = 1.0f-t;
+  const float vmid = g + ssigma * 2.0f*mt*t + t2*(ssigma + ssigma*shadhi);
+  const float val = fabsf(c) > 2.0f*sigma ? vlin : vmid;
+  // midtone local contrast
+  return val + clarity * c * dt_fast_expf(-c*c/(2.0f*sigma*sigma/3.0f));
+}
+
+// apply the curve to a whole compact tile, no padding to take care of
+__DT_CLONE_TARGETS__
+static void apply_curve_block(
+    float *const out,
+    const float *const in,
+    const size_t n,
+    const float g,
+    const float sigma,
+    const float shadows,
+    const float highlights,
+    const float clarity)
+{
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+  for(size_t k=0;k<n;k++)
+    out[k] = curve_blend(in[k], g, sigma, shadows, highlights, clarity);
+}
+
+// assemble output pyramid coarse to fine, from last_level-1 down to first_level.
+// output[last_level] needs to be filled already.
+static void ll_assemble(
+    float *output[max_levels],
+    float *padded[max_levels],
+    float *buf[num_gamma][max_levels],
+    const float *const gamma,
+    const int w,
+    const int h,
+    const int first_level,
+    const int last_level)
+{
+  for(int l=last_level-1;l >= first_level; l--)
+  {
+    const int pw = dl(w,l), ph = dl(h,l);
+
+    gauss_expand(output[l+1], output[l], pw, ph);
+    // go through all coefficients in the upsampled gauss buffer:
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+    dt_omp_firstprivate(ph, pw, l) \
+    shared(buf,output,gamma,padded) \
+    schedule(static) \
+    collapse(2)
+#endif
+    for(int j=0;j<ph;j++) for(int i=0;i<pw;i++)
+    {
+      const float v = padded[l][j*pw+i];
+      int hi = 1;
+      for(;hi<num_gamma-1 && gamma[hi] <= v;hi++);
+      int lo = hi-1;
+      const float a = CLAMPS((v - gamma[lo])/(gamma[hi]-gamma[lo]), 0.0f, 1.0f);
+      const float l0 = ll_laplacian(buf[lo][l+1], buf[lo][l], i, j, pw, ph);
+      const float l1 = ll_laplacian(buf[hi][l+1], buf[hi][l], i, j, pw, ph);
+      output[l][j*pw+i] += l0 * (1.0f-a) + l1 * a;
+      // we could do this to save on memory (no need for finest buf[][]).
+      // unfortunately it results in a quite noticeable loss of sharpness, i think
+      // the extra level is worth it.
+      // else if(l == 0) // use finest scale from input to not amplify noise (and use less memory)
+      //   output[l][j*pw+i] += ll_laplacian(padded[l+1], padded[l], i, j, pw, ph);
+    }
+  }
+}
+
+// geometry of one tile of the blocked code path, in finest level coordinates
+// of the padded buffer
+typedef struct ll_block_t
+{
+  int x, y;     // origin of the tile including the overlap
+  int wd, ht;   // size of the tile including the overlap
+  int ix, iy;   // origin of the inner part
+  int iwd, iht; // size of the inner part
+}
+ll_block_t;
+
+static inline void ll_block_init(
+    ll_block_t *const t,
+    const int bx,      // tile index
+    const int by,
+    const int w,       // size of the padded buffer
+    const int h,
+    const int overlap)
+{
+  t->ix = bx * ll_block_size;
+  t->iy = by * ll_block_size;
+  t->iwd = MIN(ll_block_size, w - t->ix);
+  t->iht = MIN(ll_block_size, h - t->iy);
+  t->x = MAX(0, t->ix - overlap);
+  t->y = MAX(0, t->iy - overlap);
+  t->wd = MIN(w, t->ix + t->iwd + overlap) - t->x;
+  t->ht = MIN(h, t->iy + t->iht + overlap) - t->y;
+}
+
+// number of floats needed for one pyramid of a tile up to ll_block_levels
+static inline size_t ll_block_pyramid_size(void)
+{
+  size_t size = 0;
+  for(int l=0;l<=ll_block_levels;l++)
+    size += (size_t)dl(ll_block_full,l) * dl(ll_block_full,l);
+  return size;
+}
+
+// set up level pointers into a compact tile pyramid
+static inline void ll_block_pyramid(
+    float *base,
+    float *lev[],
+    const int wd,
+    const int ht)
+{
+  for(int l=0;l<=ll_block_levels;l++)
+  {
+    lev[l] = base;
+    base += (size_t)dl(wd,l) * dl(ht,l);
+  }
+}
+
+// copy a rectangle between two buffers of different line stride
+static inline void ll_copy_rect(
+    float *const dst,
+    const int dst_stride,
+    const float *const src,
+    const int src_stride,
+    const int wd,
+    const int ht)
+{
+  for(int j=0;j<ht;j++)
+    memcpy(dst + (size_t)j*dst_stride, src + (size_t)j*src_stride, sizeof(float)*wd);
+}
+
+// write the inner part of the tile on the coarsest tile level to the full image buffer
+static inline void ll_block_store_coarse(
+    float *const full,      // full image buffer on level ll_block_levels
+    const int w,            // size of the padded buffer on the finest level
+    const int h,
+    const float *const tile,
+    const ll_block_t *const t)
+{
+  const int L = ll_block_levels;
+  const int pw = dl(w,L), ph = dl(h,L), tw = dl(t->wd,L);
+  const int x0 = t->ix >> L, y0 = t->iy >> L;
+  const int x1 = t->ix + t->iwd == w ? pw : (t->ix + t->iwd) >> L;
+  const int y1 = t->iy + t->iht == h ? ph : (t->iy + t->iht) >> L;
+  ll_copy_rect(full + (size_t)y0*pw + x0, pw,
+               tile + (size_t)(y0 - (t->y >> L))*tw + x0 - (t->x >> L), tw,
+               x1-x0, y1-y0);
+}
+
+// build the gaussian pyramid of a tile up to ll_block_levels
+static inline void ll_block_reduce(
+    float *const lev[],
+    const ll_block_t *const t,
+    const int use_sse2)
+{
+  for(int l=1;l<=ll_block_levels;l++)
+#if defined(__SSE2__)
+    if(use_sse2)
+      gauss_reduce_sse2(lev[l-1], lev[l], dl(t->wd,l-1), dl(t->ht,l-1));
+    else
+#endif
+      gauss_reduce(lev[l-1], lev[l], dl(t->wd,l-1), dl(t->ht,l-1));
+}
+
+// blocked version of local_laplacian_internal() without preview boundary.
+// the fine levels are processed tile by tile in two sweeps: the first computes
+// the coarse levels of all gaussian pyramids, which are then processed on the whole
+// image. the second one recomputes the fine levels of a tile for all gamma levels,
+// assembles them while the tile is still in cache and writes the final output directly.
+static void local_laplacian_blocked(
+    const float *const input,
+    float *const out,
+    const int wd,
+    const int ht,
+    const float sigma,
+    const float shadows,
+    const float highlights,
+    const float clarity,
+    const int use_sse2,
+    const int num_levels)
+{
+  const int last_level = num_levels-1;
+  const int max_supp = 1<<last_level;
+  int w, h;
+  float *padded[max_levels] = {0};
+  float *output[max_levels] = {0};
+  float *buf[num_gamma][max_levels] = {{0}};
+  padded[0] = ll_pad_input(input, wd, ht, max_supp, &w, &h, 0);
+
+  // only the coarse levels are kept for the whole image
+  for(int l=ll_block_levels;l<=last_level;l++)
+  {
+    padded[l] = dt_alloc_align_float((size_t)dl(w,l) * dl(h,l));
+    output[l] = dt_alloc_align_float((size_t)dl(w,l) * dl(h,l));
+    for(int k=0;k<num_gamma;k++)
+      buf[k][l] = dt_alloc_align_float((size_t)dl(w,l) * dl(h,l));
+  }
+
+  // tile pyramids per thread: input, output and one for every gamma level
+  const size_t pyrsize = ll_block_pyramid_size();
+  size_t scratch_size;
+  float *const scratch = dt_alloc_perthread_float((2 + num_gamma) * pyrsize, &scratch_size);
+
+  // evenly sample brightness [0,1]:
+  float gamma[num_gamma] = {0.0f};
+  for(int k=0;k<num_gamma;k++) gamma[k] = (k+.5f)/(float)num_gamma;
+
+  const int nbx = (w + ll_block_size - 1) / ll_block_size;
+  const int nby = (h + ll_block_size - 1) / ll_block_size;
+
+  // first sweep: coarse levels of the input and of all processed images
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(nbx, nby, w, h, scratch, scratch_size, pyrsize, use_sse2, \
+                      sigma, shadows, highlights, clarity) \
+  shared(padded, buf, gamma) \
+  schedule(dynamic) \
+  collapse(2)
+#endif
+  for(int by=0;by<nby;by++) for(int bx=0;bx<nbx;bx++)
+  {
+    ll_block_t t;
+    ll_block_init(&t, bx, by, w, h, ll_block_overlap_reduce);
+    float *const base = dt_get_perthread(scratch, scratch_size);
+    float *tpad[ll_block_levels+1], *tbuf[ll_block_levels+1];
+    ll_block_pyramid(base, tpad, t.wd, t.ht);
+    ll_block_pyramid(base + pyrsize, tbuf, t.wd, t.ht);
+
+    ll_copy_rect(tpad[0], t.wd, padded[0] + (size_t)t.y*w + t.x, w, t.wd, t.ht);
+    ll_block_reduce(tpad, &t, use_sse2);
+    ll_block_store_coarse(padded[ll_block_levels], w, h, tpad[ll_block_levels], &t);
+    for(int k=0;k<num_gamma;k++)
+    {
+      apply_curve_block(tbuf[0], tpad[0], (size_t)t.wd*t.ht, gamma[k], sigma, shadows, highlights, clarity);
+      ll_block_reduce(tbuf, &t, use_sse2);
+      ll_block_store_coarse(buf[k][ll_block_levels], w, h, tbuf[ll_block_levels], &t);
+    }
+  }
+
+  // coarse levels on the whole image, like the unblocked version does
+#if defined(__SSE2__)
+  if(use_sse2)
+  {
+    for(int l=ll_block_levels+1;l<last_level;l++)
+      gauss_reduce_sse2(padded[l-1], padded[l], dl(w,l-1), dl(h,l-1));
+    gauss_reduce_sse2(padded[last_level-1], output[last_level], dl(w,last_level-1), dl(h,last_level-1));
+    for(int k=0;k<num_gamma;k++) for(int l=ll_block_levels+1;l<=last_level;l++)
+      gauss_reduce_sse2(buf[k][l-1], buf[k][l], dl(w,l-1), dl(h,l-1));
+  }
+  else
+#endif
+  {
+    for(int l=ll_block_levels+1;l<last_level;l++)
+      gauss_reduce(padded[l-1], padded[l], dl(w,l-1), dl(h,l-1));
+    gauss_reduce(padded[last_level-1], output[last_level], dl(w,last_level-1), dl(h,last_level-1));
+    for(int k=0;k<num_gamma;k++) for(int l=ll_block_levels+1;l<=last_level;l++)
+      gauss_reduce(buf[k][l-1], buf[k][l], dl(w,l-1), dl(h,l-1));
+  }
+  ll_assemble(output, padded, buf, gamma, w, h, ll_block_levels, last_level);
+
+  // second sweep: fine levels, all gamma levels in one go per tile
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(nbx, nby, w, h, wd, ht, max_supp, input, out, scratch, scratch_size, pyrsize, \
+                      use_sse2, sigma, shadows, highlights, clarity) \
+  shared(padded, output, gamma) \
+  schedule(dynamic) \
+  collapse(2)
+#endif
+  for(int by=0;by<nby;by++) for(int bx=0;bx<nbx;bx++)
+  {
+    ll_block_t t;
+    ll_block_init(&t, bx, by, w, h, ll_block_overlap);
+    // skip tiles which only cover the padding
+    if(t.ix + t.iwd <= max_supp || t.ix >= max_supp + wd ||
+       t.iy + t.iht <= max_supp || t.iy >= max_supp + ht) continue;
+
+    float *const base = dt_get_perthread(scratch, scratch_size);
+    float *tpad[max_levels] = {0}, *tout[max_levels] = {0}, *tbuf[num_gamma][max_levels] = {{0}};
+    ll_block_pyramid(base, tpad, t.wd, t.ht);
+    ll_block_pyramid(base + pyrsize, tout, t.wd, t.ht);
+    for(int k=0;k<num_gamma;k++)
+      ll_block_pyramid(base + (2+k)*pyrsize, tbuf[k], t.wd, t.ht);
+
+    ll_copy_rect(tpad[0], t.wd, padded[0] + (size_t)t.y*w + t.x, w, t.wd, t.ht);
+    ll_block_reduce(tpad, &t, use_sse2);
+    for(int k=0;k<num_gamma;k++)
+    {
+      apply_curve_block(tbuf[k][0], tpad[0], (size_t)t.wd*t.ht, gamma[k], sigma, shadows, highlights, clarity);
+      ll_block_reduce(tbuf[k], &t, use_sse2);
+    }
+
+    // collapse the tile pyramid, starting from the coarse output of the whole image
+    const int pw = dl(w,ll_block_levels);
+    ll_copy_rect(tout[ll_block_levels], dl(t.wd,ll_block_levels),
+                 output[ll_block_levels] + (size_t)(t.y >> ll_block_levels)*pw + (t.x >> ll_block_levels), pw,
+                 dl(t.wd,ll_block_levels), dl(t.ht,ll_block_levels));
+    ll_assemble(tout, tpad, tbuf, gamma, t.wd, t.ht, 0, ll_block_levels);
+
+    // write the inner part which is inside the roi
+    const int x0 = MAX(t.ix, max_supp), x1 = MIN(t.ix + t.iwd, max_supp + wd);
+    const int y0 = MAX(t.iy, max_supp), y1 = MIN(t.iy + t.iht, max_supp + ht);
+    for(int j=y0;j<y1;j++) for(int i=x0;i<x1;i++)
+    {
+      const size_t o = 4*((size_t)(j-max_supp)*wd+i-max_supp);
+      out[o+0] = 100.0f * tout[0][(size_t)(j-t.y)*t.wd+i-t.x]; // [0,1] -> L
+      out[o+1] = input[o+1]; // copy original colour channels
+      out[o+2] = input[o+2];
+    }
+  }
+
+  dt_free_align(scratch);
+  for(int l=0;l<max_levels;l++)
+  {
+    dt_free_align(padded[l]);
+    dt_free_align(output[l]);
+    for(int k=0;k<num_gamma;k++) dt_free_align(buf[k][l]);
+  }
+}
+
 void local_laplacian_internal(
     const float *const input,   // input buffer in some Labx or yuvx format
     float *const out,           // output buffer with colour
@@ -576,6 +941,15 @@ void local_laplacian_internal(
 
   // don't divide by 2 more often than we can:
   const int num_levels = MIN(max_levels, 31-__builtin_clz(MIN(wd,ht)));
+
+  // the cache blocked version can't collect or use the preview pyramid,
+  // and needs some coarse levels to be processed on the whole image.
+  if((!b || b->mode == 0) && num_levels-1 > ll_block_levels)
+  {
+    local_laplacian_blocked(input, out, wd, ht, sigma, shadows, highlights, clarity, use_sse2, num_levels);
+    return;
+  }
+
   int last_level = num_levels-1;
   if(b && b->mode == 2) // higher number here makes it less prone to aliasing and slower.
     last_level = num_levels > 4 ? 4 : num_levels-1;
@@ -703,36 +1077,7 @@ void local_laplacian_internal(
   }
 
   // assemble output pyramid coarse to fine
-  for(int l=last_level-1;l >= 0; l--)
-  {
-    const int pw = dl(w,l), ph = dl(h,l);
-
-    gauss_expand(output[l+1], output[l], pw, ph);
-    // go through all coefficients in the upsampled gauss buffer:
-#ifdef _OPENMP
-#pragma omp parallel for default(none) \
-    dt_omp_firstprivate(ph, pw) \
-    shared(w,h,buf,output,l,gamma,padded) \
-    schedule(static) \
-    collapse(2)
-#endif
-    for(int j=0;j<ph;j++) for(int i=0;i<pw;i++)
-    {
-      const float v = padded[l][j*pw+i];
-      int hi = 1;
-      for(;hi<num_gamma-1 && gamma[hi] <= v;hi++);
-      int lo = hi-1;
-      const float a = CLAMPS((v - gamma[lo])/(gamma[hi]-gamma[lo]), 0.0f, 1.0f);
-      const float l0 = ll_laplacian(buf[lo][l+1], buf[lo][l], i, j, pw, ph);
-      const float l1 = ll_laplacian(buf[hi][l+1], buf[hi][l], i, j, pw, ph);
-      output[l][j*pw+i] += l0 * (1.0f-a) + l1 * a;
-      // we could do this to save on memory (no need for finest buf[][]).
-      // unfortunately it results in a quite noticeable loss of sharpness, i think
-      // the extra level is worth it.
-      // else if(l == 0) // use finest scale from input to not amplify noise (and use less memory)
-      //   output[l][j*pw+i] += ll_laplacian(padded[l+1], padded[l], i, j, pw, ph);
-    }
-  }
+  ll_assemble(output, padded, buf, gamma, w, h, 0, last_level);
 #ifdef _OPENMP
 #pragma omp parallel for default(none) \
   dt_omp_firstprivate(ht, input, max_supp, out, wd) \
@@ -776,6 +1121,32 @@ size_t local_laplacian_memory_use(const int width,     // width of input image
 
   size_t memory_use = 0;
 
+  if(num_levels-1 > ll_block_levels)
+  { // blocked version: padded input, coarse levels of all pyramids, and the tiles of all threads
+    memory_use += sizeof(float) * dl(paddwd, 0) * dl(paddht, 0);
+    for(int l=ll_block_levels;l<num_levels;l++)
+      memory_use += sizeof(float) * (2 + num_gamma) * dl(paddwd, l) * dl(paddht, l);
+    memory_use += sizeof(float) * (2 + num_gamma) * ll_block_pyramid_size() * dt_get_num_threads();
+    return memory_use;
+  }
+
+  for(int l=0;l<num_levels;l++)
+    memory_use += sizeof(float) * (2 + num_gamma) * dl(paddwd, l) * dl(paddht, l);
+
+  return memory_use;
+}
+
+size_t local_laplacian_memory_use_cl(const int width,     // width of input image
+                                     const int height)    // height of input image
+{
+  // the opencl code keeps all pyramids at full size
+  const int num_levels = MIN(max_levels, 31-__builtin_clz(MIN(width,height)));
+  const int max_supp = 1<<(num_levels-1);
+  const int paddwd = width  + 2*max_supp;
+  const int paddht = height + 2*max_supp;
+
+  size_t memory_use = 0;
+
   for(int l=0;l<num_levels;l++)
     memory_use += sizeof(float) * (2 + num_gamma) * dl(paddwd, l) * dl(paddht, l);
 
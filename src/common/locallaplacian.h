@@ -76,6 +76,10 @@ size_t local_laplacian_memory_use(const int width,      // width of input image
                                   const int height);    // height of input image
 
 
+// memory needed by the opencl version, which keeps all pyramids for the full image
+size_t local_laplacian_memory_use_cl(const int width,      // width of input image
+                                     const int height);    // height of input image
+
 size_t local_laplacian_singlebuffer_size(const int width,       // width of input image
                                          const int height);     // height of input image
 
@@ -37,6 +37,7 @@
 #include <glib/gstdio.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -1310,6 +1311,106 @@ static void _init_8(uint8_t *buf, uint32_t *width, uint32_t *height, float *isca
   // TODO: if output is cropped, don't use mipf!
 }
 
+int dt_mipmap_cache_prefill_embedded(dt_mipmap_cache_t *cache, const uint32_t imgid, const dt_mipmap_size_t mip,
+                                     dt_mipmap_prefill_stats_t *stats)
+{
+  if(!cache->cachedir[0] || mip >= DT_MIPMAP_8 || !dt_conf_get_bool("cache_disk_backend")) return 1;
+
+  char dirname[PATH_MAX] = { 0 };
+  char cachename[PATH_MAX] = { 0 };
+  snprintf(dirname, sizeof(dirname), "%s.d/%d", cache->cachedir, (int)mip);
+  snprintf(cachename, sizeof(cachename), "%s/%" PRIu32 ".jpg", dirname, imgid);
+  if(g_file_test(cachename, G_FILE_TEST_EXISTS))
+  {
+    stats->skipped++;
+    return 0;
+  }
+
+  // same conditions as for the embedded thumbnail in _init_8()
+  char *min = dt_conf_get_string("plugins/lighttable/thumbnail_raw_min_level");
+  const dt_mipmap_size_t min_s = dt_mipmap_cache_get_min_mip_from_pref(min);
+  g_free(min);
+  if(mip > min_s || dt_image_altered(imgid)) return 1;
+
+  const dt_image_t *cimg = dt_image_cache_get(darktable.image_cache, imgid, 'r');
+  const int incompatible = !strncmp(cimg->exif_maker, "Phase One", 9);
+  const int imgwd = cimg->width, imght = cimg->height;
+  dt_image_cache_read_release(darktable.image_cache, cimg);
+  if(incompatible) return 1;
+
+  char filename[PATH_MAX] = { 0 };
+  gboolean from_cache = TRUE;
+  dt_image_full_path(imgid, filename, sizeof(filename), &from_cache);
+  const char *c = filename + strlen(filename);
+  while(*c != '.' && c > filename) c--;
+  if(!*filename || !strcasecmp(c, ".jpg") || !g_file_test(filename, G_FILE_TEST_EXISTS)) return 1;
+
+  const uint32_t wd = cache->max_width[mip], ht = cache->max_height[mip];
+  int res = 1;
+  uint8_t *blob = NULL, *tmp = NULL, *out = NULL;
+  char *mime_type = NULL;
+  size_t blobsize = 0;
+
+  // stage 1: get the embedded preview out of the raw
+  const double start = dt_get_wtime();
+  if(dt_exif_get_thumbnail(filename, &blob, &blobsize, &mime_type) || strcmp(mime_type, "image/jpeg")) goto error;
+  const double extracted = dt_get_wtime();
+
+  // stage 2: decode, letting libjpeg do most of the downscaling, then flip and fit
+  dt_imageio_jpeg_t jpg;
+  if(dt_imageio_jpeg_decompress_header(blob, blobsize, &jpg)) goto error;
+  // the thumbnail might end up rotated, so make sure it covers the box either way
+  const int full_width = jpg.width, full_height = jpg.height;
+  const float scale = fmaxf(fminf((float)wd / full_width, (float)ht / full_height),
+                            fminf((float)ht / full_width, (float)wd / full_height));
+  dt_imageio_jpeg_decompress_scaled(&jpg, ceilf(scale * full_width), ceilf(scale * full_height));
+  tmp = (uint8_t *)dt_alloc_align(64, sizeof(uint8_t) * 4 * jpg.width * jpg.height);
+  out = (uint8_t *)dt_alloc_align(64, sizeof(uint8_t) * 4 * wd * ht);
+  // if the embedded preview is smaller than what we need, leave it to the pixelpipe
+  const gboolean too_small = full_width < (int)wd && full_height < (int)ht && full_width < imgwd - 4
+                             && full_height < imght - 4;
+  if(!tmp || !out || too_small)
+  {
+    jpeg_destroy_decompress(&jpg.dinfo);
+    goto error;
+  }
+  if(dt_imageio_jpeg_decompress(&jpg, tmp)) goto error;
+  uint32_t width = 0, height = 0;
+  dt_iop_flip_and_zoom_8(tmp, jpg.width, jpg.height, out, wd, ht, dt_image_get_orientation(imgid), &width,
+                         &height);
+  const double decoded = dt_get_wtime();
+
+  // stage 3: write to the disk cache, the way dt_mipmap_cache_deallocate_dynamic() would
+  if(g_mkdir_with_parents(dirname, 0750)) goto error;
+  const int cache_quality = dt_conf_get_int("database_cache_quality");
+  if(dt_imageio_jpeg_write(cachename, out, width, height, MIN(100, MAX(10, cache_quality)),
+                           dt_mipmap_cache_exif_data_srgb, dt_mipmap_cache_exif_data_srgb_length))
+  {
+    g_unlink(cachename);
+    goto error;
+  }
+  const double written = dt_get_wtime();
+
+  GStatBuf st;
+  stats->extract_time += extracted - start;
+  stats->decode_time += decoded - extracted;
+  stats->write_time += written - decoded;
+  stats->extract_bytes += blobsize;
+  stats->write_bytes += g_stat(cachename, &st) ? 0 : st.st_size;
+  stats->extracted++;
+  stats->written++;
+  dt_print(DT_DEBUG_CACHE, "[mipmap_cache] prefill mip %d for image %d from embedded jpeg\n", mip, imgid);
+  res = 0;
+
+error:
+  if(res) stats->failed++;
+  dt_free_align(out);
+  dt_free_align(tmp);
+  free(mime_type);
+  free(blob);
+  return res;
+}
+
 dt_colorspaces_color_profile_type_t dt_mipmap_cache_get_colorspace()
 {
   if(dt_conf_get_bool("cache_color_managed"))
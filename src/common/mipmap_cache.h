@@ -167,6 +167,20 @@ void dt_mipmap_cache_copy_thumbnails(const dt_mipmap_cache_t *cache, const uint3
 
 // return the mipmap corresponding to text value saved in prefs
 dt_mipmap_size_t dt_mipmap_cache_get_min_mip_from_pref(char *value);
+
+// time spent and work done by dt_mipmap_cache_prefill_embedded(), summed over all calls
+typedef struct dt_mipmap_prefill_stats_t
+{
+  double extract_time, decode_time, write_time;
+  size_t extract_bytes, write_bytes;
+  int extracted, written, skipped, failed;
+} dt_mipmap_prefill_stats_t;
+
+// write the on-disk thumbnail of the given size straight from the preview embedded in the raw, bypassing the
+// memory cache. only does something if the disk backend is enabled and the thumbnail doesn't exist yet.
+// returns 0 if the thumbnail is on disk afterwards. safe to call from several threads, each with its own stats.
+int dt_mipmap_cache_prefill_embedded(dt_mipmap_cache_t *cache, const uint32_t imgid, const dt_mipmap_size_t mip,
+                                     dt_mipmap_prefill_stats_t *stats);
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
 // kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
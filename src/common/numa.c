@@ -0,0 +1,164 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "common/numa.h"
+#include "common/darktable.h"
+#include "control/conf.h"
+#include "control/jobs.h"
+
+#include <glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// the page size first touch works with. huge pages are placed as a whole by their first touch anyway.
+#define DT_NUMA_PAGE_SIZE 4096
+
+#if defined(__linux__)
+static int _numa_count_nodes()
+{
+  int nodes = 0;
+  for(;; nodes++)
+  {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", nodes);
+    if(!g_file_test(path, G_FILE_TEST_IS_DIR)) break;
+  }
+  return nodes;
+}
+
+// parse a sysfs cpu list like "0-7,16-23" into a cpu set
+static gboolean _numa_node_cpus(const int node, cpu_set_t *set)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  gchar *list = NULL;
+  if(!g_file_get_contents(path, &list, NULL, NULL)) return FALSE;
+
+  CPU_ZERO(set);
+  int count = 0;
+  gchar **ranges = g_strsplit(g_strstrip(list), ",", -1);
+  for(gchar **r = ranges; *r; r++)
+  {
+    if(!**r) continue;
+    char *end = NULL;
+    const long first = strtol(*r, &end, 10);
+    const long last = (*end == '-') ? strtol(end + 1, NULL, 10) : first;
+    for(long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+    {
+      CPU_SET(cpu, set);
+      count++;
+    }
+  }
+  g_strfreev(ranges);
+  g_free(list);
+  return count > 0;
+}
+#endif
+
+void dt_numa_init(void)
+{
+  darktable.huge_pages = dt_conf_get_bool("memory_huge_pages");
+  darktable.numa_nodes = 1;
+#if defined(__linux__)
+  darktable.numa_nodes = MAX(1, _numa_count_nodes());
+#endif
+  dt_print(DT_DEBUG_MEMORY, "[numa] %d node(s), huge pages for large buffers %s\n", darktable.numa_nodes,
+           darktable.huge_pages ? "enabled" : "disabled");
+}
+
+void dt_numa_first_touch(void *buf, const size_t size)
+{
+#ifdef _OPENMP
+  // on a single node machine placement doesn't matter, and inside a parallel region there's no team to
+  // spread the pages over
+  if(darktable.numa_nodes < 2 || omp_in_parallel()) return;
+
+  char *const mem = (char *)buf;
+  const size_t pages = (size + DT_NUMA_PAGE_SIZE - 1) / DT_NUMA_PAGE_SIZE;
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(mem, pages, size) \
+  schedule(static)
+  for(size_t k = 0; k < pages; k++)
+  {
+    const size_t offset = k * DT_NUMA_PAGE_SIZE;
+    mem[offset] = 0;
+    if(offset + DT_NUMA_PAGE_SIZE > size) mem[size - 1] = 0;
+  }
+#endif
+}
+
+void *dt_numa_bind_thread(const int node)
+{
+#if defined(__linux__)
+  if(darktable.numa_nodes < 2) return NULL;
+
+  cpu_set_t cpus;
+  if(!_numa_node_cpus(node % darktable.numa_nodes, &cpus)) return NULL;
+
+  cpu_set_t *saved = malloc(sizeof(cpu_set_t));
+  if(!saved) return NULL;
+  if(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), saved)
+     || pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus))
+  {
+    free(saved);
+    return NULL;
+  }
+
+#ifdef _OPENMP
+  // the openmp team of this thread lives as long as the thread, so its members have to be moved as well
+#pragma omp parallel default(none) dt_omp_firstprivate(cpus)
+  sched_setaffinity(0, sizeof(cpu_set_t), &cpus);
+#endif
+
+  dt_print(DT_DEBUG_MEMORY, "[numa] bound thread %d to node %d\n", dt_control_get_threadid(),
+           node % darktable.numa_nodes);
+  return saved;
+#else
+  return NULL;
+#endif
+}
+
+void dt_numa_unbind_thread(void *saved)
+{
+#if defined(__linux__)
+  if(!saved) return;
+  cpu_set_t *cpus = (cpu_set_t *)saved;
+
+#ifdef _OPENMP
+#pragma omp parallel default(none) dt_omp_firstprivate(cpus)
+  sched_setaffinity(0, sizeof(cpu_set_t), cpus);
+#endif
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), cpus);
+  free(saved);
+#endif
+}
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
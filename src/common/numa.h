@@ -0,0 +1,42 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+// buffers of at least this size are allocated as large buffers, see dt_alloc_align()
+#define DT_NUMA_LARGE_BUFFER_SIZE ((size_t)8 << 20)
+// alignment of large buffers, the size of a transparent huge page on x86_64 and aarch64
+#define DT_NUMA_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+// detect the numa nodes of the machine and read the memory placement settings. needs the config backend.
+void dt_numa_init(void);
+
+// touch every page of a freshly allocated buffer from the openmp threads, with the same static schedule the
+// pixel loops use, so that on a numa machine each page ends up on the node of the thread that processes it.
+void dt_numa_first_touch(void *buf, const size_t size);
+
+// bind the calling thread and its openmp team to the cpus of the given numa node. returns the previous
+// binding, to be passed to dt_numa_unbind_thread(), or NULL if nothing was changed.
+void *dt_numa_bind_thread(const int node);
+void dt_numa_unbind_thread(void *saved);
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
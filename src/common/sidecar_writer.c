@@ -0,0 +1,281 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "common/sidecar_writer.h"
+#include "common/darktable.h"
+#include "common/debug.h"
+#include "common/exif.h"
+#include "common/image.h"
+
+#include <glib/gstdio.h>
+#include <sqlite3.h>
+#include <inttypes.h>
+
+// number of images whose last write is remembered, the least recently used ones are forgotten first
+#define DT_SIDECAR_STATE_SIZE 4096
+
+typedef struct dt_sidecar_state_t
+{
+  gchar *filename;
+  gchar *checksum; // md5 of the database part of the xmp packet
+  gint64 mtime;    // sidecar time stamp and size right after our write
+  gint64 size;
+  GList *link;     // position in dt_sidecar_writer_t.state_lru
+} dt_sidecar_state_t;
+
+static void _sidecar_state_free(gpointer data)
+{
+  dt_sidecar_state_t *state = (dt_sidecar_state_t *)data;
+  g_free(state->filename);
+  g_free(state->checksum);
+  g_free(state);
+}
+
+// drop what we know about the last write of imgid, needs w->lock
+static void _sidecar_state_forget(dt_sidecar_writer_t *w, const int32_t imgid)
+{
+  dt_sidecar_state_t *state = g_hash_table_lookup(w->state, GINT_TO_POINTER(imgid));
+  if(!state) return;
+  g_queue_delete_link(w->state_lru, state->link);
+  g_hash_table_remove(w->state, GINT_TO_POINTER(imgid));
+}
+
+static gboolean _sidecar_filename(const int32_t imgid, char *filename, const size_t size)
+{
+  // FIRST: check if the original file is present
+  gboolean from_cache = FALSE;
+  dt_image_full_path(imgid, filename, size, &from_cache);
+
+  if(!g_file_test(filename, G_FILE_TEST_EXISTS))
+  {
+    // OTHERWISE: check if the local copy exists
+    from_cache = TRUE;
+    dt_image_full_path(imgid, filename, size, &from_cache);
+
+    //  nothing to do, the original is not accessible and there is no local copy
+    if(!from_cache) return FALSE;
+  }
+
+  dt_image_path_append_version(imgid, filename, size);
+  g_strlcat(filename, ".xmp", size);
+  return TRUE;
+}
+
+static void _sidecar_writer_process(dt_sidecar_writer_t *w, const int32_t imgid)
+{
+  char filename[PATH_MAX] = { 0 };
+  if(!_sidecar_filename(imgid, filename, sizeof(filename))) return;
+
+  // the file needs no rewrite if the database content is the one we wrote last time and nobody
+  // touched the file since. this avoids reading and parsing the old sidecar, too.
+  gchar *checksum = w ? dt_exif_xmp_database_checksum(imgid) : NULL;
+  GStatBuf st;
+  if(checksum && g_stat(filename, &st) == 0)
+  {
+    dt_pthread_mutex_lock(&w->lock);
+    dt_sidecar_state_t *state = g_hash_table_lookup(w->state, GINT_TO_POINTER(imgid));
+    const gboolean unchanged = state && !g_strcmp0(state->checksum, checksum)
+                               && !g_strcmp0(state->filename, filename) && state->mtime == (gint64)st.st_mtime
+                               && state->size == (gint64)st.st_size;
+    if(unchanged)
+    {
+      w->skipped++;
+      g_queue_unlink(w->state_lru, state->link);
+      g_queue_push_tail_link(w->state_lru, state->link);
+    }
+    dt_pthread_mutex_unlock(&w->lock);
+    if(unchanged)
+    {
+      g_free(checksum);
+      return;
+    }
+  }
+
+  gboolean written = FALSE;
+  if(!dt_exif_xmp_write_with_status(imgid, filename, &written))
+  {
+    // put the timestamp into db. this can't be done in exif.cc since that code gets called
+    // for the copy exporter, too
+    sqlite3_stmt *stmt;
+    DT_DEBUG_SQLITE3_PREPARE_V2
+      (dt_database_get(darktable.db),
+       "UPDATE main.images SET write_timestamp = STRFTIME('%s', 'now') WHERE id = ?1",
+       -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if(w)
+    {
+      dt_pthread_mutex_lock(&w->lock);
+      if(written)
+        w->written++;
+      else
+        w->skipped++;
+      _sidecar_state_forget(w, imgid);
+      if(checksum && g_stat(filename, &st) == 0)
+      {
+        dt_sidecar_state_t *state = (dt_sidecar_state_t *)g_malloc(sizeof(dt_sidecar_state_t));
+        state->filename = g_strdup(filename);
+        state->checksum = checksum;
+        state->mtime = st.st_mtime;
+        state->size = st.st_size;
+        g_queue_push_tail(w->state_lru, GINT_TO_POINTER(imgid));
+        state->link = g_queue_peek_tail_link(w->state_lru);
+        g_hash_table_insert(w->state, GINT_TO_POINTER(imgid), state);
+        checksum = NULL;
+        // forget the images written longest ago
+        while(g_queue_get_length(w->state_lru) > DT_SIDECAR_STATE_SIZE)
+          _sidecar_state_forget(w, GPOINTER_TO_INT(g_queue_peek_head(w->state_lru)));
+      }
+      dt_pthread_mutex_unlock(&w->lock);
+    }
+  }
+  g_free(checksum);
+}
+
+void dt_sidecar_writer_write(dt_sidecar_writer_t *w, const int32_t imgid)
+{
+  if(!w)
+  {
+    _sidecar_writer_process(NULL, imgid);
+    return;
+  }
+  dt_pthread_mutex_lock(&w->write_lock);
+  _sidecar_writer_process(w, imgid);
+  dt_pthread_mutex_unlock(&w->write_lock);
+}
+
+static void *_sidecar_writer_thread(void *data)
+{
+  dt_sidecar_writer_t *w = (dt_sidecar_writer_t *)data;
+  dt_pthread_setname("sidecar writer");
+
+  dt_pthread_mutex_lock(&w->lock);
+  while(TRUE)
+  {
+    while(w->running && g_queue_is_empty(w->queue)) dt_pthread_cond_wait(&w->cond, &w->lock);
+    // keep going after a stop request until the queue is drained
+    if(g_queue_is_empty(w->queue)) break;
+
+    const int32_t imgid = GPOINTER_TO_INT(g_queue_pop_head(w->queue));
+    // a request coming in while we write has to be written again, the database may have changed
+    g_hash_table_remove(w->pending, GINT_TO_POINTER(imgid));
+    w->busy = TRUE;
+    dt_pthread_mutex_unlock(&w->lock);
+
+    dt_sidecar_writer_write(w, imgid);
+
+    dt_pthread_mutex_lock(&w->lock);
+    w->busy = FALSE;
+    pthread_cond_broadcast(&w->cond);
+  }
+  dt_pthread_mutex_unlock(&w->lock);
+  return NULL;
+}
+
+void dt_sidecar_writer_init(dt_sidecar_writer_t *w, const gboolean threaded)
+{
+  dt_pthread_mutex_init(&w->lock, NULL);
+  dt_pthread_mutex_init(&w->write_lock, NULL);
+  pthread_cond_init(&w->cond, NULL);
+  w->queue = g_queue_new();
+  w->pending = g_hash_table_new(NULL, NULL);
+  w->state = g_hash_table_new_full(NULL, NULL, NULL, _sidecar_state_free);
+  w->state_lru = g_queue_new();
+  w->queued = w->coalesced = w->written = w->skipped = 0;
+  w->busy = FALSE;
+  w->running = w->threaded = threaded;
+  if(threaded && dt_pthread_create(&w->thread, _sidecar_writer_thread, w))
+  {
+    fprintf(stderr, "[sidecar_writer] could not start writer thread, writing synchronously\n");
+    w->running = w->threaded = FALSE;
+  }
+}
+
+void dt_sidecar_writer_cleanup(dt_sidecar_writer_t *w)
+{
+  if(w->threaded)
+  {
+    dt_pthread_mutex_lock(&w->lock);
+    w->running = FALSE;
+    pthread_cond_broadcast(&w->cond);
+    dt_pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    w->threaded = FALSE;
+  }
+  dt_sidecar_writer_print(w);
+
+  g_queue_free(w->queue);
+  g_hash_table_destroy(w->pending);
+  g_hash_table_destroy(w->state);
+  g_queue_free(w->state_lru);
+  pthread_cond_destroy(&w->cond);
+  dt_pthread_mutex_destroy(&w->write_lock);
+  dt_pthread_mutex_destroy(&w->lock);
+}
+
+void dt_sidecar_writer_print(dt_sidecar_writer_t *w)
+{
+  dt_pthread_mutex_lock(&w->lock);
+  dt_print(DT_DEBUG_CACHE,
+           "[sidecar_writer] %" PRIu64 " requests, %" PRIu64 " coalesced, %" PRIu64 " written, %" PRIu64
+           " skipped as unchanged\n",
+           w->queued, w->coalesced, w->written, w->skipped);
+  dt_pthread_mutex_unlock(&w->lock);
+}
+
+void dt_sidecar_writer_queue(dt_sidecar_writer_t *w, const int32_t imgid)
+{
+  if(!w || !w->threaded)
+  {
+    if(w)
+    {
+      dt_pthread_mutex_lock(&w->lock);
+      w->queued++;
+      dt_pthread_mutex_unlock(&w->lock);
+    }
+    dt_sidecar_writer_write(w, imgid);
+    return;
+  }
+
+  dt_pthread_mutex_lock(&w->lock);
+  w->queued++;
+  if(g_hash_table_contains(w->pending, GINT_TO_POINTER(imgid)))
+    w->coalesced++;
+  else
+  {
+    g_hash_table_add(w->pending, GINT_TO_POINTER(imgid));
+    g_queue_push_tail(w->queue, GINT_TO_POINTER(imgid));
+    pthread_cond_broadcast(&w->cond);
+  }
+  dt_pthread_mutex_unlock(&w->lock);
+}
+
+void dt_sidecar_writer_flush(dt_sidecar_writer_t *w)
+{
+  if(!w || !w->threaded) return;
+  dt_pthread_mutex_lock(&w->lock);
+  while(!g_queue_is_empty(w->queue) || w->busy) dt_pthread_cond_wait(&w->cond, &w->lock);
+  dt_pthread_mutex_unlock(&w->lock);
+}
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
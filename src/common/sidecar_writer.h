@@ -0,0 +1,67 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "common/dtpthread.h"
+
+#include <glib.h>
+#include <stdint.h>
+
+// background writer for xmp sidecar files.
+// requests are queued and coalesced per image, so tagging or rating a large selection
+// doesn't block the caller while exiv2 serializes and writes every single file.
+// a sidecar is only rewritten if the xmp generated from the database changed since the last
+// write, or if the file on disk was touched by someone else in the meantime.
+typedef struct dt_sidecar_writer_t
+{
+  dt_pthread_mutex_t lock;       // protects everything below except write_lock
+  dt_pthread_mutex_t write_lock; // serializes the actual file writes
+  pthread_cond_t cond;
+  pthread_t thread;
+  gboolean threaded, running, busy;
+
+  GQueue *queue;       // image ids in request order
+  GHashTable *pending; // image ids currently in the queue, for coalescing
+  GHashTable *state;   // image id -> dt_sidecar_state_t of the last write
+  GQueue *state_lru;   // image ids in state, least recently used first
+
+  // statistics
+  uint64_t queued;    // write requests
+  uint64_t coalesced; // requests merged into one already pending
+  uint64_t written;   // files actually written
+  uint64_t skipped;   // files left alone because the content didn't change
+} dt_sidecar_writer_t;
+
+// without threaded all requests are written synchronously, but still skipped if unchanged.
+void dt_sidecar_writer_init(dt_sidecar_writer_t *w, const gboolean threaded);
+// writes all pending sidecars and stops the writer thread.
+void dt_sidecar_writer_cleanup(dt_sidecar_writer_t *w);
+void dt_sidecar_writer_print(dt_sidecar_writer_t *w);
+
+// queue the sidecar of imgid for writing. w may be NULL, then it's written right away.
+void dt_sidecar_writer_queue(dt_sidecar_writer_t *w, const int32_t imgid);
+// write the sidecar of imgid now, on the calling thread.
+void dt_sidecar_writer_write(dt_sidecar_writer_t *w, const int32_t imgid);
+// blocks until all queued sidecars are written.
+void dt_sidecar_writer_flush(dt_sidecar_writer_t *w);
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
@@ -0,0 +1,552 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/tag_index.h"
+#include "common/darktable.h"
+#include "common/debug.h"
+#include "common/tags.h"
+
+#include <inttypes.h>
+#include <sqlite3.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct dt_tag_index_node_t
+{
+  gchar *name;     // last element of the path
+  guint tagid;     // 0 if this is only a path element of other tags
+  gchar *tag;      // full name, NULL if tagid is 0
+  gchar *synonyms;
+  gint flags;
+  gboolean darktable; // one of the darktable|... tags
+
+  uint32_t count;  // images having this tag
+  uint32_t images; // images having this tag or any tag below
+  uint32_t tags;   // tags in this subtree, this one included
+  uint32_t stamp;
+
+  struct dt_tag_index_node_t *parent;
+  GHashTable *children; // name -> node, NULL as long as there are none
+} dt_tag_index_node_t;
+
+static void _node_free(dt_tag_index_node_t *node)
+{
+  if(!node) return;
+  if(node->children)
+  {
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, node->children);
+    while(g_hash_table_iter_next(&iter, NULL, &value)) _node_free((dt_tag_index_node_t *)value);
+    g_hash_table_destroy(node->children);
+  }
+  g_free(node->name);
+  g_free(node->tag);
+  g_free(node->synonyms);
+  g_free(node);
+}
+
+static dt_tag_index_node_t *_node_find(dt_tag_index_t *index, const char *name, const gboolean create)
+{
+  dt_tag_index_node_t *node = index->root;
+  gchar **tokens = g_strsplit(name, "|", -1);
+  for(gchar **token = tokens; *token && node; token++)
+  {
+    dt_tag_index_node_t *child = node->children ? g_hash_table_lookup(node->children, *token) : NULL;
+    if(!child && create)
+    {
+      child = g_malloc0(sizeof(dt_tag_index_node_t));
+      child->name = g_strdup(*token);
+      child->parent = node;
+      if(!node->children) node->children = g_hash_table_new(g_str_hash, g_str_equal);
+      g_hash_table_insert(node->children, child->name, child);
+    }
+    node = child;
+  }
+  g_strfreev(tokens);
+  return node;
+}
+
+static dt_tag_index_node_t *_tag_insert(dt_tag_index_t *index, const guint tagid, const char *name,
+                                        const gint flags, const char *synonyms)
+{
+  dt_tag_index_node_t *node = _node_find(index, name, TRUE);
+  if(!node->tagid)
+  {
+    node->tagid = tagid;
+    node->tag = g_strdup(name);
+    // same as the LIKE 'darktable|%' used for memory.darktable_tags
+    node->darktable = !g_ascii_strncasecmp(name, "darktable|", strlen("darktable|"));
+    for(dt_tag_index_node_t *n = node; n; n = n->parent) n->tags++;
+    g_hash_table_insert(index->tags, GUINT_TO_POINTER(tagid), node);
+  }
+  node->flags = flags;
+  g_free(node->synonyms);
+  node->synonyms = g_strdup(synonyms);
+  return node;
+}
+
+// read a tag the index doesn't know yet, returns NULL if it's not in the database either
+static dt_tag_index_node_t *_tag_load(dt_tag_index_t *index, const guint tagid)
+{
+  dt_tag_index_node_t *node = NULL;
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT name, flags, synonyms FROM data.tags WHERE id = ?1",
+                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
+  if(sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0))
+    node = _tag_insert(index, tagid, (const char *)sqlite3_column_text(stmt, 0), sqlite3_column_int(stmt, 1),
+                       (const char *)sqlite3_column_text(stmt, 2));
+  sqlite3_finalize(stmt);
+  return node;
+}
+
+// add (delta 1) or remove (delta -1) the tags of one image to the counters of the trie.
+// every node is counted once per image, even if several tags below it are attached.
+static void _image_account(dt_tag_index_t *index, const GArray *tags, const int delta)
+{
+  if(!tags) return;
+  const uint32_t stamp = ++index->stamp;
+  for(guint k = 0; k < tags->len; k++)
+  {
+    dt_tag_index_node_t *node = g_hash_table_lookup(index->tags, GUINT_TO_POINTER(g_array_index(tags, guint, k)));
+    if(!node) continue;
+    node->count += delta;
+    // once we hit a node visited before, all its parents have been visited as well
+    for(; node && node->stamp != stamp; node = node->parent)
+    {
+      node->stamp = stamp;
+      node->images += delta;
+    }
+  }
+}
+
+static gint _sort_tagid(gconstpointer a, gconstpointer b)
+{
+  const guint ta = *(const guint *)a;
+  const guint tb = *(const guint *)b;
+  return (ta > tb) - (ta < tb);
+}
+
+static gboolean _array_contains(const GArray *tags, const guint tagid)
+{
+  if(!tags || !tags->len) return FALSE;
+  return bsearch(&tagid, tags->data, tags->len, sizeof(guint), _sort_tagid) != NULL;
+}
+
+// replace the tag array of imgid, the index takes ownership of tags
+static void _image_set(dt_tag_index_t *index, const int32_t imgid, GArray *tags)
+{
+  _image_account(index, g_hash_table_lookup(index->images, GINT_TO_POINTER(imgid)), -1);
+  if(tags && tags->len)
+  {
+    g_array_sort(tags, _sort_tagid);
+    _image_account(index, tags, 1);
+    g_hash_table_insert(index->images, GINT_TO_POINTER(imgid), tags);
+  }
+  else
+  {
+    if(tags) g_array_unref(tags);
+    g_hash_table_remove(index->images, GINT_TO_POINTER(imgid));
+  }
+}
+
+static void _clear(dt_tag_index_t *index)
+{
+  g_hash_table_remove_all(index->images);
+  g_hash_table_remove_all(index->tags);
+  _node_free(index->root);
+  index->root = NULL;
+  index->valid = FALSE;
+}
+
+static void _build(dt_tag_index_t *index)
+{
+  const double start = dt_get_wtime();
+  _clear(index);
+  index->root = g_malloc0(sizeof(dt_tag_index_node_t));
+
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT id, name, flags, synonyms FROM data.tags",
+                              -1, &stmt, NULL);
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    if(!sqlite3_column_text(stmt, 1)) continue;
+    _tag_insert(index, sqlite3_column_int(stmt, 0), (const char *)sqlite3_column_text(stmt, 1),
+                sqlite3_column_int(stmt, 2), (const char *)sqlite3_column_text(stmt, 3));
+  }
+  sqlite3_finalize(stmt);
+
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT imgid, tagid FROM main.tagged_images ORDER BY imgid",
+                              -1, &stmt, NULL);
+  int32_t imgid = -1;
+  GArray *tags = NULL;
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    const int32_t id = sqlite3_column_int(stmt, 0);
+    const guint tagid = sqlite3_column_int(stmt, 1);
+    if(id != imgid)
+    {
+      if(tags) _image_set(index, imgid, tags);
+      tags = g_array_new(FALSE, FALSE, sizeof(guint));
+      imgid = id;
+    }
+    // the join with data.tags of the old queries dropped unknown tags as well
+    if(g_hash_table_contains(index->tags, GUINT_TO_POINTER(tagid))) g_array_append_val(tags, tagid);
+  }
+  if(tags) _image_set(index, imgid, tags);
+  sqlite3_finalize(stmt);
+
+  index->valid = TRUE;
+  index->builds++;
+  dt_print(DT_DEBUG_PERF, "[tag_index] %u tags on %u images indexed in %.3f secs\n",
+           g_hash_table_size(index->tags), g_hash_table_size(index->images), dt_get_wtime() - start);
+}
+
+// to be called with the lock held by all queries
+static void _ensure(dt_tag_index_t *index)
+{
+  if(!index->valid) _build(index);
+  index->queries++;
+}
+
+void dt_tag_index_init(dt_tag_index_t *index)
+{
+  dt_pthread_mutex_init(&index->lock, NULL);
+  index->valid = FALSE;
+  index->root = NULL;
+  index->tags = g_hash_table_new(NULL, NULL);
+  index->images = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)g_array_unref);
+  index->stamp = 0;
+  index->builds = index->queries = 0;
+}
+
+void dt_tag_index_cleanup(dt_tag_index_t *index)
+{
+  if(!index) return;
+  dt_print(DT_DEBUG_CACHE, "[tag_index] built %" PRIu64 " times, %" PRIu64 " queries\n", index->builds,
+           index->queries);
+  _clear(index);
+  g_hash_table_destroy(index->tags);
+  g_hash_table_destroy(index->images);
+  dt_pthread_mutex_destroy(&index->lock);
+}
+
+void dt_tag_index_invalidate(dt_tag_index_t *index)
+{
+  if(!index) return;
+  dt_pthread_mutex_lock(&index->lock);
+  _clear(index);
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+void dt_tag_index_tag_reload(dt_tag_index_t *index, const guint tagid)
+{
+  if(!index) return;
+  dt_pthread_mutex_lock(&index->lock);
+  if(index->valid)
+  {
+    sqlite3_stmt *stmt;
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                                "SELECT name, flags, synonyms FROM data.tags WHERE id = ?1",
+                                -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
+    const dt_tag_index_node_t *node = g_hash_table_lookup(index->tags, GUINT_TO_POINTER(tagid));
+    if(sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0))
+    {
+      const char *name = (const char *)sqlite3_column_text(stmt, 0);
+      // a renamed tag would have to move in the trie, start over instead
+      if(node && g_strcmp0(node->tag, name))
+        _clear(index);
+      else
+        _tag_insert(index, tagid, name, sqlite3_column_int(stmt, 1), (const char *)sqlite3_column_text(stmt, 2));
+    }
+    else if(node)
+      _clear(index);
+    sqlite3_finalize(stmt);
+  }
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+void dt_tag_index_image_changed(dt_tag_index_t *index, const int32_t imgid, const GList *before,
+                                const GList *after)
+{
+  if(!index) return;
+  dt_pthread_mutex_lock(&index->lock);
+  if(index->valid)
+  {
+    const GArray *old = g_hash_table_lookup(index->images, GINT_TO_POINTER(imgid));
+    GArray *tags = g_array_new(FALSE, FALSE, sizeof(guint));
+    // apply the difference with set semantics, same as the delete and insert just done on the database
+    for(guint k = 0; old && k < old->len; k++)
+    {
+      const guint tagid = g_array_index(old, guint, k);
+      if(!g_list_find((GList *)before, GUINT_TO_POINTER(tagid))
+         || g_list_find((GList *)after, GUINT_TO_POINTER(tagid)))
+        g_array_append_val(tags, tagid);
+    }
+    for(const GList *a = after; a; a = g_list_next(a))
+    {
+      const guint tagid = GPOINTER_TO_UINT(a->data);
+      if(g_list_find((GList *)before, a->data) || _array_contains(old, tagid)) continue;
+      if(g_hash_table_contains(index->tags, a->data) || _tag_load(index, tagid)) g_array_append_val(tags, tagid);
+    }
+    _image_set(index, imgid, tags);
+  }
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+void dt_tag_index_image_reload(dt_tag_index_t *index, const int32_t imgid)
+{
+  if(!index) return;
+  dt_pthread_mutex_lock(&index->lock);
+  if(index->valid)
+  {
+    GArray *tags = g_array_new(FALSE, FALSE, sizeof(guint));
+    sqlite3_stmt *stmt;
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                                "SELECT tagid FROM main.tagged_images WHERE imgid = ?1",
+                                -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
+    while(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      const guint tagid = sqlite3_column_int(stmt, 0);
+      // the caller might have created the tag directly in the database, too
+      if(g_hash_table_contains(index->tags, GUINT_TO_POINTER(tagid)) || _tag_load(index, tagid))
+        g_array_append_val(tags, tagid);
+    }
+    sqlite3_finalize(stmt);
+    _image_set(index, imgid, tags);
+  }
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+void dt_tag_index_image_removed(dt_tag_index_t *index, const int32_t imgid)
+{
+  if(!index) return;
+  dt_pthread_mutex_lock(&index->lock);
+  if(index->valid) _image_set(index, imgid, NULL);
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+static dt_tag_t *_tag_result(const dt_tag_index_node_t *node, const guint count, const guint nb_imgs,
+                             const guint imgnb)
+{
+  dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
+  t->id = node->tagid;
+  t->tag = g_strdup(node->tag);
+  t->leave = g_strrstr(t->tag, "|");
+  t->leave = t->leave ? t->leave + 1 : t->tag;
+  t->flags = node->flags;
+  t->synonym = g_strdup(node->synonyms);
+  t->count = count;
+  t->select = (nb_imgs == 0) ? DT_TS_NO_IMAGE :
+              (imgnb == nb_imgs) ? DT_TS_ALL_IMAGES :
+              (imgnb == 0) ? DT_TS_NO_IMAGE : DT_TS_SOME_IMAGES;
+  return t;
+}
+
+static gint _sort_result_by_name(gconstpointer a, gconstpointer b)
+{
+  return strcmp(((const dt_tag_t *)a)->tag, ((const dt_tag_t *)b)->tag);
+}
+
+// tag id -> number of imgs having the tag
+static GHashTable *_count_tags(dt_tag_index_t *index, const GList *imgs, guint *nb_imgs)
+{
+  GHashTable *counts = g_hash_table_new(NULL, NULL);
+  *nb_imgs = 0;
+  for(const GList *i = imgs; i; i = g_list_next(i))
+  {
+    (*nb_imgs)++;
+    const GArray *tags = g_hash_table_lookup(index->images, i->data);
+    for(guint k = 0; tags && k < tags->len; k++)
+    {
+      gpointer key = GUINT_TO_POINTER(g_array_index(tags, guint, k));
+      g_hash_table_insert(counts, key, GUINT_TO_POINTER(GPOINTER_TO_UINT(g_hash_table_lookup(counts, key)) + 1));
+    }
+  }
+  return counts;
+}
+
+GList *dt_tag_index_get_tags(dt_tag_index_t *index, const GList *imgs, const gboolean dt_tags,
+                             const gboolean user_tags)
+{
+  GList *result = NULL;
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  guint nb_imgs = 0;
+  GHashTable *counts = _count_tags(index, imgs, &nb_imgs);
+  GHashTableIter iter;
+  gpointer key;
+  g_hash_table_iter_init(&iter, counts);
+  while(g_hash_table_iter_next(&iter, &key, NULL))
+  {
+    const dt_tag_index_node_t *node = g_hash_table_lookup(index->tags, key);
+    if(node && (node->darktable ? dt_tags : user_tags)) result = g_list_prepend(result, key);
+  }
+  g_hash_table_destroy(counts);
+  dt_pthread_mutex_unlock(&index->lock);
+  return result;
+}
+
+gboolean dt_tag_index_is_attached(dt_tag_index_t *index, const guint tagid, const int32_t imgid)
+{
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  const gboolean res = _array_contains(g_hash_table_lookup(index->images, GINT_TO_POINTER(imgid)), tagid);
+  dt_pthread_mutex_unlock(&index->lock);
+  return res;
+}
+
+uint32_t dt_tag_index_images_count(dt_tag_index_t *index, const guint tagid)
+{
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  const dt_tag_index_node_t *node = g_hash_table_lookup(index->tags, GUINT_TO_POINTER(tagid));
+  const uint32_t count = node ? node->count : 0;
+  dt_pthread_mutex_unlock(&index->lock);
+  return count;
+}
+
+uint32_t dt_tag_index_get_attached(dt_tag_index_t *index, const GList *imgs, const gboolean ignore_dt_tags,
+                                   GList **result)
+{
+  GList *tags = NULL;
+  uint32_t count = 0;
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  guint nb_imgs = 0;
+  GHashTable *counts = _count_tags(index, imgs, &nb_imgs);
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, counts);
+  while(g_hash_table_iter_next(&iter, &key, &value))
+  {
+    const dt_tag_index_node_t *node = g_hash_table_lookup(index->tags, key);
+    if(!node || (ignore_dt_tags && node->darktable)) continue;
+    const guint imgnb = GPOINTER_TO_UINT(value);
+    tags = g_list_prepend(tags, _tag_result(node, imgnb, nb_imgs, imgnb));
+    count++;
+  }
+  g_hash_table_destroy(counts);
+  dt_pthread_mutex_unlock(&index->lock);
+
+  *result = g_list_sort(tags, _sort_result_by_name);
+  return count;
+}
+
+uint32_t dt_tag_index_get_with_usage(dt_tag_index_t *index, const GList *selected, const gboolean used_only,
+                                     GList **result)
+{
+  GList *tags = NULL;
+  uint32_t count = 0;
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  guint nb_selected = 0;
+  GHashTable *counts = _count_tags(index, selected, &nb_selected);
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, index->tags);
+  while(g_hash_table_iter_next(&iter, &key, &value))
+  {
+    const dt_tag_index_node_t *node = (const dt_tag_index_node_t *)value;
+    if(node->darktable || (used_only && !node->count)) continue;
+    const guint imgnb = GPOINTER_TO_UINT(g_hash_table_lookup(counts, key));
+    tags = g_list_prepend(tags, _tag_result(node, node->count, nb_selected, imgnb));
+    count++;
+  }
+  g_hash_table_destroy(counts);
+  dt_pthread_mutex_unlock(&index->lock);
+
+  *result = g_list_concat(*result, g_list_sort(tags, _sort_result_by_name));
+  return count;
+}
+
+void dt_tag_index_count_tags_images(dt_tag_index_t *index, const char *keyword, int *tag_count, int *img_count)
+{
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  const dt_tag_index_node_t *node = _node_find(index, keyword, FALSE);
+  *tag_count = node ? node->tags : 0;
+  *img_count = node ? node->images : 0;
+  dt_pthread_mutex_unlock(&index->lock);
+}
+
+static void _subtree_tags(dt_tag_index_node_t *node, const uint32_t stamp, GList **tag_list)
+{
+  node->stamp = stamp;
+  if(node->tagid)
+  {
+    dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
+    t->id = node->tagid;
+    t->tag = g_strdup(node->tag);
+    *tag_list = g_list_prepend(*tag_list, t);
+  }
+  if(node->children)
+  {
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, node->children);
+    while(g_hash_table_iter_next(&iter, NULL, &value)) _subtree_tags((dt_tag_index_node_t *)value, stamp, tag_list);
+  }
+}
+
+void dt_tag_index_get_tags_images(dt_tag_index_t *index, const char *keyword, GList **tag_list,
+                                  GList **img_list)
+{
+  GList *tags = NULL;
+  GList *imgs = NULL;
+  dt_pthread_mutex_lock(&index->lock);
+  _ensure(index);
+  dt_tag_index_node_t *node = _node_find(index, keyword, FALSE);
+  if(node && node->tags)
+  {
+    // mark the subtree, then pick all images having one of the marked tags
+    const uint32_t stamp = ++index->stamp;
+    _subtree_tags(node, stamp, &tags);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, index->images);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+      const GArray *t = (const GArray *)value;
+      for(guint k = 0; k < t->len; k++)
+      {
+        const dt_tag_index_node_t *n = g_hash_table_lookup(index->tags, GUINT_TO_POINTER(g_array_index(t, guint, k)));
+        if(n && n->stamp == stamp)
+        {
+          imgs = g_list_prepend(imgs, key);
+          break;
+        }
+      }
+    }
+  }
+  dt_pthread_mutex_unlock(&index->lock);
+
+  *tag_list = g_list_concat(*tag_list, g_list_reverse(tags));
+  *img_list = g_list_concat(*img_list, g_list_reverse(imgs));
+}
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
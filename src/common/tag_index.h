@@ -0,0 +1,86 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/dtpthread.h"
+
+#include <glib.h>
+#include <stdint.h>
+
+// in-memory copy of data.tags and main.tagged_images.
+// tags are kept in a trie following their '|' separated path, every node knows how many images
+// carry its tag and how many carry it or any tag below it. every image has a sorted array of its tag ids.
+// the index is built from the database on first use and then kept up to date by the functions
+// changing tags or tag attachments, so the tagging module doesn't have to scan tagged_images on every refresh.
+typedef struct dt_tag_index_t
+{
+  dt_pthread_mutex_t lock;
+  gboolean valid; // FALSE until built from the database, and after an invalidation
+
+  struct dt_tag_index_node_t *root;
+  GHashTable *tags;   // tag id -> node
+  GHashTable *images; // image id -> GArray of sorted tag ids
+  uint32_t stamp;     // to visit every node only once per pass
+
+  // statistics
+  uint64_t builds;
+  uint64_t queries;
+} dt_tag_index_t;
+
+void dt_tag_index_init(dt_tag_index_t *index);
+void dt_tag_index_cleanup(dt_tag_index_t *index);
+
+// these keep the index in sync with the database, call them after the change has been written.
+// index may be NULL for all of them.
+
+// drop everything, the index is rebuilt on the next query. for changes that move or delete tags.
+void dt_tag_index_invalidate(dt_tag_index_t *index);
+// re-read name, flags and synonyms of a new or changed tag
+void dt_tag_index_tag_reload(dt_tag_index_t *index, const guint tagid);
+// the tags of imgid went from before to after (lists of tag ids)
+void dt_tag_index_image_changed(dt_tag_index_t *index, const int32_t imgid, const GList *before,
+                                const GList *after);
+// re-read the tags of imgid, for code writing tagged_images directly
+void dt_tag_index_image_reload(dt_tag_index_t *index, const int32_t imgid);
+void dt_tag_index_image_removed(dt_tag_index_t *index, const int32_t imgid);
+
+// queries. lists of dt_tag_t are sorted by name and have to be freed with dt_tag_free_result().
+
+// tag ids attached to any of imgs, with or without the darktable|... tags
+GList *dt_tag_index_get_tags(dt_tag_index_t *index, const GList *imgs, const gboolean dt_tags,
+                             const gboolean user_tags);
+gboolean dt_tag_index_is_attached(dt_tag_index_t *index, const guint tagid, const int32_t imgid);
+// number of images tagid is attached to
+uint32_t dt_tag_index_images_count(dt_tag_index_t *index, const guint tagid);
+// tags attached to imgs. count is the number of these images having the tag, select is set against nb_imgs.
+uint32_t dt_tag_index_get_attached(dt_tag_index_t *index, const GList *imgs, const gboolean ignore_dt_tags,
+                                   GList **result);
+// all non darktable tags, or only the ones attached to at least one image. count is the number of images
+// having the tag, select tells whether it's attached to all, some or none of the selected images.
+uint32_t dt_tag_index_get_with_usage(dt_tag_index_t *index, const GList *selected, const gboolean used_only,
+                                     GList **result);
+// tags named keyword or below keyword and the number of distinct images having any of them
+void dt_tag_index_count_tags_images(dt_tag_index_t *index, const char *keyword, int *tag_count, int *img_count);
+// same, returns the tags (dt_tag_t with id and tag set) and the images
+void dt_tag_index_get_tags_images(dt_tag_index_t *index, const char *keyword, GList **tag_list,
+                                  GList **img_list);
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
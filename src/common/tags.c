@@ -21,6 +21,7 @@
 #include "common/debug.h"
 #include "common/grouping.h"
 #include "common/selection.h"
+#include "common/tag_index.h"
 #include "common/undo.h"
 #include "control/conf.h"
 #include "control/control.h"
@@ -109,6 +110,7 @@ static void _pop_undo_execute(const int imgid, GList *before, GList *after)
 
   _bulk_remove_tags(imgid, tobe_removed_list);
   _bulk_add_tags(tobe_added_list);
+  dt_tag_index_image_changed(darktable.tag_index, imgid, before, after);
 
   g_free(tobe_removed_list);
   g_free(tobe_added_list);
@@ -178,15 +180,15 @@ gboolean dt_tag_new(const char *name, guint *tagid)
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
 
-  if(tagid != NULL)
-  {
-    *tagid = 0;
-    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT id FROM data.tags WHERE name = ?1", -1,
-                                &stmt, NULL);
-    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 1, name, -1, SQLITE_TRANSIENT);
-    if(sqlite3_step(stmt) == SQLITE_ROW) *tagid = sqlite3_column_int(stmt, 0);
-    sqlite3_finalize(stmt);
-  }
+  guint newid = 0;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT id FROM data.tags WHERE name = ?1", -1,
+                              &stmt, NULL);
+  DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 1, name, -1, SQLITE_TRANSIENT);
+  if(sqlite3_step(stmt) == SQLITE_ROW) newid = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+
+  if(newid) dt_tag_index_tag_reload(darktable.tag_index, newid);
+  if(tagid != NULL) *tagid = newid;
 
   return TRUE;
 }
@@ -201,16 +203,9 @@ gboolean dt_tag_new_from_gui(const char *name, guint *tagid)
 
 guint dt_tag_remove(const guint tagid, gboolean final)
 {
-  int rv, count = -1;
+  const int count = dt_tag_index_images_count(darktable.tag_index, tagid);
   sqlite3_stmt *stmt;
 
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT COUNT(*) FROM main.tagged_images WHERE tagid=?1", -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
-  rv = sqlite3_step(stmt);
-  if(rv == SQLITE_ROW) count = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
-
   if(final == TRUE)
   {
     // let's actually remove the tag
@@ -225,6 +220,8 @@ guint dt_tag_remove(const guint tagid, gboolean final)
     DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
     sqlite3_step(stmt);
     sqlite3_finalize(stmt);
+
+    dt_tag_index_invalidate(darktable.tag_index);
   }
 
   return count;
@@ -247,6 +244,8 @@ void dt_tag_delete_tag_batch(const char *flatlist)
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
   g_free(query);
+
+  dt_tag_index_invalidate(darktable.tag_index);
 }
 
 guint dt_tag_remove_list(GList *tag_list)
@@ -309,6 +308,7 @@ void dt_tag_rename(const guint tagid, const gchar *new_tagname)
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, new_tagname, -1, SQLITE_TRANSIENT);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_tag_reload(darktable.tag_index, tagid);
 
 }
 
@@ -374,6 +374,13 @@ typedef enum dt_tag_actions_t
 
 static GList *_tag_get_tags(const gint imgid, const dt_tag_type_t type);
 
+// the images to look at, imgid or the selected images for imgid <= 0
+static GList *_tag_get_images(const gint imgid)
+{
+  if(imgid > 0) return g_list_prepend(NULL, GINT_TO_POINTER(imgid));
+  return dt_selection_get_list(darktable.selection, FALSE, FALSE);
+}
+
 static gboolean _tag_execute(const GList *tags, const GList *imgs, GList **undo, const gboolean undo_on,
                              const gint action)
 {
@@ -600,67 +607,9 @@ static void dt_set_darktable_tags()
 
 uint32_t dt_tag_get_attached(const gint imgid, GList **result, const gboolean ignore_dt_tags)
 {
-  sqlite3_stmt *stmt;
-  dt_set_darktable_tags();
-  uint32_t nb_selected = 0;
-  char *images = NULL;
-  if(imgid > 0)
-  {
-    images = dt_util_dstrcat(NULL, "%d", imgid);
-    nb_selected = 1;
-  }
-  else
-  {
-    // we get the query used to retrieve the list of select images
-    images = dt_selection_get_list_query(darktable.selection, FALSE, FALSE);
-    // and we retrieve the number of image in the selection
-    gchar *query = dt_util_dstrcat(NULL,
-                                   "SELECT COUNT(*)"
-                                   " FROM (%s)",
-                                   images);
-    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-    if(sqlite3_step(stmt) == SQLITE_ROW) nb_selected = sqlite3_column_int(stmt, 0);
-    sqlite3_finalize(stmt);
-    g_free(query);
-  }
-  uint32_t count = 0;
-  if(images)
-  {
-    char *query = NULL;
-    query = dt_util_dstrcat(query,
-                            "SELECT DISTINCT I.tagid, T.name, T.flags, T.synonyms,"
-                            " COUNT(DISTINCT I.imgid) AS inb"
-                            " FROM main.tagged_images AS I"
-                            " JOIN data.tags AS T ON T.id = I.tagid"
-                            " WHERE I.imgid IN (%s)%s"
-                            " GROUP BY I.tagid "
-                            " ORDER by T.name",
-                            images, ignore_dt_tags ? " AND T.id NOT IN memory.darktable_tags" : "");
-    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-    g_free(images);
-
-    // Create result
-    *result = NULL;
-    while(sqlite3_step(stmt) == SQLITE_ROW)
-    {
-      dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
-      t->id = sqlite3_column_int(stmt, 0);
-      t->tag = g_strdup((char *)sqlite3_column_text(stmt, 1));
-      t->leave = g_strrstr(t->tag, "|");
-      t->leave = t->leave ? t->leave + 1 : t->tag;
-      t->flags = sqlite3_column_int(stmt, 2);
-      t->synonym = g_strdup((char *)sqlite3_column_text(stmt, 3));
-      uint32_t imgnb = sqlite3_column_int(stmt, 4);
-      t->count = imgnb;
-      t->select = (nb_selected == 0) ? DT_TS_NO_IMAGE :
-                  (imgnb == nb_selected) ? DT_TS_ALL_IMAGES :
-                  (imgnb == 0) ? DT_TS_NO_IMAGE : DT_TS_SOME_IMAGES;
-      *result = g_list_append(*result, t);
-      count++;
-    }
-    sqlite3_finalize(stmt);
-    g_free(query);
-  }
+  GList *imgs = _tag_get_images(imgid);
+  const uint32_t count = dt_tag_index_get_attached(darktable.tag_index, imgs, ignore_dt_tags, result);
+  g_list_free(imgs);
   return count;
 }
 
@@ -824,35 +773,9 @@ GList *dt_tag_get_hierarchical(gint imgid)
 
 static GList *_tag_get_tags(const gint imgid, const dt_tag_type_t type)
 {
-  GList *tags = NULL;
-  char *images = NULL;
-  if(imgid > 0)
-    images = dt_util_dstrcat(NULL, "%d", imgid);
-  else
-  {
-    // we get the query used to retrieve the list of select images
-    images = dt_selection_get_list_query(darktable.selection, FALSE, FALSE);
-  }
-
-  sqlite3_stmt *stmt;
-  dt_set_darktable_tags();
-  char query[256] = { 0 };
-  snprintf(query, sizeof(query), "SELECT DISTINCT T.id"
-                                 "  FROM main.tagged_images AS I"
-                                 "  JOIN data.tags T on T.id = I.tagid"
-                                 "  WHERE I.imgid IN (%s) %s",
-           images, type == DT_TAG_TYPE_ALL ? "" :
-                   type == DT_TAG_TYPE_DT ? "AND T.id IN memory.darktable_tags" :
-                                            "AND NOT T.id IN memory.darktable_tags");
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-
-  while(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    tags = g_list_prepend(tags, GINT_TO_POINTER(sqlite3_column_int(stmt, 0)));
-  }
-
-  sqlite3_finalize(stmt);
-  g_free(images);
+  GList *imgs = _tag_get_images(imgid);
+  GList *tags = dt_tag_index_get_tags(darktable.tag_index, imgs, type != DT_TAG_TYPE_USER, type != DT_TAG_TYPE_DT);
+  g_list_free(imgs);
   return tags;
 }
 
@@ -975,18 +898,7 @@ GList *dt_tag_get_hierarchical_export(gint imgid, int32_t flags)
 
 gboolean dt_is_tag_attached(const guint tagid, const gint imgid)
 {
-  sqlite3_stmt *stmt;
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT imgid"
-                              " FROM main.tagged_images"
-                              " WHERE imgid = ?1 AND tagid = ?2", -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, tagid);
-
-  const gboolean ret = (sqlite3_step(stmt) == SQLITE_ROW);
-  sqlite3_finalize(stmt);
-  return ret;
+  return dt_tag_index_is_attached(darktable.tag_index, tagid, imgid);
 }
 
 GList *dt_tag_get_images(const gint tagid)
@@ -1044,166 +956,62 @@ GList *dt_tag_get_images_from_list(const GList *img, const gint tagid)
   return g_list_reverse(result);  // list was built in reverse order, so un-reverse it
 }
 
-uint32_t dt_tag_get_suggestions(GList **result)
+static gint _sort_tag_by_count_desc(gconstpointer a, gconstpointer b)
 {
-  sqlite3_stmt *stmt;
-
-  dt_set_darktable_tags();
+  const guint ca = ((const dt_tag_t *)a)->count;
+  const guint cb = ((const dt_tag_t *)b)->count;
+  return (ca < cb) - (ca > cb);
+}
 
-  /* list tags and count */
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "INSERT INTO memory.taglist (id, count)"
-                              " SELECT S.tagid, COUNT(*)"
-                              "  FROM main.tagged_images AS S"
-                              "  WHERE S.tagid NOT IN memory.darktable_tags"
-                              "  GROUP BY S.tagid",
-                              -1, &stmt, NULL);
-  sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+uint32_t dt_tag_get_suggestions(GList **result)
+{
+  GList *selected = dt_selection_get_list(darktable.selection, FALSE, FALSE);
+  GList *tags = NULL;
+  dt_tag_index_get_with_usage(darktable.tag_index, selected, TRUE, &tags);
+  g_list_free(selected);
 
-  const uint32_t nb_selected = dt_selected_images_count();
-  /* Now put all the bits together */
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT T.name, T.id, MT.count, CT.imgnb, T.flags, T.synonyms"
-                              "  FROM memory.taglist MT"
-                              "  JOIN data.tags T ON MT.id = T.id"
-                              "  LEFT JOIN (SELECT tagid, COUNT(DISTINCT imgid) AS imgnb"
-                              "             FROM main.tagged_images"
-                              "             WHERE imgid IN (SELECT imgid FROM main.selected_images)"
-                              "             GROUP BY tagid) AS CT"
-                              "    ON CT.tagid = MT.id"
-                              "  WHERE T.id NOT IN (SELECT DISTINCT tagid"
-                              "                     FROM (SELECT TI.tagid, COUNT(DISTINCT SI.imgid) AS imgnb"
-                              "                           FROM main.selected_images AS SI"
-                              "                           JOIN main.tagged_images AS TI ON TI.imgid = SI.imgid"
-                              "                           GROUP BY TI.tagid)"
-                              "                           WHERE imgnb = ?1)"
-                              "  AND (T.flags IS NULL OR (T.flags & 1) = 0)"
-                              "  ORDER BY MT.count DESC"
-                              "  LIMIT 500",
-                              -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, nb_selected);
+  // used tags which are not a category and not yet attached to all selected images, most used first
+  GList *suggestions = NULL;
+  GList *dropped = NULL;
+  for(GList *iter = tags; iter; iter = g_list_next(iter))
+  {
+    dt_tag_t *t = (dt_tag_t *)iter->data;
+    if(t->select == DT_TS_ALL_IMAGES || (t->flags & DT_TF_CATEGORY))
+      dropped = g_list_prepend(dropped, t);
+    else
+      suggestions = g_list_prepend(suggestions, t);
+  }
+  g_list_free(tags);
+  dt_tag_free_result(&dropped);
+  suggestions = g_list_sort(g_list_reverse(suggestions), _sort_tag_by_count_desc);
 
-  /* ... and create the result list to send upwards */
   uint32_t count = 0;
-  while(sqlite3_step(stmt) == SQLITE_ROW)
+  GList *iter = suggestions;
+  for(; iter && count < 500; iter = g_list_next(iter)) count++;
+  if(iter)
   {
-    dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
-    t->tag = g_strdup((char *)sqlite3_column_text(stmt, 0));
-    t->leave = g_strrstr(t->tag, "|");
-    t->leave = t->leave ? t->leave + 1 : t->tag;
-    t->id = sqlite3_column_int(stmt, 1);
-    t->count = sqlite3_column_int(stmt, 2);
-    uint32_t imgnb = sqlite3_column_int(stmt, 3);
-    t->select = (nb_selected == 0) ? DT_TS_NO_IMAGE :
-                (imgnb == nb_selected) ? DT_TS_ALL_IMAGES :
-                (imgnb == 0) ? DT_TS_NO_IMAGE : DT_TS_SOME_IMAGES;
-    t->flags = sqlite3_column_int(stmt, 4);
-    t->synonym = g_strdup((char *)sqlite3_column_text(stmt, 5));
-    *result = g_list_append(*result, t);
-    count++;
+    iter->prev->next = NULL;
+    iter->prev = NULL;
+    dt_tag_free_result(&iter);
   }
-
-  sqlite3_finalize(stmt);
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DELETE FROM memory.taglist", NULL, NULL, NULL);
+  *result = g_list_concat(*result, suggestions);
 
   return count;
 }
 
 void dt_tag_count_tags_images(const gchar *keyword, int *tag_count, int *img_count)
 {
-  sqlite3_stmt *stmt;
   *tag_count = 0;
   *img_count = 0;
 
   if(!keyword) return;
-  gchar *keyword_expr = g_strdup_printf("%s|", keyword);
-
-  /* Only select tags that are equal or child to the one we are looking for once. */
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "INSERT INTO memory.similar_tags (tagid)"
-                              "  SELECT id"
-                              "    FROM data.tags"
-                              "    WHERE name = ?1 OR SUBSTR(name, 1, LENGTH(?2)) = ?2",
-                              -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 1, keyword, -1, SQLITE_TRANSIENT);
-  DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, keyword_expr, -1, SQLITE_TRANSIENT);
-  sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
-
-  g_free(keyword_expr);
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT COUNT(DISTINCT tagid) FROM memory.similar_tags",
-                              -1, &stmt, NULL);
-  sqlite3_step(stmt);
-  *tag_count = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT COUNT(DISTINCT ti.imgid)"
-                              "  FROM main.tagged_images AS ti "
-                              "  JOIN memory.similar_tags AS st"
-                              "    ON st.tagid = ti.tagid",
-                              -1, &stmt, NULL);
-
-  sqlite3_step(stmt);
-  *img_count = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
-
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DELETE FROM memory.similar_tags", NULL, NULL, NULL);
-  }
+  dt_tag_index_count_tags_images(darktable.tag_index, keyword, tag_count, img_count);
+}
 
 void dt_tag_get_tags_images(const gchar *keyword, GList **tag_list, GList **img_list)
 {
-  sqlite3_stmt *stmt;
-
   if(!keyword) return;
-  gchar *keyword_expr = g_strdup_printf("%s|", keyword);
-
-/* Only select tags that are equal or child to the one we are looking for once. */
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "INSERT INTO memory.similar_tags (tagid)"
-                              "  SELECT id"
-                              "  FROM data.tags"
-                              "  WHERE name = ?1 OR SUBSTR(name, 1, LENGTH(?2)) = ?2",
-                              -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 1, keyword, -1, SQLITE_TRANSIENT);
-  DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, keyword_expr, -1, SQLITE_TRANSIENT);
-  sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
-
-  g_free(keyword_expr);
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT ST.tagid, T.name"
-                              " FROM memory.similar_tags ST"
-                              " JOIN data.tags T"
-                              "   ON T.id = ST.tagid ",
-                              -1, &stmt, NULL);
-
-  while(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
-    t->id = sqlite3_column_int(stmt, 0);
-    t->tag = g_strdup((char *)sqlite3_column_text(stmt, 1));
-    *tag_list = g_list_append((*tag_list), t);
-  }
-  sqlite3_finalize(stmt);
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT DISTINCT ti.imgid"
-                              " FROM main.tagged_images AS ti"
-                              " JOIN memory.similar_tags AS st"
-                              "   ON st.tagid = ti.tagid",
-                              -1, &stmt, NULL);
-  while(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    *img_list = g_list_append((*img_list), GINT_TO_POINTER(sqlite3_column_int(stmt, 0)));
-  }
-  sqlite3_finalize(stmt);
-
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DELETE FROM memory.similar_tags", NULL, NULL, NULL);
+  dt_tag_index_get_tags_images(darktable.tag_index, keyword, tag_list, img_list);
 }
 
 uint32_t dt_selected_images_count()
@@ -1221,74 +1029,14 @@ uint32_t dt_selected_images_count()
 
 uint32_t dt_tag_images_count(gint tagid)
 {
-  sqlite3_stmt *stmt;
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT COUNT(DISTINCT imgid) AS imgnb"
-                              " FROM main.tagged_images"
-                              " WHERE tagid = ?1",
-                              -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
-  sqlite3_step(stmt);
-  const uint32_t nb_images = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
-  return nb_images;
+  return dt_tag_index_images_count(darktable.tag_index, tagid);
 }
 
 uint32_t dt_tag_get_with_usage(GList **result)
 {
-  sqlite3_stmt *stmt;
-
-  dt_set_darktable_tags();
-
-  /* Select tags that are similar to the keyword and are actually used to tag images*/
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "INSERT INTO memory.taglist (id, count)"
-                              "  SELECT tagid, COUNT(*)"
-                              "  FROM main.tagged_images"
-                              "  GROUP BY tagid",
-                              -1, &stmt, NULL);
-  sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
-
-  const uint32_t nb_selected = dt_selected_images_count();
-
-  /* Now put all the bits together */
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT T.name, T.id, MT.count, CT.imgnb, T.flags, T.synonyms"
-                              "  FROM data.tags T "
-                              "  LEFT JOIN memory.taglist MT ON MT.id = T.id "
-                              "  LEFT JOIN (SELECT tagid, COUNT(DISTINCT imgid) AS imgnb"
-                              "             FROM main.tagged_images "
-                              "             WHERE imgid IN (SELECT imgid FROM main.selected_images) GROUP BY tagid) AS CT "
-                              "    ON CT.tagid = T.id"
-                              "  WHERE T.id NOT IN memory.darktable_tags "
-                              "  ORDER BY T.name ",
-                              -1, &stmt, NULL);
-
-  /* ... and create the result list to send upwards */
-  uint32_t count = 0;
-  while(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    dt_tag_t *t = g_malloc0(sizeof(dt_tag_t));
-    t->tag = g_strdup((char *)sqlite3_column_text(stmt, 0));
-    t->leave = g_strrstr(t->tag, "|");
-    t->leave = t->leave ? t->leave + 1 : t->tag;
-    t->id = sqlite3_column_int(stmt, 1);
-    t->count = sqlite3_column_int(stmt, 2);
-    uint32_t imgnb = sqlite3_column_int(stmt, 3);
-    t->select = (nb_selected == 0) ? DT_TS_NO_IMAGE :
-                (imgnb == nb_selected) ? DT_TS_ALL_IMAGES :
-                (imgnb == 0) ? DT_TS_NO_IMAGE : DT_TS_SOME_IMAGES;
-    t->flags = sqlite3_column_int(stmt, 4);
-    t->synonym = g_strdup((char *)sqlite3_column_text(stmt, 5));
-    *result = g_list_append(*result, t);
-    count++;
-  }
-
-  sqlite3_finalize(stmt);
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DELETE FROM memory.taglist", NULL, NULL, NULL);
-
+  GList *selected = dt_selection_get_list(darktable.selection, FALSE, FALSE);
+  const uint32_t count = dt_tag_index_get_with_usage(darktable.tag_index, selected, FALSE, result);
+  g_list_free(selected);
   return count;
 }
 
@@ -1351,6 +1099,7 @@ void dt_tag_set_synonyms(gint tagid, gchar *synonyms_entry)
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, synonyms, -1, SQLITE_TRANSIENT);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_tag_reload(darktable.tag_index, tagid);
   g_free(synonyms);
 }
 
@@ -1383,6 +1132,7 @@ void dt_tag_set_flags(gint tagid, gint flags)
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, flags);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_tag_reload(darktable.tag_index, tagid);
 }
 
 void dt_tag_add_synonym(gint tagid, gchar *synonym)
@@ -1404,6 +1154,7 @@ void dt_tag_add_synonym(gint tagid, gchar *synonym)
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, synonyms, -1, SQLITE_TRANSIENT);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_tag_reload(darktable.tag_index, tagid);
   g_free(synonyms);
 }
 
@@ -1748,6 +1499,7 @@ void dt_tag_set_tag_order_by_id(const uint32_t tagid, const uint32_t sort,
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 3, DT_TF_ALL);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  dt_tag_index_tag_reload(darktable.tag_index, tagid);
 }
 
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
@@ -29,12 +29,15 @@
 #include "common/imageio_dng.h"
 #include "common/imageio_module.h"
 #include "common/mipmap_cache.h"
+#include "common/numa.h"
+#include "common/sidecar_writer.h"
 #include "common/tags.h"
 #include "common/undo.h"
 #include "common/grouping.h"
 #include "common/import_session.h"
 #include "control/conf.h"
 #include "develop/imageop_math.h"
+#include "dtgtk/thumbtable.h"
 
 #include "gui/gtk.h"
 
@@ -80,6 +83,7 @@ typedef struct dt_control_export_t
 typedef struct dt_control_import_t
 {
   struct dt_import_session_t *session;
+  dt_mipmap_size_t prefill_mip; // thumbnail size, taken from the gui when the job is queued
 } dt_control_import_t;
 
 typedef struct dt_control_image_enumerator_t
@@ -222,6 +226,9 @@ static dt_job_t *dt_control_generic_image_job_create(dt_job_execute_callback exe
 
 static int32_t dt_control_write_sidecar_files_job_run(dt_job_t *job)
 {
+  // write whatever is still queued first, so it can't overwrite the files written here later on
+  dt_sidecar_writer_flush(darktable.sidecar_writer);
+
   dt_control_image_enumerator_t *params = dt_control_job_get_params(job);
   GList *t = params->index;
   sqlite3_stmt *stmt;
@@ -1295,6 +1302,22 @@ static int32_t dt_control_refresh_exif_run(dt_job_t *job)
 }
 
 
+// decodes the raw of the next image to export into the mipmap cache while the current one is processed
+static gpointer _export_decoder_run(gpointer data)
+{
+  GAsyncQueue *queue = (GAsyncQueue *)data;
+  while(TRUE)
+  {
+    const int imgid = GPOINTER_TO_INT(g_async_queue_pop(queue));
+    if(imgid <= 0) break;
+
+    dt_mipmap_buffer_t buf;
+    dt_mipmap_cache_get(darktable.mipmap_cache, &buf, imgid, DT_MIPMAP_FULL, DT_MIPMAP_BLOCKING, 'r');
+    dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
+  }
+  return NULL;
+}
+
 static int32_t dt_control_export_job_run(dt_job_t *job)
 {
   dt_control_image_enumerator_t *params = (dt_control_image_enumerator_t *)dt_control_job_get_params(job);
@@ -1308,6 +1331,9 @@ static int32_t dt_control_export_job_run(dt_job_t *job)
 
   gboolean tag_change = FALSE;
 
+  // spread the export threads over the numa nodes, so that each export keeps its buffers in local memory
+  void *numa_binding = dt_conf_get_bool("numa_bind_export") ? dt_numa_bind_thread(dt_control_get_threadid()) : NULL;
+
   // get a thread-safe fdata struct (one jpeg struct per thread etc):
   dt_imageio_module_data_t *fdata = mformat->get_params(mformat);
 
@@ -1363,11 +1389,31 @@ static int32_t dt_control_export_job_run(dt_job_t *job)
     metadata.list = g_list_remove(metadata.list, metadata.list->data);
   }
 
+  // load the image structs of the upcoming images in one go, a chunk at a time
+  dt_image_cache_prefetch(darktable.image_cache, t);
+
+  // three stages: while an image is processed, the raw of the next one is decoded and, if the storage is done
+  // with its files right away, the previous one is encoded and written. one image each way bounds the memory.
+  GAsyncQueue *decode_queue = g_async_queue_new();
+  GThread *decoder = g_thread_new("export-decoder", _export_decoder_run, decode_queue);
+  dt_imageio_export_writer_t *writer = (mstorage->deferred_write && mstorage->deferred_write(mstorage, sdata))
+                                       ? dt_imageio_export_writer_new(mformat, 1) : NULL;
+  dt_imageio_export_writer_set_current(writer);
+
   while(t && dt_control_job_get_state(job) != DT_JOB_STATE_CANCELLED)
   {
+    // an image the writer failed on stops the export, the same as one the storage failed on
+    if(dt_imageio_export_writer_failed(writer))
+    {
+      dt_control_job_cancel(job);
+      break;
+    }
+
     const int imgid = GPOINTER_TO_INT(t->data);
     t = g_list_next(t);
     const guint num = total - g_list_length(t);
+    if(num % 250 == 0) dt_image_cache_prefetch(darktable.image_cache, t);
+    if(t && g_async_queue_length(decode_queue) <= 0) g_async_queue_push(decode_queue, t->data);
 
     // progress message
     char message[512] = { 0 };
@@ -1411,6 +1457,19 @@ static int32_t dt_control_export_job_run(dt_job_t *job)
     if(fraction > 1.0) fraction = 1.0;
     dt_control_job_set_progress(job, fraction);
   }
+
+  // wait for the last images to be written before the storage finishes and the metadata goes away
+  g_async_queue_push(decode_queue, GINT_TO_POINTER(-1));
+  g_thread_join(decoder);
+  g_async_queue_unref(decode_queue);
+  // the storage has reported these as exported already, the files were written afterwards
+  const int failed = dt_imageio_export_writer_finish(writer);
+  if(failed)
+  {
+    fprintf(stderr, "[export_job] %d image(s) could not be written\n", failed);
+    dt_control_log(ngettext("%d image could not be exported", "%d images could not be exported", failed), failed);
+  }
+
   g_list_free_full(metadata.list, g_free);
 
   if(mstorage->finalize_store) mstorage->finalize_store(mstorage, sdata);
@@ -1419,6 +1478,8 @@ end:
   // all threads free their fdata
   mformat->free_params(mformat, fdata);
 
+  dt_numa_unbind_thread(numa_binding);
+
   // notify the user via the window manager
   dt_ui_notify_user();
 
@@ -2057,8 +2118,106 @@ void dt_control_write_sidecar_files()
                                                           FALSE));
 }
 
+static int32_t _control_prefill_thumbnails_job_run(dt_job_t *job)
+{
+  dt_control_image_enumerator_t *params = (dt_control_image_enumerator_t *)dt_control_job_get_params(job);
+  const dt_mipmap_size_t mip = params->flag;
+  const int total = g_list_length(params->index);
+  if(total == 0) return 0;
+
+  int *imgs = malloc(sizeof(int) * total);
+  if(!imgs) return 1;
+  int k = 0;
+  for(const GList *t = params->index; t; t = g_list_next(t)) imgs[k++] = GPOINTER_TO_INT(t->data);
+
+  // the embedded previews are read with bounded concurrency, network shares and spinning disks don't get
+  // faster with more requests in flight. decoding and writing the thumbnails happens on the same threads.
+  dt_mipmap_cache_t *cache = darktable.mipmap_cache;
+  const int io_threads = MAX(1, dt_conf_get_int("cache_prefill_io_threads"));
+  dt_mipmap_prefill_stats_t stats = { 0 };
+  int done = 0;
+  const double start = dt_get_wtime();
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(imgs, total, mip, job, cache) \
+  shared(stats, done) \
+  num_threads(io_threads) schedule(dynamic)
+#endif
+  for(int i = 0; i < total; i++)
+  {
+    if(dt_control_job_get_state(job) == DT_JOB_STATE_CANCELLED) continue;
+    dt_mipmap_prefill_stats_t s = { 0 };
+    dt_mipmap_cache_prefill_embedded(cache, imgs[i], mip, &s);
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    {
+      stats.extract_time += s.extract_time;
+      stats.decode_time += s.decode_time;
+      stats.write_time += s.write_time;
+      stats.extract_bytes += s.extract_bytes;
+      stats.write_bytes += s.write_bytes;
+      stats.extracted += s.extracted;
+      stats.written += s.written;
+      stats.skipped += s.skipped;
+      stats.failed += s.failed;
+      dt_control_job_set_progress(job, (double)++done / total);
+    }
+  }
+  const double wall = dt_get_wtime() - start;
+  free(imgs);
+
+  // stage times are summed over all threads, so the throughput is per thread
+  dt_print(DT_DEBUG_PERF,
+           "[prefill thumbnails] mip %d, %d images in %.3fs with %d threads: %d written, %d already cached, "
+           "%d left for the pixelpipe\n",
+           mip, done, wall, io_threads, stats.written, stats.skipped, stats.failed);
+  dt_print(DT_DEBUG_PERF,
+           "[prefill thumbnails] extract %.3fs (%.1f MB/s), decode %.3fs (%.1f images/s), write %.3fs (%.1f MB/s)\n",
+           stats.extract_time, stats.extract_time > 0.0 ? stats.extract_bytes / (1e6 * stats.extract_time) : 0.0,
+           stats.decode_time, stats.decode_time > 0.0 ? stats.extracted / stats.decode_time : 0.0,
+           stats.write_time, stats.write_time > 0.0 ? stats.write_bytes / (1e6 * stats.write_time) : 0.0);
+
+  if(stats.written) dt_control_queue_redraw_center();
+  return 0;
+}
+
+dt_mipmap_size_t dt_control_prefill_thumbnails_size(void)
+{
+  // the size the lighttable is going to ask for
+  dt_mipmap_size_t mip = DT_MIPMAP_2;
+  if(darktable.gui && dt_ui_thumbtable(darktable.gui->ui)->thumb_size > 0)
+  {
+    const int size = dt_ui_thumbtable(darktable.gui->ui)->thumb_size * darktable.gui->ppd_thb;
+    mip = dt_mipmap_cache_get_matching_size(darktable.mipmap_cache, size, size);
+  }
+  return mip;
+}
+
+void dt_control_prefill_thumbnails(GList *imgs, const dt_mipmap_size_t mip)
+{
+  dt_job_t *job = dt_control_job_create(&_control_prefill_thumbnails_job_run, "%s", N_("create thumbnails"));
+  if(!job)
+  {
+    g_list_free(imgs);
+    return;
+  }
+  dt_control_image_enumerator_t *params = dt_control_image_enumerator_alloc();
+  if(!params)
+  {
+    g_list_free(imgs);
+    dt_control_job_dispose(job);
+    return;
+  }
+  dt_control_job_add_progress(job, _("create thumbnails"), TRUE);
+  dt_control_job_set_params(job, params, dt_control_image_enumerator_cleanup);
+  params->index = imgs;
+  params->flag = mip;
+  dt_control_add_job(darktable.control, DT_JOB_QUEUE_USER_BG, job);
+}
+
 static int _control_import_image_copy(const char *filename,
-                                      struct dt_import_session_t *session)
+                                      struct dt_import_session_t *session, GList **imgs)
 {
   char *data = NULL;
   gsize size = 0;
@@ -2090,7 +2249,8 @@ static int _control_import_image_copy(const char *filename,
   {
     const int32_t imgid = dt_image_import(dt_import_session_film_id(session), output, FALSE, FALSE);
     if(!imgid) dt_control_log(_("error loading file `%s'"), output);
-    else if((imgid & 3) == 3)
+    else *imgs = g_list_prepend(*imgs, GINT_TO_POINTER(imgid));
+    if((imgid & 3) == 3)
     {
       dt_collection_update_query(darktable.collection, DT_COLLECTION_CHANGE_NEW_QUERY, NULL);
       dt_control_queue_redraw_center();
@@ -2101,14 +2261,15 @@ static int _control_import_image_copy(const char *filename,
   return res ? dt_import_session_film_id(session) : -1;
 }
 
-static int _control_import_image_insitu(const char *filename)
+static int _control_import_image_insitu(const char *filename, GList **imgs)
 {
   char *dirname = g_path_get_dirname(filename);
   dt_film_t film;
   const int filmid = dt_film_new(&film, dirname);
   const int32_t imgid = dt_image_import(filmid, filename, FALSE, FALSE);
   if(!imgid) dt_control_log(_("error loading file `%s'"), filename);
-  else if((imgid & 3) == 3)
+  else *imgs = g_list_prepend(*imgs, GINT_TO_POINTER(imgid));
+  if((imgid & 3) == 3)
   {
     dt_collection_update_query(darktable.collection, DT_COLLECTION_CHANGE_NEW_QUERY, NULL);
     dt_control_queue_redraw_center();
@@ -2195,11 +2356,12 @@ static int32_t _control_import_job_run(dt_job_t *job)
   double fraction = 0.0f;
   int filmid = -1;
   int first_filmid = -1;
+  GList *imported = NULL;
   for(GList *img = t; img; img = g_list_next(img))
   {
     if(data->session)
     {
-      filmid = _control_import_image_copy((char *)img->data, data->session);
+      filmid = _control_import_image_copy((char *)img->data, data->session, &imported);
       if(filmid != -1 && first_filmid == -1)
       {
         first_filmid = filmid;
@@ -2211,7 +2373,7 @@ static int32_t _control_import_job_run(dt_job_t *job)
       }
     }
     else
-      filmid = _control_import_image_insitu((char *)img->data);
+      filmid = _control_import_image_insitu((char *)img->data, &imported);
     if(filmid != -1)
       cntr++;
     fraction += 1.0 / total;
@@ -2225,6 +2387,11 @@ static int32_t _control_import_job_run(dt_job_t *job)
   dt_control_queue_redraw_center();
   DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_TAG_CHANGED);
   DT_DEBUG_CONTROL_SIGNAL_RAISE(darktable.signals, DT_SIGNAL_FILMROLLS_IMPORTED, filmid);
+
+  if(imported && dt_conf_get_bool("cache_prefill_thumbnails") && dt_conf_get_bool("cache_disk_backend"))
+    dt_control_prefill_thumbnails(g_list_reverse(imported), data->prefill_mip);
+  else
+    g_list_free(imported);
   return 0;
 }
 
@@ -2271,6 +2438,7 @@ static dt_job_t *_control_import_job_create(GList *imgs, const time_t datetime_o
   params->index = imgs;
 
   dt_control_import_t *data = params->data;
+  data->prefill_mip = dt_control_prefill_thumbnails_size();
   if(inplace)
     data->session = NULL;
   else
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "common/imageio_module.h"
+#include "common/mipmap_cache.h"
 #include "control/control.h"
 #include <inttypes.h>
 
@@ -48,6 +49,10 @@ void dt_control_export(GList *imgid_list, int max_width, int max_height, int for
                        dt_iop_color_intent_t icc_intent, const gchar *metadata_export);
 void dt_control_merge_hdr();
 void dt_control_import(GList *imgs, const time_t datetime_override, const gboolean inplace);
+/** the thumbnail size the lighttable currently shows, has to be called from the gui thread */
+dt_mipmap_size_t dt_control_prefill_thumbnails_size(void);
+/** create the thumbnails of the given images from their embedded previews, takes ownership of the list */
+void dt_control_prefill_thumbnails(GList *imgs, const dt_mipmap_size_t mip);
 void dt_control_seed_denoise();
 void dt_control_denoise();
 void dt_control_refresh_exif();
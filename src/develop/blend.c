@@ -219,6 +219,79 @@ int dt_develop_blendif_init_masking_profile(struct dt_dev_pixelpipe_iop_t *piece
   return 1;
 }
 
+// rectangle within the mask buffer
+typedef struct _blend_mask_box_t
+{
+  int x, y, width, height;
+} _blend_mask_box_t;
+
+// bounding box of the non-zero part of the mask, returns FALSE if the mask is zero everywhere
+static gboolean _blend_mask_bounding_box(const float *const restrict mask, const int width, const int height,
+                                         _blend_mask_box_t *box)
+{
+  int x0 = width, y0 = height, x1 = -1, y1 = -1;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(mask, width, height) \
+  reduction(min : x0, y0) reduction(max : x1, y1) \
+  schedule(static)
+#endif
+  for(int y = 0; y < height; y++)
+  {
+    const float *const restrict row = mask + (size_t)y * width;
+    int first = 0;
+    while(first < width && row[first] == 0.0f) first++;
+    if(first == width) continue;
+    int last = width - 1;
+    while(row[last] == 0.0f) last--;
+    x0 = MIN(x0, first);
+    x1 = MAX(x1, last);
+    y0 = MIN(y0, y);
+    y1 = MAX(y1, y);
+  }
+  if(x1 < 0) return FALSE;
+
+  *box = (_blend_mask_box_t){ x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+  return TRUE;
+}
+
+static void _blend_mask_box_grow(_blend_mask_box_t *box, const int margin, const int width, const int height)
+{
+  const int x0 = MAX(0, box->x - margin);
+  const int y0 = MAX(0, box->y - margin);
+  const int x1 = MIN(width, box->x + box->width + margin);
+  const int y1 = MIN(height, box->y + box->height + margin);
+  *box = (_blend_mask_box_t){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+// copy the rectangle at (x, y) of size width x height with ch channels out of src into dst
+static void _blend_copy_rect(float *const restrict dst, const int dst_width, const float *const restrict src,
+                             const int src_width, const int x, const int y, const int width, const int height,
+                             const int ch)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(dst, dst_width, src, src_width, x, y, width, height, ch) \
+  schedule(static)
+#endif
+  for(int j = 0; j < height; j++)
+    memcpy(dst + (size_t)j * dst_width * ch, src + ((size_t)(y + j) * src_width + x) * ch,
+           sizeof(float) * width * ch);
+}
+
+// write a single channel buffer of size width x height back into dst at (x, y)
+static void _blend_copy_rect_back(float *const restrict dst, const int dst_width, const float *const restrict src,
+                                  const int x, const int y, const int width, const int height)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(dst, dst_width, src, x, y, width, height) \
+  schedule(static)
+#endif
+  for(int j = 0; j < height; j++)
+    memcpy(dst + (size_t)(y + j) * dst_width + x, src + (size_t)j * width, sizeof(float) * width);
+}
+
 void dt_develop_blend_process(struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t *piece,
                               const void *const ivoid, void *const ovoid, const struct dt_iop_roi_t *const roi_in,
                               const struct dt_iop_roi_t *const roi_out)
@@ -378,10 +451,42 @@ void dt_develop_blend_process(struct dt_iop_module_t *self, struct dt_dev_pixelp
         break;
     }
 
-    if(mask_feather)
+    // the mask post-processing only needs to look at the area where the combined mask is non-zero,
+    // grown by the support of feathering and blurring. a mask tone curve with positive brightness
+    // lifts zero mask values, in that case the whole mask is processed.
+    const int feather_w
+        = mask_feather ? MAX(1, (int)(2 * d->feathering_radius * roi_out->scale / piece->iscale + 0.5f)) : 0;
+    const float blur_sigma = d->blur_radius * roi_out->scale / piece->iscale;
+    _blend_mask_box_t box = { 0, 0, owidth, oheight };
+    gboolean mask_empty = FALSE;
+    if((mask_feather || mask_blur || mask_tone_curve) && !(mask_tone_curve && d->brightness > 0.0f))
     {
-      int w = (int)(2 * d->feathering_radius * roi_out->scale / piece->iscale + 0.5f);
-      if(w < 1) w = 1;
+      if(_blend_mask_bounding_box(mask, owidth, oheight, &box))
+        _blend_mask_box_grow(&box, 4 * feather_w + (mask_blur ? (int)ceilf(6.0f * blur_sigma) : 0), owidth,
+                             oheight);
+      else
+        mask_empty = TRUE;
+    }
+
+    // work on a copy of the box if it is noticeably smaller than the whole mask. outside of the box
+    // the mask is zero and stays zero.
+    float *work = NULL;
+    if(!mask_empty && (size_t)box.width * box.height < buffsize / 4 * 3)
+      work = dt_alloc_align_float((size_t)box.width * box.height);
+    if(work)
+      _blend_copy_rect(work, box.width, mask, owidth, box.x, box.y, box.width, box.height, 1);
+    else
+    {
+      work = mask;
+      box = (_blend_mask_box_t){ 0, 0, owidth, oheight };
+    }
+    const int bwidth = box.width;
+    const int bheight = box.height;
+    const size_t bsize = (size_t)bwidth * bheight;
+
+    if(mask_feather && !mask_empty)
+    {
+      const int w = feather_w;
       float sqrt_eps = 1.f;
       float guide_weight = 1.f;
       switch(cst)
@@ -396,63 +501,60 @@ void dt_develop_blend_process(struct dt_iop_module_t *self, struct dt_dev_pixelp
         default:
           assert(0);
       }
-      float *const restrict mask_bak = dt_alloc_align_float(buffsize);
+      float *const restrict mask_bak = dt_alloc_align_float(bsize);
       if(mask_bak)
       {
-        memcpy(mask_bak, mask, sizeof(*mask_bak) * buffsize);
-        float *guide = (d->feathering_guide == DEVELOP_MASK_GUIDE_IN) ? (float *const restrict)ivoid
-                                                                      : (float *const restrict)ovoid;
-        if(!rois_equal && d->feathering_guide == DEVELOP_MASK_GUIDE_IN)
+        memcpy(mask_bak, work, sizeof(*mask_bak) * bsize);
+        const gboolean guide_in = d->feathering_guide == DEVELOP_MASK_GUIDE_IN;
+        float *guide = guide_in ? (float *const restrict)ivoid : (float *const restrict)ovoid;
+        float *guide_tmp = NULL;
+        if(work != mask || (!rois_equal && guide_in))
         {
-          float *const restrict guide_tmp = dt_alloc_align_float(buffsize * ch);
-#ifdef _OPENMP
-#pragma omp parallel for default(none) \
-        dt_omp_firstprivate(ch, guide_tmp, ivoid, iwidth, oheight, owidth, xoffs, yoffs)
-#endif
-          for(size_t y = 0; y < oheight; y++)
+          guide_tmp = dt_alloc_align_float(bsize * ch);
+          if(guide_tmp)
           {
-            size_t iindex = ((size_t)(y + yoffs) * iwidth + xoffs) * ch;
-            size_t oindex = (size_t)y * owidth * ch;
-            memcpy(guide_tmp + oindex, (float *)ivoid + iindex, sizeof(*guide_tmp) * owidth * ch);
+            if(guide_in)
+              _blend_copy_rect(guide_tmp, bwidth, guide, iwidth, box.x + xoffs, box.y + yoffs, bwidth, bheight, ch);
+            else
+              _blend_copy_rect(guide_tmp, bwidth, guide, owidth, box.x, box.y, bwidth, bheight, ch);
           }
           guide = guide_tmp;
         }
-        guided_filter(guide, mask_bak, mask, owidth, oheight, ch, w, sqrt_eps, guide_weight, 0.f, 1.f);
-        if(!rois_equal && d->feathering_guide == DEVELOP_MASK_GUIDE_IN) dt_free_align(guide);
+        if(guide) guided_filter(guide, mask_bak, work, bwidth, bheight, ch, w, sqrt_eps, guide_weight, 0.f, 1.f);
+        dt_free_align(guide_tmp);
         dt_free_align(mask_bak);
       }
     }
-    if(mask_blur)
+    if(mask_blur && !mask_empty)
     {
-      const float sigma = d->blur_radius * roi_out->scale / piece->iscale;
       const float mmax[] = { 1.0f };
       const float mmin[] = { 0.0f };
 
-      dt_gaussian_t *g = dt_gaussian_init(owidth, oheight, 1, mmax, mmin, sigma, 0);
+      dt_gaussian_t *g = dt_gaussian_init(bwidth, bheight, 1, mmax, mmin, blur_sigma, 0);
       if(g)
       {
-        dt_gaussian_blur(g, mask, mask);
+        dt_gaussian_blur(g, work, work);
         dt_gaussian_free(g);
       }
     }
 
-    if(mask_tone_curve && opacity > 1e-4f)
+    if(mask_tone_curve && opacity > 1e-4f && !mask_empty)
     {
       const float mask_epsilon = 16 * FLT_EPSILON;  // empirical mask threshold for fully transparent masks
       const float e = expf(3.f * d->contrast);
       const float brightness = d->brightness;
 #ifdef _OPENMP
-#pragma omp parallel for simd default(none) aligned(mask:64)\
-      dt_omp_firstprivate(brightness, buffsize, e, mask, mask_epsilon, opacity) schedule(static)
+#pragma omp parallel for simd default(none) aligned(work:64)\
+      dt_omp_firstprivate(brightness, bsize, e, work, mask_epsilon, opacity) schedule(static)
 #endif
-      for(size_t k = 0; k < buffsize; k++)
+      for(size_t k = 0; k < bsize; k++)
       {
-        float x = mask[k] / opacity;
+        float x = work[k] / opacity;
         x = 2.f * x - 1.f;
         if (1.f - brightness <= 0.f)
-          x = mask[k] <= mask_epsilon ? -1.f : 1.f;
+          x = work[k] <= mask_epsilon ? -1.f : 1.f;
         else if (1.f + brightness <= 0.f)
-          x = mask[k] >= 1.f - mask_epsilon ? 1.f : -1.f;
+          x = work[k] >= 1.f - mask_epsilon ? 1.f : -1.f;
         else if (brightness > 0.f)
         {
           x = (x + brightness) / (1.f - brightness);
@@ -463,10 +565,16 @@ void dt_develop_blend_process(struct dt_iop_module_t *self, struct dt_dev_pixelp
           x = (x + brightness) / (1.f + brightness);
           x = fmaxf(x, -1.f);
         }
-        mask[k] = clamp_range_f(
+        work[k] = clamp_range_f(
             ((x * e / (1.f + (e - 1.f) * fabsf(x))) / 2.f + 0.5f) * opacity, 0.f, 1.f);
       }
     }
+
+    if(work != mask)
+    {
+      _blend_copy_rect_back(mask, owidth, work, box.x, box.y, bwidth, bheight);
+      dt_free_align(work);
+    }
   }
 
   // now apply blending with per-pixel opacity value as defined in mask
@@ -46,6 +46,12 @@
 #define DT_DEV_AVERAGE_DELAY_START 250
 #define DT_DEV_PREVIEW_AVERAGE_DELAY_START 50
 #define DT_DEV_AVERAGE_DELAY_COUNT 5
+// if the main pipe takes longer than this on average (ms), a coarse pass at a fraction of the scale goes first
+#define DT_DEV_PROGRESSIVE_MIN_DELAY 200
+#define DT_DEV_PROGRESSIVE_FRACTION 0.25f
+// value of pipe->shutdown when a change made the running refinement stale. unlike a real shutdown the
+// image job clears it again.
+#define DT_DEV_PROGRESSIVE_STALE 2
 #define DT_IOP_ORDER_INFO (darktable.unmuted & DT_DEBUG_IOPORDER)
 
 void dt_dev_init(dt_develop_t *dev, int32_t gui_attached)
@@ -57,6 +63,7 @@ void dt_dev_init(dt_develop_t *dev, int32_t gui_attached)
   dev->average_delay = DT_DEV_AVERAGE_DELAY_START;
   dev->preview_average_delay = DT_DEV_PREVIEW_AVERAGE_DELAY_START;
   dev->preview2_average_delay = DT_DEV_PREVIEW_AVERAGE_DELAY_START;
+  dt_atomic_set_int(&dev->progressive_refining, FALSE);
   dev->gui_leaving = 0;
   dev->gui_synch = 0;
   dt_pthread_mutex_init(&dev->history_mutex, NULL);
@@ -165,6 +172,11 @@ void dt_dev_cleanup(dt_develop_t *dev)
     dt_dev_free_history_item(((dt_dev_history_item_t *)dev->history->data));
     dev->history = g_list_delete_link(dev->history, dev->history);
   }
+  if(!dev->gui_attached)
+  {
+    dt_iop_release_modules(dev->iop);
+    dev->iop = NULL;
+  }
   while(dev->iop)
   {
     dt_iop_cleanup_module((dt_iop_module_t *)dev->iop->data);
@@ -239,8 +251,24 @@ void dt_dev_process_preview2(dt_develop_t *dev)
   if(err) fprintf(stderr, "[dev_process_preview2] job queue exceeded!\n");
 }
 
+// stop the full resolution pass following a coarse one right away, it is stale now
+static void _dev_cancel_refinement(dt_develop_t *dev)
+{
+  int running = FALSE;
+  if(dev->pipe && dt_atomic_get_int(&dev->progressive_refining))
+    dt_atomic_CAS_int(&dev->pipe->shutdown, &running, DT_DEV_PROGRESSIVE_STALE);
+}
+
+static void _dev_refinement_done(dt_develop_t *dev)
+{
+  dt_atomic_set_int(&dev->progressive_refining, FALSE);
+  int stale = DT_DEV_PROGRESSIVE_STALE;
+  dt_atomic_CAS_int(&dev->pipe->shutdown, &stale, FALSE);
+}
+
 void dt_dev_invalidate(dt_develop_t *dev)
 {
+  _dev_cancel_refinement(dev);
   dev->image_status = DT_DEV_PIXELPIPE_DIRTY;
   dev->timestamp++;
   if(dev->preview_pipe) dev->preview_pipe->input_timestamp = dev->timestamp;
@@ -249,6 +277,7 @@ void dt_dev_invalidate(dt_develop_t *dev)
 
 void dt_dev_invalidate_all(dt_develop_t *dev)
 {
+  _dev_cancel_refinement(dev);
   dev->image_status = dev->preview_status = dev->preview2_status = DT_DEV_PIXELPIPE_DIRTY;
   dev->timestamp++;
 }
@@ -568,6 +597,7 @@ restart:
     dt_pthread_mutex_unlock(&dev->pipe_mutex);
     return;
   }
+  _dev_refinement_done(dev);
   dev->pipe->input_timestamp = dev->timestamp;
   // dt_dev_pixelpipe_change() will clear the changed value
   pipe_changed = dev->pipe->changed;
@@ -601,8 +631,44 @@ restart:
   x = MAX(0, scale * dev->pipe->processed_width  * (.5 + zoom_x) - wd / 2);
   y = MAX(0, scale * dev->pipe->processed_height * (.5 + zoom_y) - ht / 2);
 
+  // progressive rendering: if the full render takes a while, show an upscaled coarse one first. the
+  // refinement runs on the full resolution cache lines and is cancelled by the next change. not needed
+  // if only the area of a local change gets recomputed.
+  if(!dev->image_loading && dev->gui_attached && dev->average_delay > DT_DEV_PROGRESSIVE_MIN_DELAY
+     && wd * DT_DEV_PROGRESSIVE_FRACTION >= 64 && ht * DT_DEV_PROGRESSIVE_FRACTION >= 64
+     && dt_conf_get_bool("darkroom/ui/progressive_rendering")
+     && !dt_dev_pixelpipe_local_change(dev->pipe, dev, x, y, wd, ht, scale))
+  {
+    dt_get_times(&start);
+    if(dt_dev_pixelpipe_process_coarse(dev->pipe, dev, x, y, wd, ht, scale, DT_DEV_PROGRESSIVE_FRACTION))
+    {
+      if(dev->image_force_reload)
+      {
+        dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
+        dt_control_log_busy_leave();
+        dt_control_toast_busy_leave();
+        dev->image_status = DT_DEV_PIXELPIPE_INVALID;
+        dt_pthread_mutex_unlock(&dev->pipe_mutex);
+        return;
+      }
+      else
+        goto restart;
+    }
+    dt_show_times(&start, "[dev_process_image] coarse pixel pipeline processing");
+
+    if(dev->pipe->changed != DT_DEV_PIPE_UNCHANGED) goto restart;
+
+    dev->pipe->backbuf_scale = scale;
+    dev->pipe->backbuf_zoom_x = zoom_x;
+    dev->pipe->backbuf_zoom_y = zoom_y;
+    dt_atomic_set_int(&dev->progressive_refining, TRUE);
+    if(!dev->gui_leaving) dt_control_queue_redraw_center();
+  }
+
   dt_get_times(&start);
-  if(dt_dev_pixelpipe_process(dev->pipe, dev, x, y, wd, ht, scale))
+  const int err = dt_dev_pixelpipe_process(dev->pipe, dev, x, y, wd, ht, scale);
+  _dev_refinement_done(dev);
+  if(err)
   {
     // interrupted because image changed?
     if(dev->image_force_reload)
@@ -724,12 +790,11 @@ void dt_dev_load_image(dt_develop_t *dev, const uint32_t imgid)
 
   dev->image_status = dev->preview_status = dev->preview2_status = DT_DEV_PIXELPIPE_DIRTY;
 
-  // we need a global lock as the dev->iop set must not be changed until read history is terminated
-  dt_pthread_mutex_lock(&darktable.dev_threadsafe);
+  // the modules are private to dev, only the part of the history read going through memory.history is
+  // serialized, see dt_dev_read_history_ext()
   dev->iop = dt_iop_load_modules(dev);
 
   dt_dev_read_history(dev);
-  dt_pthread_mutex_unlock(&darktable.dev_threadsafe);
 
   dev->first_load = FALSE;
 
@@ -1620,8 +1685,9 @@ static void _dev_merge_history(dt_develop_t *dev, const int imgid)
                                   "UPDATE memory.history SET num=?1 WHERE rowid=?2",
                                   -1, &stmt, NULL);
 
-      // let's wrap this into a transaction, it might make it a little faster.
-      sqlite3_exec(dt_database_get(darktable.db), "BEGIN TRANSACTION", NULL, NULL, NULL);
+      // let's wrap this into a transaction, it might make it a little faster. a savepoint, so that it nests
+      // into the transaction of a caller, see dt_history_copy_and_paste_on_list()
+      sqlite3_exec(dt_database_get(darktable.db), "SAVEPOINT merge_history", NULL, NULL, NULL);
       for(GList *r = rowids; r; r = g_list_next(r))
       {
         DT_DEBUG_SQLITE3_CLEAR_BINDINGS(stmt);
@@ -1634,7 +1700,7 @@ static void _dev_merge_history(dt_develop_t *dev, const int imgid)
         v++;
       }
 
-      sqlite3_exec(dt_database_get(darktable.db), "COMMIT", NULL, NULL, NULL);
+      sqlite3_exec(dt_database_get(darktable.db), "RELEASE merge_history", NULL, NULL, NULL);
 
       g_list_free(rowids);
 
@@ -1717,6 +1783,10 @@ void dt_dev_read_history_ext(dt_develop_t *dev, const int imgid, gboolean no_ima
 
   if(!no_image)
   {
+    // memory.history is shared by all develop objects, keep others out until it's merged. reloading the
+    // defaults has to be serialized as well, it touches darktable.gui->reset.
+    dt_pthread_mutex_lock(&darktable.dev_threadsafe);
+
     // cleanup
     DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DELETE FROM memory.history", NULL, NULL, NULL);
 
@@ -1739,6 +1809,7 @@ void dt_dev_read_history_ext(dt_develop_t *dev, const int imgid, gboolean no_ima
     _dev_merge_history(dev, imgid);
 
     dt_print(DT_DEBUG_PARAMS, "[history] temporary history merged with image history\n");
+    dt_pthread_mutex_unlock(&darktable.dev_threadsafe);
 
     //  first time we are loading the image, try to import lightroom .xmp if any
     if(dev->image_loading && first_run) dt_lightroom_import(dev->image_storage.id, dev, TRUE);
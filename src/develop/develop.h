@@ -23,6 +23,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 
+#include "common/atomic.h"
 #include "common/darktable.h"
 #include "common/dtpthread.h"
 #include "common/image.h"
@@ -154,6 +155,7 @@ typedef struct dt_develop_t
   uint32_t average_delay;
   uint32_t preview_average_delay;
   uint32_t preview2_average_delay;
+  dt_atomic_int progressive_refining; // set while the main pipe refines a coarse progressive render
   struct dt_iop_module_t *gui_module; // this module claims gui expose/event callbacks.
   float preview_downsampling;         // < 1.0: optionally downsample preview
 
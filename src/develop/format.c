@@ -29,6 +29,7 @@ size_t dt_iop_buffer_dsc_to_bpp(const struct dt_iop_buffer_dsc_t *dsc)
       bpp *= sizeof(float);
       break;
     case TYPE_UINT16:
+    case TYPE_HALF:
       bpp *= sizeof(uint16_t);
       break;
     default:
@@ -29,6 +29,7 @@ typedef enum dt_iop_buffer_type_t {
   TYPE_UNKNOWN,
   TYPE_FLOAT,
   TYPE_UINT16,
+  TYPE_HALF, // 4 channel float buffers kept in half precision by the pixelpipe, modules never see these
 } dt_iop_buffer_type_t;
 
 typedef struct dt_iop_buffer_dsc_t
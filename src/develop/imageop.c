@@ -1510,12 +1510,118 @@ int dt_iop_load_module(dt_iop_module_t *module, dt_iop_module_so_t *module_so, d
   return 0;
 }
 
+// keep at most that many module sets around, about one per concurrent export or thumbnail job
+#define DT_IOP_POOL_SIZE 8
+
+static void _iop_free_modules(GList *modules)
+{
+  for(GList *l = modules; l; l = g_list_next(l))
+  {
+    dt_iop_cleanup_module((dt_iop_module_t *)l->data);
+    free(l->data);
+  }
+  g_list_free(modules);
+}
+
+void dt_iop_release_modules(GList *modules)
+{
+  if(!modules) return;
+
+  // keep the base instance of each module, like the darkroom does when changing image
+  GList *base = NULL;
+  GList *extra = NULL;
+  for(GList *l = modules; l; l = g_list_next(l))
+  {
+    dt_iop_module_t *module = (dt_iop_module_t *)l->data;
+    dt_iop_module_t *other = NULL;
+    for(GList *b = base; b; b = g_list_next(b))
+      if(((dt_iop_module_t *)b->data)->so == module->so)
+      {
+        other = (dt_iop_module_t *)b->data;
+        break;
+      }
+
+    if(!other)
+      base = g_list_prepend(base, module);
+    else if(module->multi_priority < other->multi_priority)
+    {
+      g_list_find(base, other)->data = module;
+      extra = g_list_prepend(extra, other);
+    }
+    else
+      extra = g_list_prepend(extra, module);
+  }
+  g_list_free(modules);
+  _iop_free_modules(extra);
+
+  // an incomplete set is of no use
+  if(g_list_length(base) != g_list_length(darktable.iop))
+  {
+    _iop_free_modules(base);
+    return;
+  }
+
+  // back to the state of a freshly loaded instance, the defaults are reloaded with the next history
+  for(GList *l = base; l; l = g_list_next(l))
+  {
+    dt_iop_module_t *module = (dt_iop_module_t *)l->data;
+    module->dev = NULL;
+    module->iop_order = 0;
+    module->multi_priority = 0;
+    module->multi_name[0] = '\0';
+    module->enabled = module->default_enabled;
+    module->has_trouble = FALSE;
+    module->request_color_pick = DT_REQUEST_COLORPICK_OFF;
+    module->request_histogram = DT_REQUEST_ONLY_IN_GUI;
+    module->request_mask_display = DT_DEV_PIXELPIPE_DISPLAY_NONE;
+    module->suppress_mask = 0;
+    dt_iop_cleanup_histogram(module, NULL);
+    g_hash_table_remove_all(module->raster_mask.source.users);
+    g_hash_table_remove_all(module->raster_mask.source.masks);
+    module->raster_mask.sink.source = NULL;
+    module->raster_mask.sink.id = 0;
+  }
+
+  dt_pthread_mutex_lock(&darktable.iop_pool_threadsafe);
+  if(g_list_length(darktable.iop_pool) < DT_IOP_POOL_SIZE)
+  {
+    darktable.iop_pool = g_list_prepend(darktable.iop_pool, base);
+    base = NULL;
+  }
+  dt_pthread_mutex_unlock(&darktable.iop_pool_threadsafe);
+
+  _iop_free_modules(base);
+}
+
 GList *dt_iop_load_modules_ext(dt_develop_t *dev, gboolean no_image)
 {
   GList *res = NULL;
   dt_iop_module_t *module;
   dt_iop_module_so_t *module_so;
   dev->iop_instance = 0;
+
+  // headless develop objects get a set of a previous one if there is one, saves calling init() on all modules.
+  // the defaults of a pooled set are those of the image it was last used for, so only callers reloading them
+  // with the history of their image can take one.
+  if(!dev->gui_attached && !no_image)
+  {
+    dt_pthread_mutex_lock(&darktable.iop_pool_threadsafe);
+    if(darktable.iop_pool)
+    {
+      res = (GList *)darktable.iop_pool->data;
+      darktable.iop_pool = g_list_delete_link(darktable.iop_pool, darktable.iop_pool);
+    }
+    dt_pthread_mutex_unlock(&darktable.iop_pool_threadsafe);
+
+    for(GList *it = res; it; it = g_list_next(it))
+    {
+      module = (dt_iop_module_t *)it->data;
+      module->dev = dev;
+      module->instance = dev->iop_instance++;
+    }
+    if(res) return res;
+  }
+
   GList *iop = darktable.iop;
   while(iop)
   {
@@ -1567,6 +1673,11 @@ void dt_iop_cleanup_module(dt_iop_module_t *module)
 
 void dt_iop_unload_modules_so()
 {
+  while(darktable.iop_pool)
+  {
+    _iop_free_modules((GList *)darktable.iop_pool->data);
+    darktable.iop_pool = g_list_delete_link(darktable.iop_pool, darktable.iop_pool);
+  }
   while(darktable.iop)
   {
     dt_iop_module_so_t *module = (dt_iop_module_so_t *)darktable.iop->data;
@@ -1762,6 +1873,13 @@ void dt_iop_commit_params(dt_iop_module_t *module, dt_iop_params_t *params,
 
   module->commit_params(module, params, pipe, piece);
 
+  // keep the params to find out what a change touched, see changed_area()
+  if(module->changed_area)
+  {
+    if(!piece->committed_params) piece->committed_params = malloc(module->params_size);
+    memcpy(piece->committed_params, params, module->params_size);
+  }
+
   // 2. compute the hash only if piece is enabled
 
   piece->hash = 0;
@@ -104,7 +104,8 @@ typedef enum dt_iop_flags_t
   IOP_FLAGS_NO_MASKS           = 1 << 10, // The module doesn't support masks (used with SUPPORT_BLENDING)
   IOP_FLAGS_FENCE              = 1 << 11, // No module can be moved pass this one
   IOP_FLAGS_ALLOW_FAST_PIPE    = 1 << 12, // Module can work with a fast pipe
-  IOP_FLAGS_UNSAFE_COPY        = 1 << 13  // Unsafe to copy as part of history
+  IOP_FLAGS_UNSAFE_COPY        = 1 << 13, // Unsafe to copy as part of history
+  IOP_FLAGS_FULL_PRECISION     = 1 << 14  // Output stays in 32 bit floats when the pipe keeps its buffers in half precision
 } dt_iop_flags_t;
 
 /** status of a module*/
@@ -310,6 +311,9 @@ int dt_iop_load_module_by_so(dt_iop_module_t *module, dt_iop_module_so_t *so, st
 /** returns a list of instances referencing stuff loaded in load_modules_so. */
 GList *dt_iop_load_modules_ext(struct dt_develop_t *dev, gboolean no_image);
 GList *dt_iop_load_modules(struct dt_develop_t *dev);
+/** gives the instances of a headless develop object back for reuse by the next dt_iop_load_modules(). frees the
+    list. */
+void dt_iop_release_modules(GList *modules);
 int dt_iop_load_module(dt_iop_module_t *module, dt_iop_module_so_t *module_so, struct dt_develop_t *dev);
 /** calls module->cleanup and closes the dl connection. */
 void dt_iop_cleanup_module(dt_iop_module_t *module);
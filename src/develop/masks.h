@@ -401,6 +401,13 @@ void dt_masks_iop_combo_populate(GtkWidget *w, struct dt_iop_module_t **m);
 void dt_masks_iop_use_same_as(struct dt_iop_module_t *module, struct dt_iop_module_t *src);
 int dt_masks_group_get_hash_buffer_length(dt_masks_form_t *form);
 char *dt_masks_group_get_hash_buffer(dt_masks_form_t *form, char *str);
+/** get the bounding box (x, y, width, height in module input coordinates) of everything that changed between
+ * two snapshots of the form group group_id, forms listed in changed_ids count as changed. forms listed in
+ * dest_reading_ids compute their whole destination from the pixels there (heal, blur), so they change with any
+ * part of it. returns FALSE if the change can't be bounded (inverted or nested forms, new order of the forms) */
+gboolean dt_masks_group_changed_area(dt_iop_module_t *module, dt_dev_pixelpipe_iop_t *piece, GList *old_forms,
+                                     GList *new_forms, const int group_id, GList *changed_ids,
+                                     GList *dest_reading_ids, float area[4]);
 
 void dt_masks_form_remove(struct dt_iop_module_t *module, dt_masks_form_t *grp, dt_masks_form_t *form);
 void dt_masks_form_change_opacity(dt_masks_form_t *form, int parentid, int up);
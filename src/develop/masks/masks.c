@@ -1930,6 +1930,146 @@ char *dt_masks_group_get_hash_buffer(dt_masks_form_t *form, char *str)
   return str + pos;
 }
 
+static gboolean _masks_form_equal(dt_masks_form_t *a, dt_masks_form_t *b)
+{
+  if((a->type & DT_MASKS_GROUP) || (b->type & DT_MASKS_GROUP)) return FALSE;
+  const int len = dt_masks_group_get_hash_buffer_length(a);
+  if(len != dt_masks_group_get_hash_buffer_length(b)) return FALSE;
+  char *ba = malloc(len), *bb = malloc(len);
+  dt_masks_group_get_hash_buffer(a, ba);
+  dt_masks_group_get_hash_buffer(b, bb);
+  const gboolean equal = !memcmp(ba, bb, len);
+  free(ba);
+  free(bb);
+  return equal;
+}
+
+static void _masks_area_union(float area[4], const int w, const int h, const int x, const int y)
+{
+  if(w <= 0 || h <= 0) return;
+  if(area[2] <= 0.0f || area[3] <= 0.0f)
+  {
+    area[0] = x, area[1] = y, area[2] = w, area[3] = h;
+    return;
+  }
+  const float r = fmaxf(area[0] + area[2], x + w), b = fmaxf(area[1] + area[3], y + h);
+  area[0] = fminf(area[0], x);
+  area[1] = fminf(area[1], y);
+  area[2] = r - area[0];
+  area[3] = b - area[1];
+}
+
+static gboolean _masks_area_intersect(const float area[4], const int w, const int h, const int x, const int y)
+{
+  return area[2] > 0.0f && area[3] > 0.0f && w > 0 && h > 0
+         && x < area[0] + area[2] && area[0] < x + w && y < area[1] + area[3] && area[1] < y + h;
+}
+
+gboolean dt_masks_group_changed_area(dt_iop_module_t *module, dt_dev_pixelpipe_iop_t *piece, GList *old_forms,
+                                     GList *new_forms, const int group_id, GList *changed_ids,
+                                     GList *dest_reading_ids, float area[4])
+{
+  area[0] = area[1] = area[2] = area[3] = 0.0f;
+
+  dt_masks_form_t *old_grp = dt_masks_get_from_id_ext(old_forms, group_id);
+  dt_masks_form_t *new_grp = dt_masks_get_from_id_ext(new_forms, group_id);
+  if(!old_grp && !new_grp) return TRUE;
+  if(!old_grp || !new_grp || !(old_grp->type & DT_MASKS_GROUP) || !(new_grp->type & DT_MASKS_GROUP))
+    return FALSE;
+
+  // forms are applied one after the other, so forms kept in a new order are a global change
+  gboolean local = TRUE;
+  const GList *o = old_grp->points;
+  for(const GList *n = new_grp->points; n && local; n = g_list_next(n))
+  {
+    const int formid = ((dt_masks_point_group_t *)n->data)->formid;
+    const GList *found = o;
+    while(found && ((dt_masks_point_group_t *)found->data)->formid != formid) found = g_list_next(found);
+    if(found)
+      o = g_list_next(found);
+    else
+      for(const GList *m = old_grp->points; m && local; m = g_list_next(m))
+        if(((dt_masks_point_group_t *)m->data)->formid == formid) local = FALSE;
+  }
+  if(!local) return FALSE;
+
+  // destination and source areas of every new form, in module input coordinates
+  const int count = g_list_length(new_grp->points);
+  gboolean *changed = calloc(count, sizeof(gboolean));
+  gboolean *reads_dest = calloc(count, sizeof(gboolean));
+  int(*dest)[4] = calloc(count, sizeof(int[4]));
+  int(*src)[4] = calloc(count, sizeof(int[4]));
+
+  for(const GList *l = old_grp->points; l && local; l = g_list_next(l))
+  {
+    const dt_masks_point_group_t *ogrpt = (dt_masks_point_group_t *)l->data;
+    const dt_masks_point_group_t *ngrpt = NULL;
+    for(const GList *m = new_grp->points; m; m = g_list_next(m))
+      if(((dt_masks_point_group_t *)m->data)->formid == ogrpt->formid) ngrpt = (dt_masks_point_group_t *)m->data;
+
+    dt_masks_form_t *oform = dt_masks_get_from_id_ext(old_forms, ogrpt->formid);
+    dt_masks_form_t *nform = ngrpt ? dt_masks_get_from_id_ext(new_forms, ngrpt->formid) : NULL;
+    if(!oform || (oform->type & DT_MASKS_GROUP) || (ogrpt->state & DT_MASKS_STATE_INVERSE)) local = FALSE;
+    if(!local) break;
+
+    if(!nform || ngrpt->state != ogrpt->state || ngrpt->opacity != ogrpt->opacity
+       || g_list_find(changed_ids, GINT_TO_POINTER(ogrpt->formid)) || !_masks_form_equal(oform, nform))
+    {
+      int w = 0, h = 0, x = 0, y = 0;
+      if(!dt_masks_get_area(module, piece, oform, &w, &h, &x, &y)) local = FALSE;
+      _masks_area_union(area, w, h, x, y);
+    }
+  }
+
+  int k = 0;
+  for(const GList *l = new_grp->points; l && local; l = g_list_next(l), k++)
+  {
+    const dt_masks_point_group_t *ngrpt = (dt_masks_point_group_t *)l->data;
+    dt_masks_form_t *nform = dt_masks_get_from_id_ext(new_forms, ngrpt->formid);
+    if(!nform || (nform->type & DT_MASKS_GROUP) || (ngrpt->state & DT_MASKS_STATE_INVERSE))
+    {
+      local = FALSE;
+      break;
+    }
+    dt_masks_get_area(module, piece, nform, &dest[k][2], &dest[k][3], &dest[k][0], &dest[k][1]);
+    dt_masks_get_source_area(module, piece, nform, &src[k][2], &src[k][3], &src[k][0], &src[k][1]);
+    reads_dest[k] = g_list_find(dest_reading_ids, GINT_TO_POINTER(ngrpt->formid)) != NULL;
+
+    const dt_masks_point_group_t *ogrpt = NULL;
+    for(const GList *m = old_grp->points; m; m = g_list_next(m))
+      if(((dt_masks_point_group_t *)m->data)->formid == ngrpt->formid) ogrpt = (dt_masks_point_group_t *)m->data;
+    dt_masks_form_t *oform = ogrpt ? dt_masks_get_from_id_ext(old_forms, ogrpt->formid) : NULL;
+
+    if(!oform || ngrpt->state != ogrpt->state || ngrpt->opacity != ogrpt->opacity
+       || g_list_find(changed_ids, GINT_TO_POINTER(ngrpt->formid)) || !_masks_form_equal(oform, nform))
+    {
+      changed[k] = TRUE;
+      _masks_area_union(area, dest[k][2], dest[k][3], dest[k][0], dest[k][1]);
+    }
+  }
+
+  // an unchanged form cloning from a changed area changes as well, and so does one computing its whole
+  // destination from what is below it once that changed in any part
+  for(gboolean grown = local; grown;)
+  {
+    grown = FALSE;
+    for(k = 0; k < count; k++)
+      if(!changed[k]
+         && (_masks_area_intersect(area, src[k][2], src[k][3], src[k][0], src[k][1])
+             || (reads_dest[k] && _masks_area_intersect(area, dest[k][2], dest[k][3], dest[k][0], dest[k][1]))))
+      {
+        changed[k] = grown = TRUE;
+        _masks_area_union(area, dest[k][2], dest[k][3], dest[k][0], dest[k][1]);
+      }
+  }
+
+  free(changed);
+  free(reads_dest);
+  free(dest);
+  free(src);
+  return local;
+}
+
 void dt_masks_update_image(dt_develop_t *dev)
 {
   /* invalidate image data*/
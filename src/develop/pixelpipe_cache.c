@@ -292,6 +292,23 @@ void dt_dev_pixelpipe_cache_invalidate(dt_dev_pixelpipe_cache_t *cache, void *da
   }
 }
 
+void *dt_dev_pixelpipe_cache_steal(dt_dev_pixelpipe_cache_t *cache, void *data)
+{
+  for(int k = 0; k < cache->entries; k++)
+  {
+    if(data && cache->data[k] == data)
+    {
+      // the line is left empty, the next miss reallocates it
+      cache->data[k] = NULL;
+      cache->size[k] = 0;
+      cache->basichash[k] = -1;
+      cache->hash[k] = -1;
+      return data;
+    }
+  }
+  return NULL;
+}
+
 void dt_dev_pixelpipe_cache_print(dt_dev_pixelpipe_cache_t *cache)
 {
   for(int k = 0; k < cache->entries; k++)
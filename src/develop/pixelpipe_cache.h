@@ -92,6 +92,10 @@ void dt_dev_pixelpipe_cache_reweight(dt_dev_pixelpipe_cache_t *cache, void *data
 /** mark the given cache line pointer as invalid. */
 void dt_dev_pixelpipe_cache_invalidate(dt_dev_pixelpipe_cache_t *cache, void *data);
 
+/** takes the buffer of the given cache line pointer out of the cache, the caller has to dt_free_align() it.
+ * returns NULL if it isn't a cache line. */
+void *dt_dev_pixelpipe_cache_steal(dt_dev_pixelpipe_cache_t *cache, void *data);
+
 /** print out cache lines/hashes (debug). */
 void dt_dev_pixelpipe_cache_print(dt_dev_pixelpipe_cache_t *cache);
 
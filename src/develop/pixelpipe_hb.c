@@ -17,8 +17,10 @@
 */
 #include "common/color_picker.h"
 #include "common/colorspaces.h"
+#include "common/float16.h"
 #include "common/histogram.h"
 #include "common/imageio.h"
+#include "common/interpolation.h"
 #include "common/opencl.h"
 #include "common/iop_order.h"
 #include "control/control.h"
@@ -63,6 +65,9 @@ typedef enum dt_pixelpipe_picker_source_t
 
 #include "develop/pixelpipe_cache.c"
 
+// input, output and one spare line are all a coarse pass needs
+#define DT_DEV_PIXELPIPE_COARSE_CACHE_ENTRIES 3
+
 static void get_output_format(dt_iop_module_t *module, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece,
                               dt_develop_t *dev, dt_iop_buffer_dsc_t *dsc);
 
@@ -165,6 +170,8 @@ int dt_dev_pixelpipe_init_cached(dt_dev_pixelpipe_t *pipe, size_t size, int32_t
   pipe->nodes = NULL;
   pipe->backbuf_size = size;
   if(!dt_dev_pixelpipe_cache_init(&(pipe->cache), entries, pipe->backbuf_size)) return 0;
+  // buffers are only allocated once a coarse pass runs
+  if(!dt_dev_pixelpipe_cache_init(&(pipe->coarse_cache), DT_DEV_PIXELPIPE_COARSE_CACHE_ENTRIES, 0)) return 0;
   pipe->cache_obsolete = 0;
   pipe->backbuf = NULL;
   pipe->backbuf_scale = 0.0f;
@@ -175,6 +182,18 @@ int dt_dev_pixelpipe_init_cached(dt_dev_pixelpipe_t *pipe, size_t size, int32_t
   pipe->output_backbuf_width = 0;
   pipe->output_backbuf_height = 0;
   pipe->output_imgid = 0;
+  pipe->coarse_width = 0;
+  pipe->coarse_height = 0;
+  pipe->active_cache = &pipe->cache;
+  memset(&pipe->output_backbuf_roi, 0, sizeof(pipe->output_backbuf_roi));
+  pipe->processed_forms = NULL;
+  pipe->processed_gui_module = NULL;
+  pipe->processed_type = DT_DEV_PIXELPIPE_NONE;
+  pipe->patch_source.buf = NULL;
+  pipe->half_buffers = dt_conf_get_bool("pixelpipe_half_precision_buffers");
+  pipe->verify_patches = dt_conf_get_bool("pixelpipe_verify_local_changes");
+  pipe->half_scratch[0] = pipe->half_scratch[1] = NULL;
+  pipe->half_scratch_size[0] = pipe->half_scratch_size[1] = 0;
 
   pipe->processing = 0;
   dt_atomic_set_int(&pipe->shutdown,FALSE);
@@ -228,6 +247,7 @@ void dt_dev_pixelpipe_cleanup(dt_dev_pixelpipe_t *pipe)
   dt_dev_pixelpipe_cleanup_nodes(pipe);
   // so now it's safe to clean up cache:
   dt_dev_pixelpipe_cache_cleanup(&(pipe->cache));
+  dt_dev_pixelpipe_cache_cleanup(&(pipe->coarse_cache));
   dt_pthread_mutex_unlock(&pipe->backbuf_mutex);
   dt_pthread_mutex_destroy(&(pipe->backbuf_mutex));
   dt_pthread_mutex_destroy(&(pipe->busy_mutex));
@@ -246,6 +266,15 @@ void dt_dev_pixelpipe_cleanup(dt_dev_pixelpipe_t *pipe)
     g_list_free_full(pipe->forms, (void (*)(void *))dt_masks_free_form);
     pipe->forms = NULL;
   }
+  g_list_free_full(pipe->processed_forms, (void (*)(void *))dt_masks_free_form);
+  pipe->processed_forms = NULL;
+
+  for(int k = 0; k < 2; k++)
+  {
+    dt_free_align(pipe->half_scratch[k]);
+    pipe->half_scratch[k] = NULL;
+    pipe->half_scratch_size[k] = 0;
+  }
 }
 
 void dt_dev_pixelpipe_cleanup_nodes(dt_dev_pixelpipe_t *pipe)
@@ -268,6 +297,9 @@ void dt_dev_pixelpipe_cleanup_nodes(dt_dev_pixelpipe_t *pipe)
     piece->histogram = NULL;
     g_hash_table_destroy(piece->raster_masks);
     piece->raster_masks = NULL;
+    free(piece->committed_params);
+    free(piece->processed_params);
+    free(piece->processed_blendop);
     free(piece);
   }
   g_list_free(pipe->nodes);
@@ -320,6 +352,8 @@ void dt_dev_pixelpipe_create_nodes(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev)
     piece->process_cl_ready = 0;
     piece->process_tiling_ready = 0;
     piece->raster_masks = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, dt_free_align_ptr);
+    piece->committed_params = piece->processed_params = piece->processed_blendop = NULL;
+    piece->processed_hash = 0;
     memset(&piece->processed_roi_in, 0, sizeof(piece->processed_roi_in));
     memset(&piece->processed_roi_out, 0, sizeof(piece->processed_roi_out));
     dt_iop_init_pipe(piece->module, pipe, piece);
@@ -328,6 +362,70 @@ void dt_dev_pixelpipe_create_nodes(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev)
   dt_pthread_mutex_unlock(&pipe->busy_mutex); // safe for others to use/mess with the pipe now
 }
 
+static inline gboolean _is_colorspace_conversion(const dt_iop_colorspace_type_t from,
+                                                 const dt_iop_colorspace_type_t to)
+{
+  // raw data isn't converted, it just changes meaning at demosaic
+  return from != to && from != iop_cs_RAW && from != iop_cs_NONE && to != iop_cs_RAW && to != iop_cs_NONE;
+}
+
+static const char *_colorspace_to_str(const dt_iop_colorspace_type_t cst)
+{
+  switch(cst)
+  {
+    case iop_cs_RAW: return "raw";
+    case iop_cs_Lab: return "Lab";
+    case iop_cs_rgb: return "RGB";
+    case iop_cs_LCh: return "LCh";
+    case iop_cs_HSL: return "HSL";
+    case iop_cs_JzCzhz: return "JzCzhz";
+    default: return "none";
+  }
+}
+
+static gboolean _transform_for_blend(const dt_iop_module_t *const self, const dt_dev_pixelpipe_iop_t *const piece);
+
+// walk the enabled pieces once and count where the buffers get converted, for processing and for blending.
+// printed with -d pipe.
+static void _pixelpipe_plan_colorspaces(dt_dev_pixelpipe_t *pipe)
+{
+  dt_iop_colorspace_type_t cst = pipe->image.buf_dsc.cst;
+  int conversions = 0;
+
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    dt_iop_module_t *module = piece->module;
+    if(!piece->enabled) continue;
+
+    const dt_iop_colorspace_type_t cst_in = module->input_colorspace(module, pipe, piece);
+    if(_is_colorspace_conversion(cst, cst_in))
+    {
+      conversions++;
+      dt_print(DT_DEBUG_PIPE, "[pixelpipe] [%s] %s converts %s -> %s for processing\n",
+               _pipe_type_to_str(pipe->type), module->op, _colorspace_to_str(cst), _colorspace_to_str(cst_in));
+    }
+    cst = module->output_colorspace(module, pipe, piece);
+
+    if(_transform_for_blend(module, piece))
+    {
+      const dt_iop_colorspace_type_t blend_cst = dt_develop_blend_colorspace(piece, cst);
+      // input and output of the module are converted for blending
+      const int blend_conversions
+          = _is_colorspace_conversion(cst_in, blend_cst) + _is_colorspace_conversion(cst, blend_cst);
+      if(blend_conversions)
+        dt_print(DT_DEBUG_PIPE, "[pixelpipe] [%s] %s converts %d buffers -> %s for blending\n",
+                 _pipe_type_to_str(pipe->type), module->op, blend_conversions, _colorspace_to_str(blend_cst));
+      conversions += blend_conversions;
+      cst = blend_cst;
+    }
+  }
+
+  pipe->colorspace_conversions = conversions;
+  dt_print(DT_DEBUG_PIPE, "[pixelpipe] [%s] %d colorspace conversions per run\n", _pipe_type_to_str(pipe->type),
+           conversions);
+}
+
 // helper
 void dt_dev_pixelpipe_synch(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, GList *history)
 {
@@ -397,6 +495,7 @@ void dt_dev_pixelpipe_synch_all(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev)
     dt_dev_pixelpipe_synch(pipe, dev, history);
     history = g_list_next(history);
   }
+  _pixelpipe_plan_colorspaces(pipe);
   dt_pthread_mutex_unlock(&pipe->busy_mutex);
 }
 
@@ -409,6 +508,7 @@ void dt_dev_pixelpipe_synch_top(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev)
     dt_dev_history_item_t *hist = (dt_dev_history_item_t *)history->data;
     dt_print(DT_DEBUG_PARAMS, "[pixelpipe] synch top history module `%s' for pipe %i\n", hist->module->op, pipe->type);
     dt_dev_pixelpipe_synch(pipe, dev, history);
+    _pixelpipe_plan_colorspaces(pipe);
   }
   else
   {
@@ -1166,6 +1266,188 @@ static int pixelpipe_process_on_CPU(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev,
   return 0; //no errors
 }
 
+// number of pixels a fused run of pointwise modules processes at once, 16KB of float4
+#define DT_PIXELPIPE_POINTWISE_SPAN 1024
+
+// a pointwise piece can be fused with its neighbours as long as nobody needs its own input or output buffer:
+// no blending, no picker, no histogram and not the focused module whose input the cache keeps around.
+static gboolean _piece_is_pointwise(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, dt_dev_pixelpipe_iop_t *piece,
+                                    const dt_iop_roi_t *roi, const dt_iop_colorspace_type_t cst)
+{
+  dt_iop_module_t *module = piece->module;
+  if(!module->process_pointwise
+     || module == dev->gui_module
+     || _transform_for_blend(module, piece)
+     || _request_color_pick(pipe, dev, module)
+     || (piece->request_histogram & DT_REQUEST_ON))
+    return FALSE;
+
+  if(module->input_colorspace(module, pipe, piece) != cst || module->output_colorspace(module, pipe, piece) != cst)
+    return FALSE;
+
+  dt_iop_roi_t roi_in = *roi;
+  module->modify_roi_in(module, piece, roi, &roi_in);
+  return !memcmp(&roi_in, roi, sizeof(dt_iop_roi_t));
+}
+
+// walk back from the module at pos and count the pointwise modules which can run in one pass with it.
+// the run stops at the first module whose output is in the cache, the recursion takes it from there.
+static int _pixelpipe_pointwise_run(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, const dt_iop_roi_t *roi,
+                                    GList *modules, GList *pieces, const int pos, GList **first_module,
+                                    GList **first_piece, int *first_pos)
+{
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE) return 0;
+#ifdef HAVE_OPENCL
+  // buffers stay on the device there, nothing to gain
+  if(pipe->opencl_enabled && pipe->devid >= 0) return 0;
+#endif
+
+  dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)pieces->data;
+  const dt_iop_colorspace_type_t cst = piece->module->input_colorspace(piece->module, pipe, piece);
+  if((cst != iop_cs_rgb && cst != iop_cs_Lab) || !_piece_is_pointwise(pipe, dev, piece, roi, cst)) return 0;
+
+  int count = 1;
+  *first_module = modules;
+  *first_piece = pieces;
+  *first_pos = pos;
+
+  int k = pos - 1;
+  for(GList *m = g_list_previous(modules), *p = g_list_previous(pieces); m && p;
+      m = g_list_previous(m), p = g_list_previous(p), k--)
+  {
+    dt_iop_module_t *module = (dt_iop_module_t *)m->data;
+    piece = (dt_dev_pixelpipe_iop_t *)p->data;
+    if(!piece->enabled
+       || (dev->gui_module && dev->gui_module->operation_tags_filter() & module->operation_tags()))
+      continue;
+    if(!_piece_is_pointwise(pipe, dev, piece, roi, cst)) break;
+
+    uint64_t basichash = 0, hash = 0;
+    dt_dev_pixelpipe_cache_fullhash(pipe->image.id, roi, pipe, k, &basichash, &hash);
+    if(dt_dev_pixelpipe_cache_available(pipe->active_cache, hash)) break;
+
+    count++;
+    *first_module = m;
+    *first_piece = p;
+    *first_pos = k;
+  }
+  return count;
+}
+
+// copy the input span by span into the output and run all modules of the run on it while it is in cache
+static void _pixelpipe_pointwise_pass(dt_dev_pixelpipe_iop_t **run, const int count, const float *const in,
+                                      void *const out, const gboolean out_half, const size_t npixels)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(run, count, in, out, out_half, npixels) \
+  schedule(static)
+#endif
+  for(size_t start = 0; start < npixels; start += DT_PIXELPIPE_POINTWISE_SPAN)
+  {
+    const size_t n = MIN(DT_PIXELPIPE_POINTWISE_SPAN, npixels - start);
+    // a half precision output is only written once the span is done
+    float DT_ALIGNED_ARRAY buf[4 * DT_PIXELPIPE_POINTWISE_SPAN];
+    float *const span = out_half ? buf : (float *)out + (size_t)4 * start;
+    memcpy(span, in + (size_t)4 * start, sizeof(float) * 4 * n);
+    for(int k = 0; k < count; k++) run[k]->module->process_pointwise(run[k]->module, run[k], span, n);
+    if(out_half) dt_float_to_half_buf((uint16_t *)out + (size_t)4 * start, span, 4 * n);
+  }
+}
+
+// decide which pieces keep their output in half precision during this run. the final output stays in floats,
+// as do the buffers of the opencl path and those of modules with IOP_FLAGS_FULL_PRECISION.
+static void _pixelpipe_plan_half_buffers(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev)
+{
+  const gboolean active = pipe->half_buffers && pipe->devid < 0;
+  dt_dev_pixelpipe_iop_t *last = NULL;
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    dt_iop_module_t *module = piece->module;
+    piece->store_half = active && piece->enabled && !(module->flags() & IOP_FLAGS_FULL_PRECISION);
+    if(piece->enabled && !(dev->gui_module && dev->gui_module->operation_tags_filter() & module->operation_tags()))
+      last = piece;
+  }
+  if(last) last->store_half = FALSE;
+}
+
+// whether the output of the piece goes to the cache in half precision, given its format as a module output
+static inline gboolean _piece_store_half(dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece,
+                                         const dt_iop_buffer_dsc_t *const dsc)
+{
+  return piece->store_half && pipe->devid < 0 && dsc->datatype == TYPE_FLOAT && dsc->channels == 4
+         && !(pipe->mask_display & (DT_DEV_PIXELPIPE_DISPLAY_ANY | DT_DEV_PIXELPIPE_DISPLAY_MASK));
+}
+
+// one of the two float buffers modules work with while the lines are in half precision
+static float *_pixelpipe_half_scratch(dt_dev_pixelpipe_t *pipe, const int k, const size_t nfloats)
+{
+  if(pipe->half_scratch_size[k] < nfloats)
+  {
+    dt_free_align(pipe->half_scratch[k]);
+    pipe->half_scratch[k] = dt_alloc_align_float(nfloats);
+    pipe->half_scratch_size[k] = pipe->half_scratch[k] ? nfloats : 0;
+  }
+  return pipe->half_scratch[k];
+}
+
+static void _pixelpipe_half_to_float(float *const out, const uint16_t *const in, const size_t n)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(out, in, n) \
+  schedule(static)
+#endif
+  for(size_t k = 0; k < n; k += 4 * DT_PIXELPIPE_POINTWISE_SPAN)
+    dt_half_to_float_buf(out + k, in + k, MIN(4 * DT_PIXELPIPE_POINTWISE_SPAN, n - k));
+}
+
+static void _pixelpipe_float_to_half(uint16_t *const out, const float *const in, const size_t n)
+{
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(out, in, n) \
+  schedule(static)
+#endif
+  for(size_t k = 0; k < n; k += 4 * DT_PIXELPIPE_POINTWISE_SPAN)
+    dt_float_to_half_buf(out + k, in + k, MIN(4 * DT_PIXELPIPE_POINTWISE_SPAN, n - k));
+}
+
+// modules work on floats, give them a copy of a half precision input line
+static int _pixelpipe_expand_half(dt_dev_pixelpipe_t *pipe, void **input, dt_iop_buffer_dsc_t **input_format,
+                                  dt_iop_buffer_dsc_t *float_format, const dt_iop_roi_t *roi)
+{
+  if((*input_format)->datatype != TYPE_HALF) return 0;
+
+  const size_t n = (size_t)(*input_format)->channels * roi->width * roi->height;
+  float *const buf = _pixelpipe_half_scratch(pipe, 0, n);
+  if(!buf) return 1;
+  _pixelpipe_half_to_float(buf, (const uint16_t *)*input, n);
+  *float_format = **input_format;
+  float_format->datatype = TYPE_FLOAT;
+  *input_format = float_format;
+  *input = buf;
+  return 0;
+}
+
+// copy the part of the input line of the changed module a patch needs, see _pixelpipe_find_patch()
+static void _pixelpipe_crop_patch_source(const dt_dev_pixelpipe_patch_source_t *const src, void *const out,
+                                         const dt_iop_roi_t *const roi, const size_t bpp)
+{
+  const char *const in = (const char *)src->buf;
+  const int dx = roi->x - src->roi.x;
+  const int dy = roi->y - src->roi.y;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(in, out, roi, src, bpp, dx, dy) \
+  schedule(static)
+#endif
+  for(int j = 0; j < roi->height; j++)
+    memcpy((char *)out + bpp * j * roi->width, in + bpp * ((size_t)(dy + j) * src->roi.width + dx),
+           bpp * roi->width);
+}
+
 // recursive helper for process:
 static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, void **output,
                                         void **cl_mem_output, dt_iop_buffer_dsc_t **out_format,
@@ -1220,7 +1502,7 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
      || strcmp(module->op, "gamma") != 0)
   {
     dt_dev_pixelpipe_cache_fullhash(pipe->image.id, roi_out, pipe, pos, &basichash, &hash);
-    cache_available = dt_dev_pixelpipe_cache_available(&(pipe->cache), hash);
+    cache_available = dt_dev_pixelpipe_cache_available(pipe->active_cache, hash);
   }
   if(cache_available)
   {
@@ -1228,13 +1510,28 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
     // if(module) printf("found valid buf pos %d in cache for module %s %s %lu\n", pos, module->op, pipe ==
     // dev->preview_pipe ? "[preview]" : "", hash);
 
-    (void)dt_dev_pixelpipe_cache_get(&(pipe->cache), basichash, hash, bufsize, output, out_format);
+    (void)dt_dev_pixelpipe_cache_get(pipe->active_cache, basichash, hash, bufsize, output, out_format);
 
     if(!modules) return 0;
     // go to post-collect directly:
     goto post_process_collect_info;
   }
 
+  // a patch of a local change starts from the unchanged input of the changed module
+  if(pipe->patch_source.buf && pos == pipe->patch_source.pos)
+  {
+    const size_t src_bpp = dt_iop_buffer_dsc_to_bpp(&pipe->patch_source.dsc);
+    **out_format = pipe->dsc = pipe->patch_source.dsc;
+    // like for a line kept in half precision, the pipe goes on with the float format the caller expands it to
+    if(pipe->dsc.datatype == TYPE_HALF) pipe->dsc.datatype = TYPE_FLOAT;
+    (void)dt_dev_pixelpipe_cache_get(pipe->active_cache, basichash, hash,
+                                     src_bpp * roi_out->width * roi_out->height, output, out_format);
+    _pixelpipe_crop_patch_source(&pipe->patch_source, *output, roi_out, src_bpp);
+
+    if(!modules) return 0;
+    goto post_process_collect_info;
+  }
+
   // 2) if history changed or exit event, abort processing?
   // preview pipe: abort on all but zoom events (same buffer anyways)
   if(dt_iop_breakpoint(dev, pipe)) return 1;
@@ -1262,7 +1559,7 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
       {
         *output = pipe->input;
       }
-      else if(dt_dev_pixelpipe_cache_get(&(pipe->cache), basichash, hash, bufsize, output, out_format))
+      else if(dt_dev_pixelpipe_cache_get(pipe->active_cache, basichash, hash, bufsize, output, out_format))
       {
         memset(*output, 0, bufsize);
         if(roi_in.scale == 1.0f)
@@ -1314,6 +1611,77 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
     {
       return 1;
     }
+
+    // a run of pointwise modules ending here is processed in one pass, only its last output goes to the cache
+    GList *run_modules = NULL, *run_pieces = NULL;
+    int run_pos = pos;
+    const int run_length
+        = _pixelpipe_pointwise_run(pipe, dev, roi_out, modules, pieces, pos, &run_modules, &run_pieces, &run_pos);
+    if(run_length > 1)
+    {
+      dt_iop_buffer_dsc_t _input_format = { 0 };
+      dt_iop_buffer_dsc_t *input_format = &_input_format;
+
+      if(dt_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format, roi_out,
+                                      g_list_previous(run_modules), g_list_previous(run_pieces), run_pos - 1))
+        return 1;
+      if(_pixelpipe_expand_half(pipe, &input, &input_format, &_input_format, roi_out)) return 1;
+
+      if(dt_atomic_get_int(&pipe->shutdown))
+      {
+        return 1;
+      }
+      const gboolean store_half = _piece_store_half(pipe, piece, *out_format);
+      (void)dt_dev_pixelpipe_cache_get(pipe->active_cache, basichash, hash, store_half ? bufsize / 2 : bufsize, output,
+                                       out_format);
+      if(store_half) (*out_format)->datatype = TYPE_HALF;
+      if(dt_atomic_get_int(&pipe->shutdown))
+      {
+        return 1;
+      }
+
+      dt_times_t start;
+      dt_get_times(&start);
+
+      const dt_iop_colorspace_type_t cst = module->input_colorspace(module, pipe, piece);
+      const dt_iop_order_iccprofile_info_t *const work_profile = dt_ioppr_get_pipe_work_profile_info(pipe);
+      dt_ioppr_transform_image_colorspace(module, input, input, roi_out->width, roi_out->height,
+                                          input_format->cst, cst, &input_format->cst, work_profile);
+      pipe->dsc = *input_format;
+
+      dt_dev_pixelpipe_iop_t **run = g_new(dt_dev_pixelpipe_iop_t *, run_length);
+      int count = 0;
+      for(GList *p = run_pieces; p && count < run_length; p = g_list_next(p))
+      {
+        dt_dev_pixelpipe_iop_t *run_piece = (dt_dev_pixelpipe_iop_t *)p->data;
+        dt_iop_module_t *run_module = run_piece->module;
+        if(!run_piece->enabled
+           || (dev->gui_module && dev->gui_module->operation_tags_filter() & run_module->operation_tags()))
+          continue;
+
+        run_piece->processed_roi_in = run_piece->processed_roi_out = *roi_out;
+        run_piece->dsc_out = run_piece->dsc_in = pipe->dsc;
+        run_module->output_format(run_module, pipe, run_piece, &run_piece->dsc_out);
+        pipe->dsc = run_piece->dsc_out;
+        if(run_module->process_pointwise_setup) run_module->process_pointwise_setup(run_module, run_piece);
+        pipe->dsc.cst = cst;
+        run_piece->dsc_out = pipe->dsc;
+        run[count++] = run_piece;
+      }
+
+      _pixelpipe_pointwise_pass(run, count, (const float *)input, *output, store_half,
+                                (size_t)roi_out->width * roi_out->height);
+      g_free(run);
+
+      **out_format = pipe->dsc;
+      if(store_half) (*out_format)->datatype = TYPE_HALF;
+
+      dt_show_times_f(&start, "[dev_pixelpipe]", "processed %d pointwise modules up to `%s' on CPU [%s]", count,
+                      module->op, _pipe_type_to_str(pipe->type));
+
+      goto post_process_collect_info;
+    }
+
     module->modify_roi_in(module, piece, roi_out, &roi_in);
 
     // recurse to get actual data of input buffer
@@ -1330,6 +1698,9 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
                                     g_list_previous(modules), g_list_previous(pieces), pos - 1))
       return 1;
 
+    void *const input_line = input;
+    if(_pixelpipe_expand_half(pipe, &input, &input_format, &_input_format, &roi_in)) return 1;
+
     const size_t in_bpp = dt_iop_buffer_dsc_to_bpp(input_format);
 
     piece->dsc_out = piece->dsc_in = *input_format;
@@ -1346,15 +1717,34 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
       return 1;
     }
 
+    // a line kept in half precision is written once the module is done, it works on a float buffer till then
+    const gboolean store_half = _piece_store_half(pipe, piece, *out_format);
+    const size_t line_size = store_half ? bufsize / 2 : bufsize;
+
     gboolean important = FALSE;
     if((pipe->type & DT_DEV_PIXELPIPE_PREVIEW) == DT_DEV_PIXELPIPE_PREVIEW)
       important = (strcmp(module->op, "colorout") == 0);
     else
       important = (strcmp(module->op, "gamma") == 0);
     if(important)
-      (void)dt_dev_pixelpipe_cache_get_important(&(pipe->cache), basichash, hash, bufsize, output, out_format);
+      (void)dt_dev_pixelpipe_cache_get_important(pipe->active_cache, basichash, hash, line_size, output, out_format);
     else
-      (void)dt_dev_pixelpipe_cache_get(&(pipe->cache), basichash, hash, bufsize, output, out_format);
+      (void)dt_dev_pixelpipe_cache_get(pipe->active_cache, basichash, hash, line_size, output, out_format);
+
+    void *half_line = NULL;
+    dt_iop_buffer_dsc_t *half_line_format = NULL;
+    dt_iop_buffer_dsc_t _float_format;
+    if(store_half)
+    {
+      half_line_format = *out_format;
+      half_line_format->datatype = TYPE_HALF;
+      _float_format = *half_line_format;
+      _float_format.datatype = TYPE_FLOAT;
+      *out_format = &_float_format;
+      half_line = *output;
+      *output = _pixelpipe_half_scratch(pipe, 1, bufsize / sizeof(float));
+      if(!*output) return 1;
+    }
 
 // if(module) printf("reserving new buf in cache for module %s %s: %ld buf %p\n", module->op, pipe ==
 // dev->preview_pipe ? "[preview]" : "", hash, *output);
@@ -1984,7 +2374,7 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
       }
 
       /* input is still only on GPU? Let's invalidate CPU input buffer then */
-      if(valid_input_on_gpu_only) dt_dev_pixelpipe_cache_invalidate(&(pipe->cache), input);
+      if(valid_input_on_gpu_only) dt_dev_pixelpipe_cache_invalidate(pipe->active_cache, input);
     }
     else
     {
@@ -2029,11 +2419,20 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe, dt_develop_t *
     // in case we get this buffer from the cache in the future, cache some stuff:
     **out_format = piece->dsc_out = pipe->dsc;
 
+    if(half_line)
+    {
+      _pixelpipe_float_to_half((uint16_t *)half_line, (const float *)*output, bufsize / sizeof(float));
+      *output = half_line;
+      *half_line_format = pipe->dsc;
+      half_line_format->datatype = TYPE_HALF;
+      *out_format = half_line_format;
+    }
+
     if(module == darktable.develop->gui_module)
     {
       // give the input buffer to the currently focused plugin more weight.
       // the user is likely to change that one soon, so keep it in cache.
-      dt_dev_pixelpipe_cache_reweight(&(pipe->cache), input);
+      dt_dev_pixelpipe_cache_reweight(pipe->active_cache, input_line);
     }
 #ifndef _DEBUG
     if(darktable.unmuted & DT_DEBUG_NAN)
@@ -2284,6 +2683,354 @@ static int dt_dev_pixelpipe_process_rec_and_backcopy(dt_dev_pixelpipe_t *pipe, d
 }
 
 
+// a local change of the focused module, recomputed only where it shows
+typedef struct dt_pixelpipe_patch_t
+{
+  dt_iop_roi_t process; // region of the output that is recomputed
+  int paste[4];         // x, y, width, height of the part of it which is exact, relative to the output
+  dt_dev_pixelpipe_patch_source_t source;
+} dt_pixelpipe_patch_t;
+
+// pixels around a change a piece after the changed module needs to give the same output as in the full run,
+// in pixels of the pipe output. -1 if it doesn't tell or its output doesn't only depend on the neighbourhood.
+static int _piece_patch_margin(dt_dev_pixelpipe_iop_t *piece, const dt_iop_roi_t *roi)
+{
+  dt_iop_module_t *module = piece->module;
+  const dt_develop_blend_params_t *const d = (const dt_develop_blend_params_t *)piece->blendop_data;
+  if((piece->request_histogram & DT_REQUEST_ON)
+     || module->raster_mask.sink.source
+     || (module->raster_mask.source.users && g_hash_table_size(module->raster_mask.source.users))
+     || (_transform_for_blend(module, piece) && (d->feathering_radius > 0.0f || d->blur_radius > 0.0f)))
+    return -1;
+
+  int overlap = 0;
+  if(module->process_pointwise || !strcmp(module->op, "gamma"))
+    overlap = 0;
+  else if(piece->process_tiling_ready)
+  {
+    // the overlap tiling needs is exactly the neighbourhood a pixel depends on
+    dt_develop_tiling_t tiling = { 0 };
+    module->tiling_callback(module, piece, &piece->processed_roi_in, &piece->processed_roi_out, &tiling);
+    overlap = tiling.overlap;
+  }
+  else
+    return -1;
+
+  // distorting modules resample their input with the interpolator the user picked, which reads up to its half
+  // kernel width around the mapped position: 1 px for bilinear, 2 for bicubic, 3 for lanczos3
+  int resample = 0;
+  if(module->operation_tags() & IOP_TAG_DISTORT)
+  {
+    const struct dt_interpolation *itor = dt_interpolation_new(DT_INTERPOLATION_USERPREF);
+    const struct dt_interpolation *itor_warp = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
+    resample = MAX(itor->width, itor_warp->width);
+  }
+
+  const float scale = roi->scale / fmaxf(piece->processed_roi_in.scale, 1e-6f);
+  return (int)ceilf((overlap + resample) * scale) + (resample ? 1 : 0);
+}
+
+// find out if the only change since the last complete run of this roi is a local one of the focused module,
+// which can be recomputed from its unchanged input line in the cache. needs pipe->forms of this run.
+static gboolean _pixelpipe_find_patch(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, const dt_iop_roi_t *roi,
+                                      dt_pixelpipe_patch_t *patch)
+{
+  dt_iop_module_t *gui_module = dev->gui_module;
+  if(pipe != dev->pipe || !dev->gui_attached || !gui_module || !gui_module->changed_area
+     || gui_module->request_mask_display || pipe->coarse_width || !pipe->output_backbuf
+     || pipe->output_imgid != pipe->image.id || pipe->processed_gui_module != gui_module
+     || pipe->output_backbuf_width != roi->width || pipe->output_backbuf_height != roi->height
+     || memcmp(&pipe->output_backbuf_roi, roi, sizeof(dt_iop_roi_t)))
+    return FALSE;
+
+  // same as dt_dev_pixelpipe_process_rec() will do, it is part of the hashes
+  if(gui_module->flags() & IOP_FLAGS_ALLOW_FAST_PIPE)
+    pipe->type |= DT_DEV_PIXELPIPE_FAST;
+  else
+    pipe->type &= ~DT_DEV_PIXELPIPE_FAST;
+  if(pipe->type != pipe->processed_type) return FALSE;
+
+  // exactly the focused module changed
+  GList *changed = NULL;
+  int src_pos = 0, pos = 0;
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    pos++;
+    if(piece->hash != piece->processed_hash)
+    {
+      if(changed) return FALSE;
+      changed = nodes;
+    }
+    else if(!changed && piece->enabled && !(gui_module->operation_tags_filter() & piece->module->operation_tags()))
+      src_pos = pos;
+  }
+  if(!changed) return FALSE;
+
+  dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)changed->data;
+  if(piece->module != gui_module || !piece->enabled || !piece->processed_params || !piece->committed_params
+     || memcmp(piece->blendop_data, piece->processed_blendop, sizeof(dt_develop_blend_params_t))
+     || (piece->request_histogram & DT_REQUEST_ON)
+     || (gui_module->raster_mask.source.users && g_hash_table_size(gui_module->raster_mask.source.users)))
+    return FALSE;
+
+  float area[4] = { 0.0f };
+  if(!gui_module->changed_area(gui_module, piece, piece->processed_params, piece->committed_params,
+                               pipe->processed_forms, area))
+    return FALSE;
+
+  // the unchanged input of the changed module, as the last complete run left it in the cache. dsc_in is the
+  // format the module got to see, a line kept in half precision was expanded to float on the way
+  dt_pixelpipe_patch_t p = { .source = { .pos = src_pos, .roi = piece->processed_roi_in, .dsc = piece->dsc_in } };
+  if(src_pos > 0)
+  {
+    const dt_dev_pixelpipe_iop_t *src_piece = (dt_dev_pixelpipe_iop_t *)g_list_nth_data(pipe->nodes, src_pos - 1);
+    if(_piece_store_half(pipe, src_piece, &p.source.dsc)) p.source.dsc.datatype = TYPE_HALF;
+  }
+  uint64_t basichash = 0, hash = 0;
+  dt_dev_pixelpipe_cache_fullhash(pipe->image.id, &p.source.roi, pipe, src_pos, &basichash, &hash);
+  if(!dt_dev_pixelpipe_cache_available(&(pipe->cache), hash)) return FALSE;
+
+  // everything after it has to be local as well
+  int margin = 2;
+  for(GList *nodes = g_list_next(changed); nodes; nodes = g_list_next(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *after = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    if(!after->enabled || (gui_module->operation_tags_filter() & after->module->operation_tags())) continue;
+    const int m = _piece_patch_margin(after, roi);
+    if(m < 0) return FALSE;
+    margin += m;
+  }
+
+  int paste[4] = { 0 };
+  if(area[2] > 0.0f && area[3] > 0.0f)
+  {
+    // map the outline of the changed area through the distortions after the module to the output
+    float pts[32];
+    for(int k = 0; k < 4; k++)
+    {
+      const float t = 0.25f * k;
+      pts[2 * k] = area[0] + t * area[2], pts[2 * k + 1] = area[1];
+      pts[8 + 2 * k] = area[0] + area[2], pts[8 + 2 * k + 1] = area[1] + t * area[3];
+      pts[16 + 2 * k] = area[0] + area[2] - t * area[2], pts[16 + 2 * k + 1] = area[1] + area[3];
+      pts[24 + 2 * k] = area[0], pts[24 + 2 * k + 1] = area[1] + area[3] - t * area[3];
+    }
+    dt_pthread_mutex_lock(&dev->history_mutex);
+    dt_dev_distort_transform_locked(dev, pipe, gui_module->iop_order, DT_DEV_TRANSFORM_DIR_FORW_EXCL, pts, 16);
+    dt_pthread_mutex_unlock(&dev->history_mutex);
+
+    float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+    for(int k = 0; k < 16; k++)
+    {
+      x0 = fminf(x0, pts[2 * k]), x1 = fmaxf(x1, pts[2 * k]);
+      y0 = fminf(y0, pts[2 * k + 1]), y1 = fmaxf(y1, pts[2 * k + 1]);
+    }
+    const int l = floorf(x0 * roi->scale) - roi->x, t = floorf(y0 * roi->scale) - roi->y;
+    const int r = ceilf(x1 * roi->scale) - roi->x, b = ceilf(y1 * roi->scale) - roi->y;
+
+    // pixels within the margin of the change are exact if computed from twice the margin around it
+    paste[0] = MAX(0, l - margin);
+    paste[1] = MAX(0, t - margin);
+    paste[2] = MIN(roi->width, r + margin) - paste[0];
+    paste[3] = MIN(roi->height, b + margin) - paste[1];
+    if(paste[2] > 0 && paste[3] > 0)
+    {
+      const int px = MAX(0, l - 2 * margin), py = MAX(0, t - 2 * margin);
+      p.process = (dt_iop_roi_t){ roi->x + px, roi->y + py, MIN(roi->width, r + 2 * margin) - px,
+                                  MIN(roi->height, b + 2 * margin) - py, roi->scale };
+      memcpy(p.paste, paste, sizeof(paste));
+    }
+  }
+
+  // nothing visible changed
+  if(p.process.width <= 0 || p.process.height <= 0)
+  {
+    *patch = p;
+    return TRUE;
+  }
+
+  // a big change is cheaper to process in one go
+  if((size_t)p.process.width * p.process.height > (size_t)roi->width * roi->height / 2) return FALSE;
+
+  // the patch has to find all the input it needs in the cache line, which depends on the roi
+  // requested from the changed module, the same way dt_dev_pixelpipe_process_rec() will do it
+  dt_iop_roi_t roi_out = p.process, roi_in = p.process;
+  for(GList *nodes = g_list_last(pipe->nodes);; nodes = g_list_previous(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *before = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    if(before->enabled && !(gui_module->operation_tags_filter() & before->module->operation_tags()))
+    {
+      before->module->modify_roi_in(before->module, before, &roi_out, &roi_in);
+      roi_out = roi_in;
+    }
+    if(nodes == changed) break;
+  }
+  if(roi_in.scale != p.source.roi.scale || roi_in.x < p.source.roi.x || roi_in.y < p.source.roi.y
+     || roi_in.x + roi_in.width > p.source.roi.x + p.source.roi.width
+     || roi_in.y + roi_in.height > p.source.roi.y + p.source.roi.height)
+    return FALSE;
+
+  void *buf = NULL;
+  dt_iop_buffer_dsc_t *dsc = &p.source.dsc;
+  (void)dt_dev_pixelpipe_cache_get(&(pipe->cache), basichash, hash,
+                                   dt_iop_buffer_dsc_to_bpp(dsc) * p.source.roi.width * p.source.roi.height, &buf,
+                                   &dsc);
+  // the line has to be the one the size was worked out for
+  if(dsc->datatype != p.source.dsc.datatype) return FALSE;
+  p.source.buf = buf;
+  p.source.dsc = *dsc;
+  *patch = p;
+  return TRUE;
+}
+
+// recompute the patch, in the cache lines of the coarse pass so the full resolution ones stay
+static int _pixelpipe_process_patch(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, const dt_pixelpipe_patch_t *patch,
+                                    void **buf, void **cl_mem_out, dt_iop_buffer_dsc_t **out_format,
+                                    GList *modules, GList *pieces, const int pos)
+{
+  if(patch->process.width <= 0 || patch->process.height <= 0) return 0;
+
+  // the rois of the complete run are needed to find the next patch
+  const int count = g_list_length(pipe->nodes);
+  dt_iop_roi_t *rois = g_new(dt_iop_roi_t, 2 * count);
+  int k = 0;
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes), k++)
+  {
+    const dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    rois[2 * k] = piece->processed_roi_in;
+    rois[2 * k + 1] = piece->processed_roi_out;
+  }
+
+  pipe->active_cache = &pipe->coarse_cache;
+  pipe->patch_source = patch->source;
+
+  const int err = dt_dev_pixelpipe_process_rec_and_backcopy(pipe, dev, buf, cl_mem_out, out_format,
+                                                            &patch->process, modules, pieces, pos);
+
+  pipe->patch_source.buf = NULL;
+  pipe->active_cache = &pipe->cache;
+
+  k = 0;
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes), k++)
+  {
+    dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    piece->processed_roi_in = rois[2 * k];
+    piece->processed_roi_out = rois[2 * k + 1];
+  }
+  g_free(rois);
+  return err;
+}
+
+// copy the exact part of a processed patch to the output buffer, with the backbuf mutex locked
+static void _pixelpipe_paste_patch(dt_dev_pixelpipe_t *pipe, const dt_pixelpipe_patch_t *patch,
+                                   const uint8_t *const buf)
+{
+  if(!buf || !pipe->output_backbuf || patch->paste[2] <= 0 || patch->paste[3] <= 0) return;
+  const int dx = patch->paste[0] - (patch->process.x - pipe->output_backbuf_roi.x);
+  const int dy = patch->paste[1] - (patch->process.y - pipe->output_backbuf_roi.y);
+  for(int j = 0; j < patch->paste[3]; j++)
+    memcpy(pipe->output_backbuf
+               + (size_t)4 * ((size_t)(patch->paste[1] + j) * pipe->output_backbuf_width + patch->paste[0]),
+           buf + (size_t)4 * ((size_t)(dy + j) * patch->process.width + dx), (size_t)4 * patch->paste[2]);
+}
+
+// report the pixels of the output buffer, with a patch pasted, which differ from the complete run in full
+static void _pixelpipe_verify_patch(dt_dev_pixelpipe_t *pipe, const dt_pixelpipe_patch_t *patch,
+                                    const uint8_t *const full)
+{
+  if(!pipe->output_backbuf) return;
+  const int width = pipe->output_backbuf_width, height = pipe->output_backbuf_height;
+  size_t wrong = 0;
+  int x0 = width, y0 = height, x1 = -1, y1 = -1;
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      const size_t k = (size_t)4 * ((size_t)j * width + i);
+      if(!memcmp(pipe->output_backbuf + k, full + k, 3)) continue;
+      wrong++;
+      x0 = MIN(x0, i), x1 = MAX(x1, i), y0 = MIN(y0, j), y1 = MAX(y1, j);
+    }
+  if(wrong)
+    fprintf(stderr,
+            "[pixelpipe_process] local change of `%s' differs from the complete run in %zu pixels within "
+            "(%d,%d)-(%d,%d), patch pasted at (%d,%d) %dx%d\n",
+            pipe->processed_gui_module ? pipe->processed_gui_module->op : "?", wrong, x0, y0, x1, y1,
+            patch->paste[0], patch->paste[1], patch->paste[2], patch->paste[3]);
+  else
+    dt_print(DT_DEBUG_DEV, "[pixelpipe_process] local change is the same as the complete run\n");
+}
+
+// remember what the output buffer shows now, for _pixelpipe_find_patch()
+static void _pixelpipe_remember_run(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, const dt_iop_roi_t *roi)
+{
+  for(GList *nodes = pipe->nodes; nodes; nodes = g_list_next(nodes))
+  {
+    dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)nodes->data;
+    piece->processed_hash = piece->hash;
+    if(piece->committed_params)
+    {
+      if(!piece->processed_params) piece->processed_params = malloc(piece->module->params_size);
+      if(!piece->processed_blendop) piece->processed_blendop = malloc(sizeof(dt_develop_blend_params_t));
+      memcpy(piece->processed_params, piece->committed_params, piece->module->params_size);
+      memcpy(piece->processed_blendop, piece->blendop_data, sizeof(dt_develop_blend_params_t));
+    }
+  }
+  pipe->processed_gui_module = dev->gui_module;
+  pipe->processed_type = pipe->type;
+  pipe->output_backbuf_roi = *roi;
+}
+
+gboolean dt_dev_pixelpipe_local_change(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, int x, int y, int width,
+                                       int height, float scale)
+{
+  const dt_iop_roi_t roi = (dt_iop_roi_t){ x, y, width, height, scale };
+  GList *forms = pipe->forms;
+  pipe->forms = dt_masks_dup_forms_deep(dev->forms, NULL);
+  dt_pixelpipe_patch_t patch;
+  const gboolean local = _pixelpipe_find_patch(pipe, dev, &roi, &patch);
+  g_list_free_full(pipe->forms, (void (*)(void *))dt_masks_free_form);
+  pipe->forms = forms;
+  return local;
+}
+
+// bilinear upscaling of an 8 bit BGRA buffer, for showing a coarse pass at full size
+static void _upscale_backbuf(const uint8_t *const in, const int in_width, const int in_height,
+                             uint8_t *const out, const int out_width, const int out_height)
+{
+  const float sx = (float)in_width / out_width;
+  const float sy = (float)in_height / out_height;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) \
+  dt_omp_firstprivate(in, in_width, in_height, out, out_width, out_height, sx, sy) \
+  schedule(static)
+#endif
+  for(int j = 0; j < out_height; j++)
+  {
+    const float fy = MAX(0.0f, (j + 0.5f) * sy - 0.5f);
+    const int y0 = MIN((int)fy, in_height - 1);
+    const int y1 = MIN(y0 + 1, in_height - 1);
+    const float wy = fy - y0;
+    for(int i = 0; i < out_width; i++)
+    {
+      const float fx = MAX(0.0f, (i + 0.5f) * sx - 0.5f);
+      const int x0 = MIN((int)fx, in_width - 1);
+      const int x1 = MIN(x0 + 1, in_width - 1);
+      const float wx = fx - x0;
+      const uint8_t *const p00 = in + (size_t)4 * ((size_t)y0 * in_width + x0);
+      const uint8_t *const p01 = in + (size_t)4 * ((size_t)y0 * in_width + x1);
+      const uint8_t *const p10 = in + (size_t)4 * ((size_t)y1 * in_width + x0);
+      const uint8_t *const p11 = in + (size_t)4 * ((size_t)y1 * in_width + x1);
+      uint8_t *const o = out + (size_t)4 * ((size_t)j * out_width + i);
+      for(int c = 0; c < 4; c++)
+      {
+        const float top = p00[c] + wx * (p01[c] - p00[c]);
+        const float bottom = p10[c] + wx * (p11[c] - p10[c]);
+        o[c] = (uint8_t)CLAMP(top + wy * (bottom - top) + 0.5f, 0.0f, 255.0f);
+      }
+    }
+  }
+}
+
 int dt_dev_pixelpipe_process(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, int x, int y, int width, int height,
                              float scale)
 {
@@ -2323,6 +3070,8 @@ restart:
   if(pipe->cache_obsolete) dt_dev_pixelpipe_cache_flush(&(pipe->cache));
   pipe->cache_obsolete = 0;
 
+  _pixelpipe_plan_half_buffers(pipe, dev);
+
   // mask display off as a starting point
   pipe->mask_display = DT_DEV_PIXELPIPE_DISPLAY_NONE;
   // and blendif active
@@ -2334,10 +3083,28 @@ restart:
   dt_iop_buffer_dsc_t _out_format = { 0 };
   dt_iop_buffer_dsc_t *out_format = &_out_format;
 
-  // run pixelpipe recursively and get error status
-  const int err =
-    dt_dev_pixelpipe_process_rec_and_backcopy(pipe, dev, &buf, &cl_mem_out, &out_format, &roi, modules,
-                                              pieces, pos);
+  // run pixelpipe recursively and get error status, only where it changed if that's local
+  dt_pixelpipe_patch_t patch;
+  const gboolean patched = _pixelpipe_find_patch(pipe, dev, &roi, &patch);
+  const int err = patched ? _pixelpipe_process_patch(pipe, dev, &patch, &buf, &cl_mem_out, &out_format, modules,
+                                                     pieces, pos)
+                          : dt_dev_pixelpipe_process_rec_and_backcopy(pipe, dev, &buf, &cl_mem_out, &out_format,
+                                                                      &roi, modules, pieces, pos);
+  if(patched)
+    dt_print(DT_DEBUG_DEV, "[pixelpipe_process] [%s] local change, recomputed %dx%d of %dx%d\n",
+             _pipe_type_to_str(pipe->type), patch.process.width, patch.process.height, width, height);
+
+  // check the patch against what the complete run gives, it has to be the same to the bit
+  void *verify_buf = NULL;
+  if(patched && !err && pipe->verify_patches)
+  {
+    dt_iop_buffer_dsc_t _verify_format = { 0 };
+    dt_iop_buffer_dsc_t *verify_format = &_verify_format;
+    void *verify_cl_mem = NULL;
+    if(dt_dev_pixelpipe_process_rec_and_backcopy(pipe, dev, &verify_buf, &verify_cl_mem, &verify_format, &roi,
+                                                 modules, pieces, pos))
+      verify_buf = NULL;
+  }
 
   // get status summary of opencl queue by checking the eventlist
   const int oclerr = (pipe->devid >= 0) ? (dt_opencl_events_flush(pipe->devid, 1) != 0) : 0;
@@ -2377,12 +3144,17 @@ restart:
     goto restart; // try again (this time without opencl)
   }
 
-  // release resources:
-  if (pipe->forms)
+  // the output has to be floats. a half precision line only shows up here if its module came last by now.
+  if(!err && out_format->datatype == TYPE_HALF)
   {
-    g_list_free_full(pipe->forms, (void (*)(void *))dt_masks_free_form);
-    pipe->forms = NULL;
+    dt_dev_pixelpipe_flush_caches(pipe);
+    goto restart;
   }
+
+  // release resources, the mask snapshot of a complete run is kept to find out what the next change touches:
+  g_list_free_full(err ? pipe->forms : pipe->processed_forms, (void (*)(void *))dt_masks_free_form);
+  if(!err) pipe->processed_forms = pipe->forms;
+  pipe->forms = NULL;
   if(pipe->devid >= 0)
   {
     dt_opencl_unlock_device(pipe->devid);
@@ -2397,27 +3169,49 @@ restart:
 
   // terminate
   dt_pthread_mutex_lock(&pipe->backbuf_mutex);
-  pipe->backbuf_hash = dt_dev_pixelpipe_cache_hash(pipe->image.id, &roi, pipe, 0);
-  pipe->backbuf = buf;
-  pipe->backbuf_width = width;
-  pipe->backbuf_height = height;
-
-  if((pipe->type & DT_DEV_PIXELPIPE_PREVIEW) == DT_DEV_PIXELPIPE_PREVIEW
-     || (pipe->type & DT_DEV_PIXELPIPE_FULL) == DT_DEV_PIXELPIPE_FULL
-     || (pipe->type & DT_DEV_PIXELPIPE_PREVIEW2) == DT_DEV_PIXELPIPE_PREVIEW2)
+  if(patched)
   {
-    if(pipe->output_backbuf == NULL || pipe->output_backbuf_width != pipe->backbuf_width || pipe->output_backbuf_height != pipe->backbuf_height)
+    // backbuf stays the complete run, the patch only goes to the output buffer
+    _pixelpipe_paste_patch(pipe, &patch, buf);
+    if(verify_buf)
     {
-      g_free(pipe->output_backbuf);
-      pipe->output_backbuf_width = pipe->backbuf_width;
-      pipe->output_backbuf_height = pipe->backbuf_height;
-      pipe->output_backbuf = g_malloc0(sizeof(uint8_t) * 4 * pipe->output_backbuf_width * pipe->output_backbuf_height);
+      _pixelpipe_verify_patch(pipe, &patch, verify_buf);
+      // the complete run may have recycled the cache line the old backbuf was in
+      pipe->backbuf_hash = dt_dev_pixelpipe_cache_hash(pipe->image.id, &roi, pipe, 0);
+      pipe->backbuf = verify_buf;
     }
+  }
+  else
+  {
+    pipe->backbuf_hash = dt_dev_pixelpipe_cache_hash(pipe->image.id, &roi, pipe, 0);
+    pipe->backbuf = buf;
+    pipe->backbuf_width = width;
+    pipe->backbuf_height = height;
+
+    if((pipe->type & DT_DEV_PIXELPIPE_PREVIEW) == DT_DEV_PIXELPIPE_PREVIEW
+       || (pipe->type & DT_DEV_PIXELPIPE_FULL) == DT_DEV_PIXELPIPE_FULL
+       || (pipe->type & DT_DEV_PIXELPIPE_PREVIEW2) == DT_DEV_PIXELPIPE_PREVIEW2)
+    {
+      // the output of a coarse pass is shown at the size of the full one
+      const int output_width = pipe->coarse_width ? pipe->coarse_width : pipe->backbuf_width;
+      const int output_height = pipe->coarse_height ? pipe->coarse_height : pipe->backbuf_height;
+      if(pipe->output_backbuf == NULL || pipe->output_backbuf_width != output_width || pipe->output_backbuf_height != output_height)
+      {
+        g_free(pipe->output_backbuf);
+        pipe->output_backbuf_width = output_width;
+        pipe->output_backbuf_height = output_height;
+        pipe->output_backbuf = g_malloc0(sizeof(uint8_t) * 4 * pipe->output_backbuf_width * pipe->output_backbuf_height);
+      }
 
-    if(pipe->output_backbuf)
-      memcpy(pipe->output_backbuf, pipe->backbuf, sizeof(uint8_t) * 4 * pipe->output_backbuf_width * pipe->output_backbuf_height);
-    pipe->output_imgid = pipe->image.id;
+      if(pipe->output_backbuf && pipe->coarse_width)
+        _upscale_backbuf(pipe->backbuf, pipe->backbuf_width, pipe->backbuf_height, pipe->output_backbuf,
+                         pipe->output_backbuf_width, pipe->output_backbuf_height);
+      else if(pipe->output_backbuf)
+        memcpy(pipe->output_backbuf, pipe->backbuf, sizeof(uint8_t) * 4 * pipe->output_backbuf_width * pipe->output_backbuf_height);
+      pipe->output_imgid = pipe->image.id;
+    }
   }
+  _pixelpipe_remember_run(pipe, dev, &roi);
   dt_pthread_mutex_unlock(&pipe->backbuf_mutex);
 
   // printf("pixelpipe homebrew process end\n");
@@ -2425,9 +3219,29 @@ restart:
   return 0;
 }
 
+int dt_dev_pixelpipe_process_coarse(dt_dev_pixelpipe_t *pipe, dt_develop_t *dev, int x, int y, int width,
+                                    int height, float scale, float fraction)
+{
+  // an obsolete cache is flushed by the next run, which has to hit the full resolution lines too
+  if(pipe->cache_obsolete) dt_dev_pixelpipe_cache_flush(&(pipe->cache));
+
+  // run in the coarse cache lines, the full resolution ones stay for the refinement
+  pipe->active_cache = &pipe->coarse_cache;
+  pipe->coarse_width = width;
+  pipe->coarse_height = height;
+
+  const int err = dt_dev_pixelpipe_process(pipe, dev, x * fraction, y * fraction, MAX(1, width * fraction),
+                                           MAX(1, height * fraction), scale * fraction);
+
+  pipe->coarse_width = pipe->coarse_height = 0;
+  pipe->active_cache = &pipe->cache;
+  return err;
+}
+
 void dt_dev_pixelpipe_flush_caches(dt_dev_pixelpipe_t *pipe)
 {
   dt_dev_pixelpipe_cache_flush(&pipe->cache);
+  dt_dev_pixelpipe_cache_flush(&pipe->coarse_cache);
 }
 
 void dt_dev_pixelpipe_get_dimensions(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *dev, int width_in,
@@ -70,9 +70,25 @@ typedef struct dt_dev_pixelpipe_iop_t
   // the following are used internally for caching:
   dt_iop_buffer_dsc_t dsc_in, dsc_out;
 
+  // planned per run: keep the output in half precision, see dt_dev_pixelpipe_t::half_buffers
+  gboolean store_half;
+
   GHashTable *raster_masks; // GList* of dt_dev_pixelpipe_raster_mask_t
+
+  // for modules with changed_area(): params as committed, and hash, params and blendop of the last complete run
+  void *committed_params, *processed_params, *processed_blendop;
+  uint64_t processed_hash;
 } dt_dev_pixelpipe_iop_t;
 
+// input line of the changed module a patch of a local change starts from, see dt_dev_pixelpipe_local_change()
+typedef struct dt_dev_pixelpipe_patch_source_t
+{
+  int pos; // position in the pipe the line is the output of
+  const void *buf;
+  dt_iop_roi_t roi;
+  dt_iop_buffer_dsc_t dsc;
+} dt_dev_pixelpipe_patch_source_t;
+
 typedef enum dt_dev_pixelpipe_change_t
 {
   DT_DEV_PIPE_UNCHANGED = 0,        // no event
@@ -97,6 +113,8 @@ typedef struct dt_dev_pixelpipe_t
   int cache_obsolete;
   // input buffer
   float *input;
+  // number of colorspace conversions of a run, as planned on the last synch
+  int colorspace_conversions;
   // width and height of input buffer
   int iwidth, iheight;
   // input actually just downscaled buffer? iscale*iwidth = actual width
@@ -131,10 +149,30 @@ typedef struct dt_dev_pixelpipe_t
   uint8_t *output_backbuf;
   int output_backbuf_width, output_backbuf_height;
   int output_imgid;
+  // size the output buffer is upscaled to during the coarse pass of a progressive render, 0 otherwise
+  int coarse_width, coarse_height;
+  // cache lines of coarse passes, kept apart so they don't push out the full resolution ones
+  dt_dev_pixelpipe_cache_t coarse_cache;
+  // the lines the running pass reads and writes, cache or coarse_cache. only the processing thread switches it,
+  // so the gui thread can flush cache at any time without the two being swapped under its feet
+  dt_dev_pixelpipe_cache_t *active_cache;
+  // state of the last complete run, to recompute only what a local change of the focused module touches
+  dt_iop_roi_t output_backbuf_roi;
+  GList *processed_forms;
+  struct dt_iop_module_t *processed_gui_module;
+  dt_dev_pixelpipe_type_t processed_type;
+  dt_dev_pixelpipe_patch_source_t patch_source;
+  // recompute the complete output after every patch and report where they differ? for debugging
+  int verify_patches;
   // working?
   int processing;
   // shutting down?
   dt_atomic_int shutdown;
+  // keep 4 channel float buffers in half precision on the cpu path? see pixelpipe_half_precision_buffers
+  int half_buffers;
+  // what the modules process from and into while the lines of the cache are in half precision
+  float *half_scratch[2];
+  size_t half_scratch_size[2];
   // opencl enabled for this pixelpipe?
   int opencl_enabled;
   // opencl error detected?
@@ -218,6 +256,14 @@ void dt_dev_pixelpipe_synch_top(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *d
 // process region of interest of pixels. returns 1 if pipe was altered during processing.
 int dt_dev_pixelpipe_process(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *dev, int x, int y, int width,
                              int height, float scale);
+// process a coarse version of the region at fraction of the scale and upscale it to width x height for display.
+// uses its own cache lines. returns 1 if pipe was altered during processing.
+int dt_dev_pixelpipe_process_coarse(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *dev, int x, int y,
+                                    int width, int height, float scale, float fraction);
+// whether the next run of the region only needs to recompute the area a local change of the focused module
+// touches, see changed_area() in iop_api.h. dt_dev_pixelpipe_process() then does so by itself.
+gboolean dt_dev_pixelpipe_local_change(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *dev, int x, int y,
+                                       int width, int height, float scale);
 // convenience method that does not gamma-compress the image.
 int dt_dev_pixelpipe_process_no_gamma(dt_dev_pixelpipe_t *pipe, struct dt_develop_t *dev, int x, int y,
                                       int width, int height, float scale);
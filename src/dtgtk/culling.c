@@ -1038,25 +1038,14 @@ void dt_culling_init(dt_culling_t *table, int offset)
   table->offset_imgid = first_id;
 }
 
-static void _thumbs_prefetch(dt_culling_t *table)
+// request the mipmaps of the images before and after the ones shown.
+// prefetch jobs go on a stack, so the images are requested from the farthest to the closest
+// one: the closest are processed first and the farthest are dropped first if the user jumps.
+static void _thumbs_prefetch_direction(const dt_culling_t *table, const int imgid, const gboolean forward,
+                                       const int count, const dt_mipmap_size_t mip)
 {
-  if(!table->list) return;
-
-  // get the mip level by using the max image size actually shown
-  int maxw = 0;
-  int maxh = 0;
-  for(GList *l = table->list; l; l = g_list_next(l))
-  {
-    dt_thumbnail_t *th = (dt_thumbnail_t *)l->data;
-    maxw = MAX(maxw, th->width);
-    maxh = MAX(maxh, th->height);
-  }
-  dt_mipmap_size_t mip = dt_mipmap_cache_get_matching_size(darktable.mipmap_cache, maxw, maxh);
-
-  // prefetch next image
   gchar *query;
   sqlite3_stmt *stmt;
-  dt_thumbnail_t *last = (dt_thumbnail_t *)g_list_last(table->list)->data;
   if(table->navigate_inside_selection)
   {
     query
@@ -1064,10 +1053,10 @@ static void _thumbs_prefetch(dt_culling_t *table)
                           "SELECT m.imgid "
                           "FROM memory.collected_images AS m, main.selected_images AS s "
                           "WHERE m.imgid = s.imgid"
-                          " AND m.rowid > (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
-                          "ORDER BY m.rowid "
-                          "LIMIT 1",
-                          last->imgid);
+                          " AND m.rowid %s (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
+                          "ORDER BY m.rowid %s "
+                          "LIMIT %d",
+                          forward ? ">" : "<", imgid, forward ? "" : "DESC", count);
   }
   else
   {
@@ -1075,52 +1064,51 @@ static void _thumbs_prefetch(dt_culling_t *table)
         = dt_util_dstrcat(NULL,
                           "SELECT m.imgid "
                           "FROM memory.collected_images AS m "
-                          "WHERE m.rowid > (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
-                          "ORDER BY m.rowid "
-                          "LIMIT 1",
-                          last->imgid);
+                          "WHERE m.rowid %s (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
+                          "ORDER BY m.rowid %s "
+                          "LIMIT %d",
+                          forward ? ">" : "<", imgid, forward ? "" : "DESC", count);
   }
+  GList *ids = NULL;
   DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  if(sqlite3_step(stmt) == SQLITE_ROW)
+  while(sqlite3_step(stmt) == SQLITE_ROW)
   {
     const int id = sqlite3_column_int(stmt, 0);
-    if(id > 0) dt_mipmap_cache_get(darktable.mipmap_cache, NULL, id, mip, DT_MIPMAP_PREFETCH, 'r');
+    if(id > 0) ids = g_list_prepend(ids, GINT_TO_POINTER(id));
   }
   sqlite3_finalize(stmt);
   g_free(query);
 
-  // prefetch previous image
-  dt_thumbnail_t *prev = (dt_thumbnail_t *)(table->list)->data;
-  if(table->navigate_inside_selection)
-  {
-    query
-        = dt_util_dstrcat(NULL,
-                          "SELECT m.imgid "
-                          "FROM memory.collected_images AS m, main.selected_images AS s "
-                          "WHERE m.imgid = s.imgid"
-                          " AND m.rowid < (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
-                          "ORDER BY m.rowid DESC "
-                          "LIMIT 1",
-                          prev->imgid);
-  }
-  else
-  {
-    query
-        = dt_util_dstrcat(NULL,
-                          "SELECT m.imgid "
-                          "FROM memory.collected_images AS m "
-                          "WHERE m.rowid < (SELECT mm.rowid FROM memory.collected_images AS mm WHERE mm.imgid=%d) "
-                          "ORDER BY m.rowid DESC "
-                          "LIMIT 1",
-                          prev->imgid);
-  }
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  if(sqlite3_step(stmt) == SQLITE_ROW)
+  // ids is in reverse order, the farthest image comes first
+  for(GList *l = ids; l; l = g_list_next(l))
+    dt_mipmap_cache_get(darktable.mipmap_cache, NULL, GPOINTER_TO_INT(l->data), mip, DT_MIPMAP_PREFETCH, 'r');
+  g_list_free(ids);
+}
+
+static void _thumbs_prefetch(dt_culling_t *table)
+{
+  if(!table->list) return;
+
+  // get the mip level by using the max image size actually shown
+  int maxw = 0;
+  int maxh = 0;
+  for(GList *l = table->list; l; l = g_list_next(l))
   {
-    const int id = sqlite3_column_int(stmt, 0);
-    if(id > 0) dt_mipmap_cache_get(darktable.mipmap_cache, NULL, id, mip, DT_MIPMAP_PREFETCH, 'r');
+    dt_thumbnail_t *th = (dt_thumbnail_t *)l->data;
+    maxw = MAX(maxw, th->width);
+    maxh = MAX(maxh, th->height);
   }
-  sqlite3_finalize(stmt);
+  dt_mipmap_size_t mip = dt_mipmap_cache_get_matching_size(darktable.mipmap_cache, maxw, maxh);
+
+  // number of images prefetched in each direction
+  const int count = CLAMP(dt_conf_get_int("plugins/lighttable/culling_lookahead"), 1, 8);
+
+  // prefetch previous images, then next images so that they end up on top of the stack
+  dt_thumbnail_t *prev = (dt_thumbnail_t *)(table->list)->data;
+  _thumbs_prefetch_direction(table, prev->imgid, FALSE, count, mip);
+
+  dt_thumbnail_t *last = (dt_thumbnail_t *)g_list_last(table->list)->data;
+  _thumbs_prefetch_direction(table, last->imgid, TRUE, count, mip);
 }
 
 static gboolean _thumbs_recreate_list_at(dt_culling_t *table, const int offset)
@@ -219,14 +219,13 @@ static int _thumb_get_imgid(int rowid)
 {
   int id = -1;
   sqlite3_stmt *stmt;
-  gchar *query = dt_util_dstrcat(NULL, "SELECT imgid FROM memory.collected_images WHERE rowid=%d", rowid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT imgid FROM memory.collected_images WHERE rowid=?1", &stmt);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rowid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     id = sqlite3_column_int(stmt, 0);
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   return id;
 }
 // get rowid from imgid
@@ -234,17 +233,35 @@ static int _thumb_get_rowid(int imgid)
 {
   int id = -1;
   sqlite3_stmt *stmt;
-  gchar *query = dt_util_dstrcat(NULL, "SELECT rowid FROM memory.collected_images WHERE imgid=%d", imgid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT rowid FROM memory.collected_images WHERE imgid=?1", &stmt);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     id = sqlite3_column_int(stmt, 0);
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
   return id;
 }
 
+// load the image structs of the thumbs we are about to create with one query instead of one per thumb
+static void _thumbs_prefetch_images(const int rowid, const int count)
+{
+  if(count <= 0) return;
+  GList *imgs = NULL;
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db,
+                                  "SELECT imgid FROM memory.collected_images"
+                                  " WHERE rowid >= ?1 ORDER BY rowid LIMIT ?2",
+                                  &stmt);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rowid);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, count);
+  while(sqlite3_step(stmt) == SQLITE_ROW) imgs = g_list_prepend(imgs, GINT_TO_POINTER(sqlite3_column_int(stmt, 0)));
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
+
+  dt_image_cache_prefetch(darktable.image_cache, imgs);
+  g_list_free(imgs);
+}
+
 // get the coordinate of the rectangular area used by all the loaded thumbs
 static void _pos_compute_area(dt_thumbtable_t *table)
 {
@@ -404,10 +421,9 @@ static gboolean _thumbtable_update_scrollbars(dt_thumbtable_t *table)
   // get the total number of images
   int nbid = 1;
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT COUNT(*) FROM memory.collected_images", -1,
-                              &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT COUNT(*) FROM memory.collected_images", &stmt);
   if(sqlite3_step(stmt) == SQLITE_ROW) nbid = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 
   // the number of line before
   int lbefore = (table->offset - 1) / table->thumbs_per_row;
@@ -509,6 +525,9 @@ static int _thumbs_load_needed(dt_thumbtable_t *table)
     int space = first->y;
     if(table->mode == DT_THUMBTABLE_MODE_FILMSTRIP) space = first->x;
     const int nb_to_load = space / table->thumb_size + (space % table->thumb_size != 0);
+    // the rows we load now and one page further up
+    const int nb_prefetch = (nb_to_load + table->rows) * table->thumbs_per_row;
+    _thumbs_prefetch_images(MAX(1, first->rowid - nb_prefetch), MIN(nb_prefetch, first->rowid - 1));
     gchar *query = dt_util_dstrcat(
         NULL, "SELECT rowid, imgid FROM memory.collected_images WHERE rowid<%d ORDER BY rowid DESC LIMIT %d",
         first->rowid, nb_to_load * table->thumbs_per_row);
@@ -554,6 +573,8 @@ static int _thumbs_load_needed(dt_thumbtable_t *table)
     int space = table->view_height - (last->y + table->thumb_size);
     if(table->mode == DT_THUMBTABLE_MODE_FILMSTRIP) space = table->view_width - (last->x + table->thumb_size);
     const int nb_to_load = space / table->thumb_size + (space % table->thumb_size != 0);
+    // the rows we load now and one page further down
+    _thumbs_prefetch_images(last->rowid + 1, (nb_to_load + table->rows) * table->thumbs_per_row);
     gchar *query = dt_util_dstrcat(
         NULL, "SELECT rowid, imgid FROM memory.collected_images WHERE rowid>%d ORDER BY rowid LIMIT %d",
         last->rowid, nb_to_load * table->thumbs_per_row);
@@ -631,10 +652,9 @@ static gboolean _move(dt_thumbtable_t *table, const int x, const int y, gboolean
         // special case for zoom == 1 as we don't want any space under last image (the image would have disappear)
         int nbid = 1;
         sqlite3_stmt *stmt;
-        DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT COUNT(*) FROM memory.collected_images",
-                                    -1, &stmt, NULL);
+        DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT COUNT(*) FROM memory.collected_images", &stmt);
         if(sqlite3_step(stmt) == SQLITE_ROW) nbid = sqlite3_column_int(stmt, 0);
-        sqlite3_finalize(stmt);
+        DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
         if(nbid <= last->rowid) return FALSE;
       }
       else
@@ -1914,7 +1934,8 @@ void dt_thumbtable_full_redraw(dt_thumbtable_t *table, gboolean force)
       }
     }
 
-    // we add the thumbs
+    // we add the thumbs, their image structs and the next page ones are loaded first
+    _thumbs_prefetch_images(offset, 2 * table->rows * table->thumbs_per_row);
     GList *newlist = NULL;
     int nbnew = 0;
     gchar *query
@@ -2628,10 +2649,9 @@ static gboolean _filemanager_key_move(dt_thumbtable_t *table, dt_thumbtable_move
   // last rowid of the current collection
   int maxrowid = 1;
   sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT MAX(rowid) FROM memory.collected_images", -1,
-                              &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT MAX(rowid) FROM memory.collected_images", &stmt);
   if(sqlite3_step(stmt) == SQLITE_ROW) maxrowid = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
+  DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
 
   // classic keys
   if(move == DT_THUMBTABLE_MOVE_LEFT && baserowid > 1)
@@ -2706,10 +2726,9 @@ static gboolean _zoomable_key_move(dt_thumbtable_t *table, dt_thumbtable_move_t
   {
     int maxrowid = 1;
     sqlite3_stmt *stmt;
-    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), "SELECT MAX(rowid) FROM memory.collected_images",
-                                -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_PREPARE_CACHED(darktable.db, "SELECT MAX(rowid) FROM memory.collected_images", &stmt);
     if(sqlite3_step(stmt) == SQLITE_ROW) maxrowid = sqlite3_column_int(stmt, 0);
-    sqlite3_finalize(stmt);
+    DT_DEBUG_SQLITE3_RELEASE(darktable.db, stmt);
     moved = _zoomable_ensure_rowid_visibility(table, maxrowid);
   }
   else if(move == DT_THUMBTABLE_MOVE_ALIGN)
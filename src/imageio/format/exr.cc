@@ -104,7 +104,12 @@ int write_image(dt_imageio_module_data_t *tmp, const char *filename, const void
 {
   const dt_imageio_exr_t *exr = (dt_imageio_exr_t *)tmp;
 
-  Imf::setGlobalThreadCount(dt_get_num_threads());
+  // the tiles are compressed by the openexr thread pool. it's shared by all exports, so only resize it when
+  // the setting changed. openexr always used all cores, the default of the setting only keeps png and tiff
+  // single threaded.
+  const int threads = dt_conf_is_default("export_encoder_threads") ? dt_get_num_threads()
+                                                                   : dt_imageio_encoder_threads();
+  if(Imf::globalThreadCount() != threads) Imf::setGlobalThreadCount(threads);
 
   Imf::Blob exif_blob(exif_len, (uint8_t *)exif);
 
@@ -117,6 +117,192 @@ static void PNGwriteRawProfile(png_struct *ping, png_info *ping_info, char *prof
   png_free(ping, text);
 }
 
+static inline int _paeth(const int a, const int b, const int c)
+{
+  const int p = a + b - c;
+  const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// filter one packed row with the png filter that leaves the smallest sum of absolute values, like libpng's
+// default heuristic does. out gets the filter type byte followed by the filtered row.
+static void _filter_row(const uint8_t *row, const uint8_t *prev, uint8_t *out, uint8_t *tmp, const size_t rowbytes,
+                        const size_t bpp)
+{
+  uint64_t best_sum = UINT64_MAX;
+  for(int type = 0; type < 5; type++)
+  {
+    uint64_t sum = 0;
+    for(size_t k = 0; k < rowbytes; k++)
+    {
+      const int a = k >= bpp ? row[k - bpp] : 0;
+      const int b = prev ? prev[k] : 0;
+      const int c = (prev && k >= bpp) ? prev[k - bpp] : 0;
+      const int pred = type == 0 ? 0 : type == 1 ? a : type == 2 ? b : type == 3 ? (a + b) / 2 : _paeth(a, b, c);
+      const uint8_t v = row[k] - pred;
+      tmp[k] = v;
+      sum += abs((int8_t)v);
+    }
+    if(sum < best_sum)
+    {
+      best_sum = sum;
+      out[0] = type;
+      memcpy(out + 1, tmp, rowbytes);
+    }
+  }
+}
+
+static int _write_chunk(FILE *f, const char *type, const uint8_t *data, const size_t length)
+{
+  const uint8_t header[8] = { length >> 24, length >> 16, length >> 8, length, type[0], type[1], type[2], type[3] };
+  uLong crc = crc32(0L, (const Bytef *)type, 4);
+  if(length) crc = crc32(crc, data, length);
+  const uint8_t trailer[4] = { crc >> 24, crc >> 16, crc >> 8, crc };
+  return fwrite(header, 1, 8, f) != 8 || (length && fwrite(data, 1, length, f) != length)
+         || fwrite(trailer, 1, 4, f) != 4;
+}
+
+// filter and deflate blocks of rows on several threads and write them as IDAT chunks, followed by IEND. every
+// block is a raw deflate stream primed with the tail of the previous block and ended by a sync flush, so that
+// together with the zlib header and the combined adler32 they form one zlib stream, as in pigz.
+static int _write_idat_parallel(FILE *f, const dt_imageio_png_t *p, const void *ivoid, const int threads)
+{
+  const int width = p->global.width, height = p->global.height;
+  const size_t sample = p->bpp > 8 ? 2 : 1;
+  const size_t bpp = 3 * sample;
+  const size_t rowbytes = bpp * width;
+  const size_t dict_size = 32768;
+  // blocks of about 512k, so that the sync flushes and the lost matches across blocks don't matter
+  const int rows_per_block = MAX(1, (int)((512 << 10) / (rowbytes + 1)));
+  const int blocks = (height + rows_per_block - 1) / rows_per_block;
+  const size_t block_size = (rowbytes + 1) * rows_per_block;
+  const size_t bound = compressBound(block_size) + 16;
+  const int batch = threads * 4;
+
+  uint8_t *filtered = dt_alloc_align(64, block_size * batch);
+  uint8_t *comp = dt_alloc_align(64, bound * batch);
+  uint8_t *rows = dt_alloc_align(64, 3 * rowbytes * threads);
+  uint8_t *dict = dt_alloc_align(64, dict_size);
+  size_t *comp_len = malloc(sizeof(size_t) * batch);
+  uLong *adler = malloc(sizeof(uLong) * batch);
+  size_t dict_len = 0;
+  uLong adler_all = adler32(0L, Z_NULL, 0);
+  int rc = (!filtered || !comp || !rows || !dict || !comp_len || !adler);
+
+  // zlib header, window of 32k, no preset dictionary
+  const int level = p->compression;
+  const uint8_t flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+  const uint8_t zheader[2] = { 0x78, (flevel << 6) + 31 - ((0x78 * 256 + (flevel << 6)) % 31) };
+  if(!rc) rc = _write_chunk(f, "IDAT", zheader, 2);
+
+  for(int first = 0; first < blocks && !rc; first += batch)
+  {
+    const int count = MIN(batch, blocks - first);
+    int failed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) num_threads(threads) \
+  dt_omp_firstprivate(ivoid, filtered, rows, adler, first, count, width, height, sample, bpp, rowbytes, \
+                      rows_per_block, block_size) \
+  schedule(dynamic)
+#endif
+    for(int i = 0; i < count; i++)
+    {
+      const int y0 = (first + i) * rows_per_block;
+      const int y1 = MIN(y0 + rows_per_block, height);
+      uint8_t *out = filtered + block_size * i;
+      uint8_t *row = rows + 3 * rowbytes * dt_get_thread_num();
+      uint8_t *prev = row + rowbytes;
+      uint8_t *tmp = row + 2 * rowbytes;
+
+      // pack rgb, 16 bit most significant byte first
+      for(int y = MAX(y0 - 1, 0); y < y1; y++)
+      {
+        uint8_t *packed = (y == y0 - 1) ? prev : row;
+        for(int x = 0; x < width; x++)
+          for(int c = 0; c < 3; c++)
+          {
+            if(sample == 2)
+            {
+              const uint16_t v = ((const uint16_t *)ivoid)[(size_t)4 * ((size_t)y * width + x) + c];
+              packed[6 * x + 2 * c] = v >> 8;
+              packed[6 * x + 2 * c + 1] = v & 0xff;
+            }
+            else
+              packed[3 * x + c] = ((const uint8_t *)ivoid)[(size_t)4 * ((size_t)y * width + x) + c];
+          }
+        if(y < y0) continue;
+        _filter_row(row, y > 0 ? prev : NULL, out + (rowbytes + 1) * (y - y0), tmp, rowbytes, bpp);
+        memcpy(prev, row, rowbytes);
+      }
+      adler[i] = adler32(adler32(0L, Z_NULL, 0), out, (rowbytes + 1) * (y1 - y0));
+    }
+
+    // blocks are primed with the tail of the one before, so all of them have to be filtered first
+#ifdef _OPENMP
+#pragma omp parallel for default(none) num_threads(threads) \
+  dt_omp_firstprivate(filtered, comp, dict, comp_len, first, count, blocks, height, rowbytes, dict_size, \
+                      rows_per_block, block_size, bound, level, dict_len) \
+  schedule(dynamic) reduction(+ : failed)
+#endif
+    for(int i = 0; i < count; i++)
+    {
+      const int y0 = (first + i) * rows_per_block;
+      const size_t length = (rowbytes + 1) * (MIN(y0 + rows_per_block, height) - y0);
+      uint8_t *out = filtered + block_size * i;
+      z_stream zs = { 0 };
+      if(deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      {
+        failed++;
+        continue;
+      }
+      // the tail of the previous block, from this batch or kept from the last one
+      if(i > 0)
+        deflateSetDictionary(&zs, out - MIN(dict_size, block_size), MIN(dict_size, block_size));
+      else if(dict_len)
+        deflateSetDictionary(&zs, dict, dict_len);
+      zs.next_in = out;
+      zs.avail_in = length;
+      zs.next_out = comp + bound * i;
+      zs.avail_out = bound;
+      const int last = (first + i == blocks - 1);
+      if(deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH) != (last ? Z_STREAM_END : Z_OK) || zs.avail_in) failed++;
+      comp_len[i] = bound - zs.avail_out;
+      deflateEnd(&zs);
+    }
+    if(failed)
+    {
+      rc = 1;
+      break;
+    }
+
+    for(int i = 0; i < count && !rc; i++)
+    {
+      const int y0 = (first + i) * rows_per_block;
+      const size_t length = (rowbytes + 1) * (MIN(y0 + rows_per_block, height) - y0);
+      adler_all = adler32_combine(adler_all, adler[i], length);
+      rc = _write_chunk(f, "IDAT", comp + bound * i, comp_len[i]);
+    }
+
+    // only full blocks are followed by another one
+    dict_len = MIN(dict_size, block_size);
+    memcpy(dict, filtered + block_size * (count - 1) + block_size - dict_len, dict_len);
+  }
+
+  if(!rc)
+  {
+    const uint8_t trailer[4] = { adler_all >> 24, adler_all >> 16, adler_all >> 8, adler_all };
+    rc = _write_chunk(f, "IDAT", trailer, 4) || _write_chunk(f, "IEND", NULL, 0);
+  }
+
+  dt_free_align(filtered);
+  dt_free_align(comp);
+  dt_free_align(rows);
+  dt_free_align(dict);
+  free(comp_len);
+  free(adler);
+  return rc;
+}
+
 int write_image(dt_imageio_module_data_t *p_tmp, const char *filename, const void *ivoid,
                 dt_colorspaces_color_profile_type_t over_type, const char *over_filename,
                 void *exif, int exif_len, int imgid, int num, int total, struct dt_dev_pixelpipe_t *pipe,
@@ -195,6 +381,16 @@ int write_image(dt_imageio_module_data_t *p_tmp, const char *filename, const voi
 
   png_write_info(png_ptr, info_ptr);
 
+  const int threads = dt_imageio_encoder_threads();
+  if(threads > 1)
+  {
+    // libpng has written everything up to the image data, which is compressed on several threads instead
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    const int rc = _write_idat_parallel(f, p, ivoid, threads);
+    fclose(f);
+    return rc;
+  }
+
   /*
    * Get rid of filler (OR ALPHA) bytes, pack XRGB/RGBX/ARGB/RGBA into
    * RGB (4 channels -> 3 channels). The second parameter is not used.
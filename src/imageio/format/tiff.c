@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <tiffio.h>
+#include <zlib.h>
 
 // it would be nice to save space by storing the masks as single channel float data,
 // but at least GIMP can't open TIFF files where not all layers have the same format.
@@ -57,6 +58,103 @@ typedef struct dt_imageio_tiff_gui_t
 } dt_imageio_tiff_gui_t;
 
 
+// apply the tiff predictor to one packed row, the way libtiff does it before compressing
+static void _predict_row(uint8_t *row, uint8_t *tmp, const size_t width, const uint16_t layers, const int bpp)
+{
+  const size_t n = width * layers;
+  if(bpp == 32)
+  {
+    // floating point predictor: split the samples into byte planes, most significant first, then difference
+    // the bytes
+    memcpy(tmp, row, n * 4);
+    for(size_t k = 0; k < n; k++)
+      for(int b = 0; b < 4; b++) row[(3 - b) * n + k] = tmp[4 * k + b];
+    for(size_t k = 4 * n - 1; k >= layers; k--) row[k] -= row[k - layers];
+  }
+  else if(bpp == 16)
+  {
+    uint16_t *row16 = (uint16_t *)row;
+    for(size_t k = n - 1; k >= layers; k--) row16[k] -= row16[k - layers];
+  }
+  else
+  {
+    for(size_t k = n - 1; k >= layers; k--) row[k] -= row[k - layers];
+  }
+}
+
+// deflate the strips on several threads and write them in order as raw strips. the result is the same as
+// libtiff's with the compression and predictor tags set above, libtiff just compresses one strip after the other.
+static int _write_strips_parallel(TIFF *tif, const dt_imageio_tiff_t *d, const void *in_void, const uint16_t layers,
+                                  const uint32_t rows_per_strip, const int threads)
+{
+  const int width = d->global.width;
+  const int height = d->global.height;
+  const int bpp = d->bpp;
+  const int level = d->compresslevel;
+  const gboolean predict = (d->compress == 2);
+  const size_t rowsize = (size_t)width * layers * bpp / 8;
+  const size_t strip_size = rowsize * rows_per_strip;
+  const size_t bound = compressBound(strip_size);
+  const int strips = (height + rows_per_strip - 1) / rows_per_strip;
+  // a batch of strips is compressed at once, so that only its compressed data has to be kept
+  const int batch = threads * 8;
+
+  uint8_t *raw = dt_alloc_align(64, strip_size * batch);
+  uint8_t *tmp = dt_alloc_align(64, rowsize * threads);
+  uint8_t *comp = dt_alloc_align(64, bound * batch);
+  uLongf *comp_len = malloc(sizeof(uLongf) * batch);
+  int rc = (!raw || !tmp || !comp || !comp_len);
+
+  for(int first = 0; first < strips && !rc; first += batch)
+  {
+    const int count = MIN(batch, strips - first);
+    int failed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for default(none) num_threads(threads) \
+  dt_omp_firstprivate(in_void, raw, tmp, comp, comp_len, first, count, width, height, bpp, level, predict, \
+                      rowsize, strip_size, bound, layers, rows_per_strip) \
+  schedule(dynamic) reduction(+ : failed)
+#endif
+    for(int i = 0; i < count; i++)
+    {
+      const int y0 = (first + i) * rows_per_strip;
+      const int rows = MIN((int)rows_per_strip, height - y0);
+      uint8_t *strip = raw + strip_size * i;
+      uint8_t *scratch = tmp + rowsize * dt_get_thread_num();
+      const size_t sample = bpp / 8;
+      for(int r = 0; r < rows; r++)
+      {
+        const uint8_t *in = (const uint8_t *)in_void + (size_t)4 * sample * (y0 + r) * width;
+        uint8_t *out = strip + rowsize * r;
+        for(int x = 0; x < width; x++, in += 4 * sample, out += layers * sample) memcpy(out, in, layers * sample);
+        if(predict) _predict_row(strip + rowsize * r, scratch, width, layers, bpp);
+      }
+      comp_len[i] = bound;
+      if(compress2(comp + bound * i, &comp_len[i], strip, rowsize * rows, level) != Z_OK) failed++;
+    }
+    if(failed)
+    {
+      rc = 1;
+      break;
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+      if(TIFFWriteRawStrip(tif, first + i, comp + bound * i, comp_len[i]) == -1)
+      {
+        rc = 1;
+        break;
+      }
+    }
+  }
+
+  dt_free_align(raw);
+  dt_free_align(tmp);
+  dt_free_align(comp);
+  free(comp_len);
+  return rc;
+}
+
 int write_image(dt_imageio_module_data_t *d_tmp, const char *filename, const void *in_void,
                 dt_colorspaces_color_profile_type_t over_type, const char *over_filename,
                 void *exif, int exif_len, int imgid, int num, int total, dt_dev_pixelpipe_t *pipe,
@@ -239,7 +337,8 @@ int write_image(dt_imageio_module_data_t *d_tmp, const char *filename, const voi
 
   TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
   TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-  TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tif, 0));
+  const uint32_t rows_per_strip = TIFFDefaultStripSize(tif, 0);
+  TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rows_per_strip);
 
   const int resolution = dt_conf_get_int("metadata/resolution");
   TIFFSetField(tif, TIFFTAG_XRESOLUTION, (float)resolution);
@@ -253,7 +352,16 @@ int write_image(dt_imageio_module_data_t *d_tmp, const char *filename, const voi
     goto exit;
   }
 
-  if(d->bpp == 32)
+  const int threads = dt_imageio_encoder_threads();
+  if(d->compress > 0 && threads > 1 && G_BYTE_ORDER == G_LITTLE_ENDIAN)
+  {
+    if(_write_strips_parallel(tif, d, in_void, layers, rows_per_strip, threads))
+    {
+      rc = 1;
+      goto exit;
+    }
+  }
+  else if(d->bpp == 32)
   {
     for(int y = 0; y < d->global.height; y++)
     {
@@ -345,6 +345,12 @@ try_again:
   return 0;
 }
 
+gboolean deferred_write(dt_imageio_module_storage_t *self, dt_imageio_module_data_t *data)
+{
+  // the file is done with once it has been written
+  return TRUE;
+}
+
 size_t params_size(dt_imageio_module_storage_t *self)
 {
   return sizeof(dt_imageio_disk_t) - sizeof(void *);
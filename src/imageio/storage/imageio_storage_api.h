@@ -71,6 +71,9 @@ REQUIRED(int, store, struct dt_imageio_module_storage_t *self, struct dt_imageio
                      const int total, const gboolean high_quality, const gboolean upscale, const gboolean export_masks,
                      const enum dt_colorspaces_color_profile_type_t icc_type, const gchar *icc_filename,
                      enum dt_iop_color_intent_t icc_intent, struct dt_export_metadata_t *metadata);
+/* whether the file of an image isn't used by the storage any more once store() returns, so that encoding
+   and writing it may go on in the background while the next image is processed. */
+OPTIONAL(gboolean, deferred_write, struct dt_imageio_module_storage_t *self, struct dt_imageio_module_data_t *data);
 /* called once at the end (after exporting all images), if implemented. */
 OPTIONAL(void, finalize_store, struct dt_imageio_module_storage_t *self, struct dt_imageio_module_data_t *data);
 
@@ -259,6 +259,7 @@ void tiling_callback(struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t
     const int rad = MIN(roi_in->width, ceilf(256 * roi_in->scale / piece->iscale));
 
     tiling->factor = 2.0f + (float)local_laplacian_memory_use(width, height) / basebuffer;
+    tiling->factor_cl = 2.0f + (float)local_laplacian_memory_use_cl(width, height) / basebuffer;
     tiling->maxbuf
         = fmax(1.0f, (float)local_laplacian_singlebuffer_size(width, height) / basebuffer);
     tiling->overhead = 0;
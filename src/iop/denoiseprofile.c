@@ -270,6 +270,32 @@ typedef struct dt_iop_denoiseprofile_gui_data_t
   GtkWidget *use_new_vst;
 } dt_iop_denoiseprofile_gui_data_t;
 
+// everything the variance stabilized wavelet decomposition depends on, apart from the input itself
+typedef struct dt_iop_denoiseprofile_wavelet_key_t
+{
+  int width, height, max_scale;
+  gboolean use_new_vst;
+  dt_iop_denoiseprofile_wavelet_mode_t wavelet_color_mode;
+  eaw_dn_decompose_t decompose;
+  float compensate_p;
+  float aa[4], bb[4], p[4], wb[4];
+  float toY0U0V0[3][4];
+} dt_iop_denoiseprofile_wavelet_key_t;
+
+// decomposed wavelet bands of the last input, kept per piece of the interactive pipes so that
+// changing only the per-band thresholds just needs to redo the shrinkage and synthesis.
+typedef struct dt_iop_denoiseprofile_wavelet_cache_t
+{
+  gboolean valid;
+  uint64_t hash; // hash of the module input, including the roi
+  dt_iop_denoiseprofile_wavelet_key_t key;
+  size_t npixels;
+  int nbands; // number of allocated detail buffers
+  float *detail[DT_IOP_DENOISE_PROFILE_BANDS];
+  float *coarse;
+  float sum_y2[DT_IOP_DENOISE_PROFILE_BANDS][4];
+} dt_iop_denoiseprofile_wavelet_cache_t;
+
 typedef struct dt_iop_denoiseprofile_data_t
 {
   float radius;                      // patch radius
@@ -289,6 +315,7 @@ typedef struct dt_iop_denoiseprofile_data_t
   gboolean fix_anscombe_and_nlmeans_norm; // backward compatibility options
   gboolean use_new_vst;                   // backward compatibility options
   dt_iop_denoiseprofile_wavelet_mode_t wavelet_color_mode; // switch between RGB and Y0U0V0 modes.
+  dt_iop_denoiseprofile_wavelet_cache_t *wavelet_cache;    // decomposition of the last input, may be NULL
 } dt_iop_denoiseprofile_data_t;
 
 typedef struct dt_iop_denoiseprofile_global_data_t
@@ -732,6 +759,8 @@ void tiling_callback(struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t
 
     const int max_filter_radius = (1u << max_scale); // 2 * 2^max_scale
 
+    // the wavelet cache of the interactive pipes is only used if the untiled piece fits including the cache,
+    // see get_wavelet_cache(), so it doesn't need to be accounted for here
     tiling->factor = 5.0f; // in + out + precond + tmp + reducebuffer
     tiling->factor_cl = 3.5f + max_scale; // in + out + tmp + reducebuffer + scale buffers
     tiling->maxbuf = 1.0f;
@@ -1209,6 +1238,77 @@ static void variance_stabilizing_xform(float thrs[4], const int scale, const int
     thrs[c] = adjt[c] * sb2 / std_x[c];
 }
 
+static void free_wavelet_cache(dt_iop_denoiseprofile_wavelet_cache_t *cache)
+{
+  if(!cache) return;
+  for(int k = 0; k < cache->nbands; k++) dt_free_align(cache->detail[k]);
+  dt_free_align(cache->coarse);
+  free(cache);
+}
+
+// return the wavelet cache of this piece, set up for the given input and preconditioning.
+// cache->valid tells whether it already holds the decomposition. returns NULL if the decomposition
+// should not be kept around: outside of the interactive pipes, while tiling (every tile would replace the
+// decomposition of the one before), or if the untiled working set including the cache doesn't fit.
+static dt_iop_denoiseprofile_wavelet_cache_t *get_wavelet_cache(struct dt_iop_module_t *self,
+                                                                dt_dev_pixelpipe_iop_t *piece,
+                                                                const dt_iop_roi_t *const roi_in,
+                                                                const dt_iop_denoiseprofile_wavelet_key_t *const key)
+{
+  dt_iop_denoiseprofile_data_t *const d = (dt_iop_denoiseprofile_data_t *)piece->data;
+  const size_t npixels = (size_t)key->width * key->height;
+  // in + out + precond + tmp + the cached detail scales and coarse residue, see tiling_callback()
+  const float factor = 4.0f + key->max_scale + 1;
+
+  if(!self->dev->gui_attached || !(piece->pipe->type & (DT_DEV_PIXELPIPE_FULL | DT_DEV_PIXELPIPE_PREVIEW))
+     || piece->pipe->tiling
+     || !dt_tiling_piece_fits_host_memory(key->width, key->height, 4 * sizeof(float), factor, 0))
+  {
+    free_wavelet_cache(d->wavelet_cache);
+    d->wavelet_cache = NULL;
+    return NULL;
+  }
+
+  // the input hash covers all modules before this one, the image and the roi
+  const int position = g_list_index(piece->pipe->nodes, piece);
+  const uint64_t hash = dt_dev_pixelpipe_cache_hash(piece->pipe->image.id, roi_in, piece->pipe, position);
+
+  dt_iop_denoiseprofile_wavelet_cache_t *cache = d->wavelet_cache;
+  if(cache && cache->valid && cache->hash == hash && !memcmp(&cache->key, key, sizeof(*key)))
+    return cache;
+
+  if(cache && (cache->npixels != npixels || cache->nbands != key->max_scale))
+  {
+    free_wavelet_cache(cache);
+    cache = NULL;
+  }
+  if(!cache)
+  {
+    cache = (dt_iop_denoiseprofile_wavelet_cache_t *)calloc(1, sizeof(dt_iop_denoiseprofile_wavelet_cache_t));
+    d->wavelet_cache = cache;
+    if(!cache) return NULL;
+    cache->npixels = npixels;
+    cache->coarse = dt_alloc_align_float(4 * npixels);
+    gboolean success = cache->coarse != NULL;
+    for(; success && cache->nbands < key->max_scale; cache->nbands++)
+    {
+      cache->detail[cache->nbands] = dt_alloc_align_float(4 * npixels);
+      success = cache->detail[cache->nbands] != NULL;
+    }
+    if(!success)
+    {
+      free_wavelet_cache(cache);
+      d->wavelet_cache = NULL;
+      return NULL;
+    }
+  }
+
+  cache->valid = FALSE;
+  cache->hash = hash;
+  cache->key = *key;
+  return cache;
+}
+
 static void process_wavelets(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece,
                              const void *const ivoid, void *const ovoid, const dt_iop_roi_t *const roi_in,
                              const dt_iop_roi_t *const roi_out, const eaw_dn_decompose_t decompose,
@@ -1252,16 +1352,6 @@ static void process_wavelets(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_
     return;
   }
 
-  float *buf = NULL;
-  float *restrict precond = NULL;
-  float *restrict tmp = NULL;
-
-  if (!dt_iop_alloc_image_buffers(self, roi_in, roi_out, 4, &precond, 4, &tmp, 4, &buf, 0))
-  {
-    dt_iop_copy_image_roi(out, in, piece->colors, roi_in, roi_out, TRUE);
-    return;
-  }
-
   float DT_ALIGNED_PIXEL wb[4];  // the "unused" fourth element enables vectorization
   const float DT_ALIGNED_PIXEL wb_weights[4] = { 2.0f, 1.0f, 2.0f, 0.0f };
   compute_wb_factors(wb,d,piece,wb_weights);
@@ -1295,53 +1385,117 @@ static void process_wavelets(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_
   const float DT_ALIGNED_PIXEL aa[4] = { d->a[1] * wb[0], d->a[1] * wb[1], d->a[1] * wb[2], 0.0f };
   const float DT_ALIGNED_PIXEL bb[4] = { d->b[1] * wb[0], d->b[1] * wb[1], d->b[1] * wb[2], 0.0f };
 
-  if(!d->use_new_vst)
-  {
-    precondition(in, precond, width, height, aa, bb);
-  }
-  else if(d->wavelet_color_mode == MODE_RGB)
+  // the decomposition does not depend on the per-band thresholds, reuse it if we still have it
+  dt_iop_denoiseprofile_wavelet_key_t key;
+  memset(&key, 0, sizeof(key));
+  key.width = width;
+  key.height = height;
+  key.max_scale = max_scale;
+  key.use_new_vst = d->use_new_vst;
+  key.wavelet_color_mode = d->wavelet_color_mode;
+  key.decompose = decompose;
+  key.compensate_p = compensate_p;
+  memcpy(key.aa, aa, sizeof(key.aa));
+  memcpy(key.bb, bb, sizeof(key.bb));
+  memcpy(key.p, p, sizeof(key.p));
+  memcpy(key.wb, wb, sizeof(key.wb));
+  memcpy(key.toY0U0V0, toY0U0V0, sizeof(key.toY0U0V0));
+  dt_iop_denoiseprofile_wavelet_cache_t *const cache = get_wavelet_cache(self, piece, roi_in, &key);
+
+  // clear the output buffer, which will be accumulating all of the detail scales
+  memset(out, 0, sizeof(float) * 4 * npixels);
+
+  if(cache && cache->valid)
   {
-    precondition_v2(in, precond, width, height, d->a[1] * compensate_p, p, d->b[1], wb);
+    for(int scale = 0; scale < max_scale; scale++)
+    {
+      const float DT_ALIGNED_PIXEL boost[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      float DT_ALIGNED_PIXEL thrs[4];
+      variance_stabilizing_xform(thrs, scale, max_scale, npixels, cache->sum_y2[scale], d);
+      synthesize(out, out, cache->detail[scale], thrs, boost, width, height);
+    }
+
+    // add in the final residue
+    const float *const restrict coarse = cache->coarse;
+#ifdef _OPENMP
+#pragma omp simd aligned(coarse, out : 64)
+#endif
+    for (size_t k = 0; k < 4U * npixels; k++)
+      out[k] += coarse[k];
   }
   else
   {
-    precondition_Y0U0V0(in, precond, width, height, d->a[1] * compensate_p, p, d->b[1], toY0U0V0);
-  }
+    float *buf = NULL;
+    float *restrict precond = NULL;
+    float *restrict tmp = NULL;
 
-  debug_dump_PFM(piece,"/tmp/transformed.pfm",precond,width,height,0);
+    // with the cache, the detail scales are decomposed straight into it
+    const gboolean success = cache ? dt_iop_alloc_image_buffers(self, roi_in, roi_out, 4, &precond, 4, &tmp, 0)
+                                   : dt_iop_alloc_image_buffers(self, roi_in, roi_out, 4, &precond, 4, &tmp,
+                                                                4, &buf, 0);
+    if(!success)
+    {
+      dt_iop_copy_image_roi(out, in, piece->colors, roi_in, roi_out, TRUE);
+      return;
+    }
+
+    if(!d->use_new_vst)
+    {
+      precondition(in, precond, width, height, aa, bb);
+    }
+    else if(d->wavelet_color_mode == MODE_RGB)
+    {
+      precondition_v2(in, precond, width, height, d->a[1] * compensate_p, p, d->b[1], wb);
+    }
+    else
+    {
+      precondition_Y0U0V0(in, precond, width, height, d->a[1] * compensate_p, p, d->b[1], toY0U0V0);
+    }
 
-  float *restrict buf1 = precond;
-  float *restrict buf2 = tmp;
+    debug_dump_PFM(piece,"/tmp/transformed.pfm",precond,width,height,0);
 
-  // clear the output buffer, which will be accumulating all of the detail scales
-  memset(out, 0, sizeof(float) * 4 * npixels);
+    float *restrict buf1 = precond;
+    float *restrict buf2 = tmp;
 
-  for(int scale = 0; scale < max_scale; scale++)
-  {
-    const float sigma = 1.0f;
-    const float varf = sqrtf(2.0f + 2.0f * 4.0f * 4.0f + 6.0f * 6.0f) / 16.0f; // about 0.5
-    const float sigma_band = powf(varf, scale) * sigma;
-    float DT_ALIGNED_PIXEL sum_y2[4];
-    decompose(buf2, buf1, buf, sum_y2, scale, 1.0f / (sigma_band * sigma_band), width, height);
-    debug_dump_PFM(piece,"/tmp/coarse_%d.pfm",buf2,width,height,scale);
-    debug_dump_PFM(piece,"/tmp/detail_%d.pfm",buf,width,height,scale);
+    for(int scale = 0; scale < max_scale; scale++)
+    {
+      const float sigma = 1.0f;
+      const float varf = sqrtf(2.0f + 2.0f * 4.0f * 4.0f + 6.0f * 6.0f) / 16.0f; // about 0.5
+      const float sigma_band = powf(varf, scale) * sigma;
+      float DT_ALIGNED_PIXEL sum_y2[4];
+      float *const detail = cache ? cache->detail[scale] : buf;
+      decompose(buf2, buf1, detail, sum_y2, scale, 1.0f / (sigma_band * sigma_band), width, height);
+      debug_dump_PFM(piece,"/tmp/coarse_%d.pfm",buf2,width,height,scale);
+      debug_dump_PFM(piece,"/tmp/detail_%d.pfm",detail,width,height,scale);
+      if(cache) memcpy(cache->sum_y2[scale], sum_y2, sizeof(sum_y2));
 
-    const float DT_ALIGNED_PIXEL boost[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    float DT_ALIGNED_PIXEL thrs[4];
-    variance_stabilizing_xform(thrs, scale, max_scale, npixels, sum_y2, d);
-    synthesize(out, out, buf, thrs, boost, width, height);
+      const float DT_ALIGNED_PIXEL boost[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      float DT_ALIGNED_PIXEL thrs[4];
+      variance_stabilizing_xform(thrs, scale, max_scale, npixels, sum_y2, d);
+      synthesize(out, out, detail, thrs, boost, width, height);
 
-    float *buf3 = buf2;
-    buf2 = buf1;
-    buf1 = buf3;
-  }
+      float *buf3 = buf2;
+      buf2 = buf1;
+      buf1 = buf3;
+    }
 
-  // add in the final residue
+    // add in the final residue
 #ifdef _OPENMP
 #pragma omp simd aligned(buf1, out : 64)
 #endif
-  for (size_t k = 0; k < 4U * npixels; k++)
-    out[k] += buf1[k];
+    for (size_t k = 0; k < 4U * npixels; k++)
+      out[k] += buf1[k];
+
+    if(cache)
+    {
+      memcpy(cache->coarse, buf1, sizeof(float) * 4 * npixels);
+      cache->valid = TRUE;
+    }
+
+    dt_free_align(buf);
+    dt_free_align(tmp);
+    dt_free_align(precond);
+  }
 
   if(!d->use_new_vst)
   {
@@ -1356,10 +1510,6 @@ static void process_wavelets(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_
     backtransform_Y0U0V0(out, width, height, d->a[1] * compensate_p, p, d->b[1], d->bias - 0.5 * logf(in_scale), wb, toRGB);
   }
 
-  dt_free_align(buf);
-  dt_free_align(tmp);
-  dt_free_align(precond);
-
   if(piece->pipe->mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK) dt_iop_alpha_copy(ivoid, ovoid, width, height);
 
 #undef MAX_MAX_SCALE
@@ -2845,6 +2995,7 @@ void init_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pi
   dt_iop_denoiseprofile_params_t *default_params = (dt_iop_denoiseprofile_params_t *)self->default_params;
 
   piece->data = (void *)d;
+  d->wavelet_cache = NULL;
   for(int ch = 0; ch < DT_DENOISE_PROFILE_NONE; ch++)
   {
     d->curve[ch] = dt_draw_curve_new(0.0, 1.0, CATMULL_ROM);
@@ -2857,6 +3008,7 @@ void cleanup_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev
 {
   dt_iop_denoiseprofile_data_t *d = (dt_iop_denoiseprofile_data_t *)(piece->data);
   for(int ch = 0; ch < DT_DENOISE_PROFILE_NONE; ch++) dt_draw_curve_destroy(d->curve[ch]);
+  free_wavelet_cache(d->wavelet_cache);
   free(piece->data);
   piece->data = NULL;
 }
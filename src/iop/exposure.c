@@ -472,6 +472,31 @@ void process(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const
   for(int k = 0; k < 3; k++) piece->pipe->dsc.processed_maximum[k] *= d->scale;
 }
 
+void process_pointwise_setup(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece)
+{
+  const dt_iop_exposure_data_t *const d = (const dt_iop_exposure_data_t *const)piece->data;
+
+  process_common_setup(self, piece);
+
+  for(int k = 0; k < 3; k++) piece->pipe->dsc.processed_maximum[k] *= d->scale;
+}
+
+void process_pointwise(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, float *const pixels,
+                       const size_t npixels)
+{
+  const dt_iop_exposure_data_t *const d = (const dt_iop_exposure_data_t *const)piece->data;
+  const float black = d->black;
+  const float scale = d->scale;
+  float *const restrict px = pixels;
+#ifdef _OPENMP
+#pragma omp simd aligned(px : 64)
+#endif
+  for(size_t k = 0; k < 4 * npixels; k++)
+  {
+    px[k] = (px[k] - black) * scale;
+  }
+}
+
 
 static float get_exposure_bias(const struct dt_iop_module_t *self)
 {
@@ -186,6 +186,22 @@ REQUIRED(void, process, struct dt_iop_module_t *self, struct dt_dev_pixelpipe_io
 DEFAULT(void, process_tiling, struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t *piece, const void *const i,
                                void *const o, const struct dt_iop_roi_t *const roi_in,
                                const struct dt_iop_roi_t *const roi_out, const int bpp);
+/** a per-pixel variant of process() for modules which don't look at neighbouring pixels and don't change
+  * the roi. it works in place on npixels pixels of 4 floats in the module's input colorspace, may be called
+  * concurrently on different spans of the same buffer and must give the same result as process().
+  * the pipe uses it to run consecutive pointwise modules in one pass over the image. */
+OPTIONAL(void, process_pointwise, struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t *piece,
+                                  float *const pixels, const size_t npixels);
+/** called once per pipe run before process_pointwise(), does what process() does besides the pixels,
+  * for example updating piece->pipe->dsc.processed_maximum. */
+OPTIONAL(void, process_pointwise_setup, struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t *piece);
+/** for modules whose parameter changes are local, like retouching forms: given the parameters and forms of
+  * the last completed pipe run and the newly committed parameters and piece->pipe->forms, return TRUE and the
+  * bounding box (x, y, width, height in full image coordinates at the module's input) of all pixels of the
+  * output the change may touch, or FALSE if the change is global. the pipe then only recomputes that area. */
+OPTIONAL(gboolean, changed_area, struct dt_iop_module_t *self, struct dt_dev_pixelpipe_iop_t *piece,
+                                 const void *const old_params, const void *const new_params, GList *old_forms,
+                                 float area[4]);
 
 #if defined(__SSE__)
 /** a variant process(), that can contain SSE2 intrinsics. */
@@ -1894,6 +1894,39 @@ void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *params, dt_dev
   memcpy(piece->data, params, sizeof(dt_iop_retouch_params_t));
 }
 
+/** shapes only change the pixels below them, unless wavelet scales are involved. */
+gboolean changed_area(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const old_params,
+                      const void *const new_params, GList *old_forms, float area[4])
+{
+  const dt_iop_retouch_params_t *const o = (const dt_iop_retouch_params_t *)old_params;
+  const dt_iop_retouch_params_t *const n = (const dt_iop_retouch_params_t *)new_params;
+  const dt_develop_blend_params_t *const bp = (const dt_develop_blend_params_t *)piece->blendop_data;
+
+  // the decomposition spreads every change over the whole image, and the preview levels apply to it all
+  if(o->num_scales > 0 || n->num_scales > 0 || o->merge_from_scale != n->merge_from_scale
+     || memcmp(o->preview_levels, n->preview_levels, sizeof(o->preview_levels)))
+    return FALSE;
+
+  // shapes with other settings changed as well. heal solves over its whole destination with the pixels on its
+  // boundary, blur reads its whole destination box, so these change with anything below them
+  GList *changed = NULL, *reads_dest = NULL;
+  for(int k = 0; k < RETOUCH_NO_FORMS; k++)
+  {
+    const dt_iop_retouch_form_data_t *const of = &o->rt_forms[k], *const nf = &n->rt_forms[k];
+    if(nf->formid > 0 && (nf->algorithm == DT_IOP_RETOUCH_HEAL || nf->algorithm == DT_IOP_RETOUCH_BLUR))
+      reads_dest = g_list_prepend(reads_dest, GINT_TO_POINTER(nf->formid));
+    if(!memcmp(of, nf, sizeof(dt_iop_retouch_form_data_t))) continue;
+    if(of->formid > 0) changed = g_list_prepend(changed, GINT_TO_POINTER(of->formid));
+    if(nf->formid > 0) changed = g_list_prepend(changed, GINT_TO_POINTER(nf->formid));
+  }
+
+  const gboolean local = dt_masks_group_changed_area(self, piece, old_forms, piece->pipe->forms, bp->mask_id,
+                                                     changed, reads_dest, area);
+  g_list_free(changed);
+  g_list_free(reads_dest);
+  return local;
+}
+
 void init_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
 {
   piece->data = malloc(sizeof(dt_iop_retouch_data_t));
@@ -751,6 +751,29 @@ void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *params, dt_dev
   memcpy(piece->data, params, sizeof(dt_iop_spots_params_t));
 }
 
+/** a spot only changes the pixels below it, so does adding, moving or removing one. */
+gboolean changed_area(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const old_params,
+                      const void *const new_params, GList *old_forms, float area[4])
+{
+  const dt_iop_spots_params_t *const o = (const dt_iop_spots_params_t *)old_params;
+  const dt_iop_spots_params_t *const n = (const dt_iop_spots_params_t *)new_params;
+  const dt_develop_blend_params_t *const bp = (const dt_develop_blend_params_t *)piece->blendop_data;
+
+  // spots with another algorithm changed as well
+  GList *changed = NULL;
+  for(int k = 0; k < 64; k++)
+  {
+    if(o->clone_id[k] == n->clone_id[k] && o->clone_algo[k] == n->clone_algo[k]) continue;
+    if(o->clone_id[k] > 0) changed = g_list_prepend(changed, GINT_TO_POINTER(o->clone_id[k]));
+    if(n->clone_id[k] > 0) changed = g_list_prepend(changed, GINT_TO_POINTER(n->clone_id[k]));
+  }
+
+  const gboolean local
+      = dt_masks_group_changed_area(self, piece, old_forms, piece->pipe->forms, bp->mask_id, changed, NULL, area);
+  g_list_free(changed);
+  return local;
+}
+
 void init_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
 {
   piece->data = malloc(sizeof(dt_iop_spots_data_t));
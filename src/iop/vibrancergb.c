@@ -94,6 +94,23 @@ const char *description(struct dt_iop_module_t *self)
      _("linear, RGB, scene-referred"));
 }
 
+// in and out may be the same pixel
+static inline void _vibrance_pixel(const float vibrance, const float *const in, float *const out)
+{
+  const float average = (in[0] + in[1] + in[2]) / 3.0f;
+  const float delta = sqrtf((average - in[0]) * (average - in[0])
+                             + (average - in[1]) * (average - in[1])
+                             + (average - in[2]) * (average - in[2]));
+  const float P = vibrance * (1.0f - powf(delta, fabsf(vibrance)));
+
+  for(size_t c = 0; c < 3; c++)
+  {
+    out[c] = average + (1.0f + P) * (in[c] - average);
+  }
+
+  out[3] = in[3];
+}
+
 void process(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
              void *const ovoid, const dt_iop_roi_t *const roi_in, const dt_iop_roi_t *const roi_out)
 {
@@ -115,20 +132,17 @@ void process(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const
   schedule(static)
 #endif
   for(size_t k = 0; k < 4 * npixels; k += 4)
-  {
-    const float average = (in[k] + in[k + 1] + in[k + 2]) / 3.0f;
-    const float delta = sqrtf((average - in[k]) * (average - in[k])
-                               + (average - in[k + 1]) * (average - in[k + 1])
-                               + (average - in[k + 2]) * (average - in[k + 2]));
-    const float P = vibrance * (1.0f - powf(delta, fabsf(vibrance)));
-
-    for(size_t c = 0; c < 3; c++)
-    {
-      out[k + c] = average + (1.0f + P) * (in[k + c] - average);
-    }
-
-    out[k + 3] = in[k + 3];
-  }
+    _vibrance_pixel(vibrance, in + k, out + k);
+}
+
+void process_pointwise(struct dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, float *const pixels,
+                       const size_t npixels)
+{
+  const dt_iop_vibrancergb_data_t *const d = (dt_iop_vibrancergb_data_t *)piece->data;
+  const float vibrance = d->amount / 1.4f;
+
+  for(size_t k = 0; k < 4 * npixels; k += 4)
+    _vibrance_pixel(vibrance, pixels + k, pixels + k);
 }
 
 
@@ -0,0 +1,168 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2021 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// microbenchmark for the bilateral grid (common/bilateral.c).
+// runs splat, blur and slice on a synthetic Lab image for several sigma_s/sigma_r and compares the
+// output of the float and the half precision grid with the original pixel by pixel slicing.
+
+#include "common/bilateral.h"
+#include "common/darktable.h"
+#include "control/conf.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct bench_result_t
+{
+  double splat, blur, slice;
+} bench_result_t;
+
+static void fill_test_image(float *const img, const int width, const int height)
+{
+  // smooth gradients with some hard edges and a bit of noise, roughly like a real L channel
+  srand(42);
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      float *const px = img + (size_t)4 * (j * width + i);
+      const float edge = ((i / 97 + j / 61) & 1) ? 15.0f : -15.0f;
+      px[0] = 50.0f + 30.0f * sinf(i * 0.01f) * cosf(j * 0.013f) + edge + 5.0f * rand() / (float)RAND_MAX;
+      px[1] = 10.0f;
+      px[2] = -10.0f;
+      px[3] = 0.0f;
+    }
+}
+
+// the slicing as it was before it got vectorized: trilinear lookup of every pixel in the float grid
+static void reference_slice(const dt_bilateral_t *const b, const float *const in, float *const out,
+                            const float detail)
+{
+  const float norm = -detail * b->sigma_r * 0.04f;
+  const size_t ox = b->size_z;
+  const size_t oy = b->size_x * b->size_z;
+  const size_t oz = 1;
+  const float *const buf = b->buf;
+  for(int j = 0; j < b->height; j++)
+    for(int i = 0; i < b->width; i++)
+    {
+      const size_t index = (size_t)4 * (j * b->width + i);
+      const float L = in[index];
+      const float x = CLAMPS(i / b->sigma_s, 0, b->size_x - 1);
+      const float y = CLAMPS(j / b->sigma_s, 0, b->size_y - 1);
+      const float z = CLAMPS(L / b->sigma_r, 0, b->size_z - 1);
+      const int xi = MIN((int)x, (int)b->size_x - 2);
+      const int yi = MIN((int)y, (int)b->size_y - 2);
+      const int zi = MIN((int)z, (int)b->size_z - 2);
+      const float xf = x - xi, yf = y - yi, zf = z - zi;
+      const size_t gi = ((xi + yi * b->size_x) * b->size_z) + zi;
+      out[index] = L
+                   + norm * (buf[gi] * (1.0f - xf) * (1.0f - yf) * (1.0f - zf)
+                             + buf[gi + ox] * (xf) * (1.0f - yf) * (1.0f - zf)
+                             + buf[gi + oy] * (1.0f - xf) * (yf) * (1.0f - zf)
+                             + buf[gi + ox + oy] * (xf) * (yf) * (1.0f - zf)
+                             + buf[gi + oz] * (1.0f - xf) * (1.0f - yf) * (zf)
+                             + buf[gi + ox + oz] * (xf) * (1.0f - yf) * (zf)
+                             + buf[gi + oy + oz] * (1.0f - xf) * (yf) * (zf)
+                             + buf[gi + ox + oy + oz] * (xf) * (yf) * (zf));
+    }
+}
+
+static float max_diff(const float *const a, const float *const b, const int width, const int height)
+{
+  float diff = 0.0f;
+  for(size_t i = 0; i < (size_t)width * height; i++) diff = fmaxf(diff, fabsf(a[4 * i] - b[4 * i]));
+  return diff;
+}
+
+// ref receives the original slicing of the grid of the last run
+static void run(const float *const in, float *const out, float *const ref, const int width, const int height,
+                const float sigma_s, const float sigma_r, const int runs, bench_result_t *res)
+{
+  res->splat = res->blur = res->slice = 0.0;
+  for(int r = 0; r < runs; r++)
+  {
+    dt_bilateral_t *b = dt_bilateral_init(width, height, sigma_s, sigma_r);
+    const double t0 = dt_get_wtime();
+    dt_bilateral_splat(b, in);
+    const double t1 = dt_get_wtime();
+    dt_bilateral_blur(b);
+    const double t2 = dt_get_wtime();
+    dt_bilateral_slice(b, in, out, -1.0f);
+    const double t3 = dt_get_wtime();
+    res->splat += (t1 - t0) / runs;
+    res->blur += (t2 - t1) / runs;
+    res->slice += (t3 - t2) / runs;
+    if(r == runs - 1) reference_slice(b, in, ref, -1.0f);
+    dt_bilateral_free(b);
+  }
+}
+
+int main(int argc, char *arg[])
+{
+  char *argv[] = { "darktable-bench-bilateral", "--library", ":memory:", "--conf", "write_sidecar_files=FALSE", NULL };
+  int dt_argc = sizeof(argv) / sizeof(*argv) - 1;
+
+  // init dt without gui and without data.db:
+  if(dt_init(dt_argc, argv, FALSE, FALSE, NULL)) exit(1);
+
+  const int width = argc > 1 ? atoi(arg[1]) : 6000;
+  const int height = argc > 2 ? atoi(arg[2]) : 4000;
+  const int runs = MAX(1, argc > 3 ? atoi(arg[3]) : 3);
+
+  float *const in = dt_alloc_align_float((size_t)4 * width * height);
+  float *const out_float = dt_alloc_align_float((size_t)4 * width * height);
+  float *const out_half = dt_alloc_align_float((size_t)4 * width * height);
+  float *const ref = dt_alloc_align_float((size_t)4 * width * height);
+  if(!in || !out_float || !out_half || !ref) exit(1);
+  fill_test_image(in, width, height);
+
+  const float sigmas[][2] = { { 1.0f, 5.0f }, { 4.0f, 5.0f }, { 16.0f, 10.0f }, { 50.0f, 20.0f }, { 100.0f, 50.0f } };
+  const gboolean half_setting = dt_conf_get_bool("bilateral_half_precision_grid");
+
+  printf("%dx%d image, %d threads, average of %d runs\n", width, height, darktable.num_openmp_threads, runs);
+  printf("%8s %8s | %-26s | %-26s | %s\n", "sigma_s", "sigma_r", "float grid splat/blur/slice",
+         "half grid splat/blur/slice", "max diff to original float/half");
+  for(size_t k = 0; k < sizeof(sigmas) / sizeof(sigmas[0]); k++)
+  {
+    bench_result_t rf, rh;
+    dt_conf_set_bool("bilateral_half_precision_grid", FALSE);
+    run(in, out_float, ref, width, height, sigmas[k][0], sigmas[k][1], runs, &rf);
+    const float diff_float = max_diff(out_float, ref, width, height);
+    dt_conf_set_bool("bilateral_half_precision_grid", TRUE);
+    run(in, out_half, ref, width, height, sigmas[k][0], sigmas[k][1], runs, &rh);
+    const float diff_half = max_diff(out_half, ref, width, height);
+
+    printf("%8.1f %8.1f | %7.4fs %7.4fs %7.4fs | %7.4fs %7.4fs %7.4fs | %g / %g\n", sigmas[k][0], sigmas[k][1],
+           rf.splat, rf.blur, rf.slice, rh.splat, rh.blur, rh.slice, diff_float, diff_half);
+  }
+  dt_conf_set_bool("bilateral_half_precision_grid", half_setting);
+
+  dt_free_align(in);
+  dt_free_align(out_float);
+  dt_free_align(out_half);
+  dt_free_align(ref);
+
+  dt_cleanup();
+
+  return 0;
+}
+
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.sh
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
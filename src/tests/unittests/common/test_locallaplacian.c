@@ -0,0 +1,127 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2020 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for common/locallaplacian.c
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/darktable.h"
+#include "common/locallaplacian.h"
+
+/*
+ * DEFINITIONS
+ */
+
+// epsilon for floating point comparison of the L channel (in [0; 100]):
+#define E 1e-3f
+
+// large enough to span several tiles of the cache blocked code path:
+#define WIDTH 700
+#define HEIGHT 600
+
+/*
+ * TEST FUNCTIONS
+ */
+
+// deterministic Lab test image with gradients and fine detail everywhere,
+// so that every tile and every tile border has something to work on
+static float *gen_test_image(const int wd, const int ht)
+{
+  float *img = dt_alloc_align_float((size_t)4 * wd * ht);
+  for(int j = 0; j < ht; j++)
+    for(int i = 0; i < wd; i++)
+    {
+      float *p = img + (size_t)4 * (j * wd + i);
+      const float checker = ((i / 7 + j / 5) & 1) ? 10.0f : -10.0f;
+      p[0] = 50.0f + 30.0f * sinf(0.013f * i) * cosf(0.021f * j) + checker;
+      p[1] = 20.0f * sinf(0.05f * i);
+      p[2] = -20.0f * cosf(0.03f * j);
+      p[3] = 0.0f;
+    }
+  return img;
+}
+
+static void test_blocked_matches_unblocked(void **state)
+{
+  TR_STEP("verify that the cache blocked code path gives the same result as "
+    "processing the whole pyramids at once");
+  const int wd = WIDTH, ht = HEIGHT;
+  float *input = gen_test_image(wd, ht);
+  float *blocked = dt_alloc_align_float((size_t)4 * wd * ht);
+  float *whole = dt_alloc_align_float((size_t)4 * wd * ht);
+
+  for(int clarity = 0; clarity < 2; clarity++)
+  {
+    TR_DEBUG("clarity=%d", clarity);
+    const float detail = clarity ? 0.5f : 0.0f;
+
+    // no boundary: takes the cache blocked path
+    local_laplacian_internal(input, blocked, wd, ht, 0.2f, 0.5f, -0.5f,
+                             detail, 0, NULL);
+
+    // collecting the preview pyramid processes the whole image at once
+    local_laplacian_boundary_t b = { 0 };
+    b.mode = 1;
+    local_laplacian_internal(input, whole, wd, ht, 0.2f, 0.5f, -0.5f,
+                             detail, 0, &b);
+    local_laplacian_boundary_free(&b);
+
+    for(int j = 0; j < ht; j++)
+      for(int i = 0; i < wd; i++)
+      {
+        const size_t k = (size_t)4 * (j * wd + i);
+        if(fabsf(blocked[k] - whole[k]) > E)
+          TR_DEBUG("pixel=(%d, %d) blocked=%e whole=%e", i, j, blocked[k],
+                   whole[k]);
+        assert_float_equal(blocked[k], whole[k], E);
+        assert_float_equal(blocked[k+1], whole[k+1], E);
+        assert_float_equal(blocked[k+2], whole[k+2], E);
+      }
+  }
+
+  dt_free_align(input);
+  dt_free_align(blocked);
+  dt_free_align(whole);
+}
+
+
+/*
+ * MAIN FUNCTION
+ */
+int main()
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_blocked_matches_unblocked)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -35,20 +35,18 @@
 
 DT_MODULE(1)
 
+// the images around the current one are rendered ahead of time into a ring of slots.
+// the slot of an image is its rank modulo the ring size, so a step only retargets the
+// slot which falls out of the window on the other side.
+#define S_LOOKAHEAD_MAX 8
+#define S_SLOT_MAX (2 * S_LOOKAHEAD_MAX + 1)
+
 typedef enum dt_slideshow_event_t
 {
   S_REQUEST_STEP,
   S_REQUEST_STEP_BACK,
 } dt_slideshow_event_t;
 
-typedef enum dt_slideshow_slot_t
-{
-  S_LEFT      = 0,
-  S_CURRENT   = 1,
-  S_RIGHT     = 2,
-  S_SLOT_LAST = 3
-} dt_slideshow_slot_t;
-
 typedef struct _slideshow_buf_t
 {
   uint32_t *buf;
@@ -56,6 +54,7 @@ typedef struct _slideshow_buf_t
   uint32_t height;
   int32_t rank;
   gboolean invalidated;
+  gboolean processing; // a job is rendering this rank
 } dt_slideshow_buf_t;
 
 typedef struct dt_slideshow_t
@@ -63,17 +62,23 @@ typedef struct dt_slideshow_t
   int32_t col_count;
   uint32_t width, height;
 
-  // buffers
-  dt_slideshow_buf_t buf[S_SLOT_LAST];
-  gboolean init_phase;
+  // ring of buffers around the current image
+  dt_slideshow_buf_t buf[S_SLOT_MAX];
+  int32_t lookahead; // images rendered ahead in each direction
+  int32_t slots;     // 2 * lookahead + 1
+  int32_t current;   // rank of the image on screen
 
   // state machine stuff for image transitions:
   dt_pthread_mutex_t lock;
 
   gboolean auto_advance;
-  int exporting;
+  gboolean running;
+  int exporting; // jobs queued or running
   int delay;
 
+  // steps which found the new image ready or not
+  int hits, misses;
+
   // some magic to hide the mouse pointer
   guint mouse_timeout;
 } dt_slideshow_t;
@@ -120,43 +125,66 @@ static int write_image(dt_imageio_module_data_t *datai, const char *filename, co
   return 0;
 }
 
-static void shift_left(dt_slideshow_t *d)
+static inline dt_slideshow_buf_t *_slot(dt_slideshow_t *d, const int32_t rank)
 {
-  uint32_t *tmp_buf = d->buf[S_LEFT].buf;
+  return &d->buf[((rank % d->slots) + d->slots) % d->slots];
+}
 
-  for(int k=S_LEFT; k<S_RIGHT; k++)
+static inline gboolean _slot_pending(const dt_slideshow_t *d, const dt_slideshow_buf_t *slot)
+{
+  return slot->invalidated && !slot->processing && slot->rank >= 0 && slot->rank < d->col_count;
+}
+
+// point the slots to the window around the current image, called with the lock held.
+// this is also how work is cancelled after a jump: slots of images which left the window
+// are reused right away and a job still rendering an old rank drops its result.
+static void _ring_update(dt_slideshow_t *d)
+{
+  for(int k = -d->lookahead; k <= d->lookahead; k++)
   {
-    d->buf[k].buf         = d->buf[k+1].buf;
-    d->buf[k].rank        = d->buf[k+1].rank;
-    d->buf[k].width       = d->buf[k+1].width;
-    d->buf[k].height      = d->buf[k+1].height;
-    d->buf[k].invalidated = d->buf[k+1].invalidated;
+    const int32_t rank = d->current + k;
+    dt_slideshow_buf_t *slot = _slot(d, rank);
+    if(slot->rank != rank)
+    {
+      slot->rank = rank;
+      slot->invalidated = TRUE;
+      slot->processing = FALSE;
+    }
   }
-  d->buf[S_RIGHT].invalidated = TRUE;
-  d->buf[S_RIGHT].rank = d->buf[S_CURRENT].rank + 1;
-  d->buf[S_RIGHT].buf = tmp_buf;
 }
 
-static void shift_right(dt_slideshow_t *d)
+// the pending slot closest to the current image, looking forward first
+static dt_slideshow_buf_t *_next_pending(dt_slideshow_t *d)
 {
-  uint32_t *tmp_buf = d->buf[S_RIGHT].buf;
-
-  for(int k=S_RIGHT; k>S_LEFT; k--)
+  for(int k = 0; k <= d->lookahead; k++)
   {
-    d->buf[k].buf         = d->buf[k-1].buf;
-    d->buf[k].rank        = d->buf[k-1].rank;
-    d->buf[k].width       = d->buf[k-1].width;
-    d->buf[k].height      = d->buf[k-1].height;
-    d->buf[k].invalidated = d->buf[k-1].invalidated;
+    dt_slideshow_buf_t *slot = _slot(d, d->current + k);
+    if(_slot_pending(d, slot)) return slot;
+    slot = _slot(d, d->current - k);
+    if(_slot_pending(d, slot)) return slot;
   }
-  d->buf[S_LEFT].invalidated = TRUE;
-  d->buf[S_LEFT].rank = d->buf[S_CURRENT].rank - 1;
-  d->buf[S_LEFT].buf = tmp_buf;
+  return NULL;
+}
+
+// number of jobs rendering in parallel, each of them holds an image buffer of its own while it runs
+static inline int _max_jobs(const int32_t lookahead)
+{
+  return MIN(lookahead + 1, darktable.control->num_threads);
 }
 
-static void requeue_job(dt_slideshow_t *d)
+// start enough jobs to render the pending slots in parallel, called with the lock held
+static void _schedule(dt_slideshow_t *d)
 {
-  dt_control_add_job(darktable.control, DT_JOB_QUEUE_USER_BG, process_job_create(d));
+  int pending = 0;
+  for(int k = 0; k < d->slots; k++)
+    if(_slot_pending(d, &d->buf[k])) pending++;
+
+  const int max_jobs = _max_jobs(d->lookahead);
+  for(int k = d->exporting; d->running && k < MIN(pending, max_jobs); k++)
+  {
+    d->exporting++;
+    dt_control_add_job(darktable.control, DT_JOB_QUEUE_USER_BG, process_job_create(d));
+  }
 }
 
 static void _set_delay(dt_slideshow_t *d, int value)
@@ -165,7 +193,7 @@ static void _set_delay(dt_slideshow_t *d, int value)
   dt_conf_set_int("slideshow_delay", d->delay);
 }
 
-static int process_image(dt_slideshow_t *d, dt_slideshow_slot_t slot)
+static int process_image(dt_slideshow_t *d, const int32_t rank, const uint32_t width, const uint32_t height)
 {
   dt_imageio_module_format_t buf;
   buf.mime = mime;
@@ -173,38 +201,28 @@ static int process_image(dt_slideshow_t *d, dt_slideshow_slot_t slot)
   buf.bpp = bpp;
   buf.write_image = write_image;
 
-  // lock to copy the information to process the image
-  dt_pthread_mutex_lock(&d->lock);
   dt_slideshow_format_t dat;
-  dat.head.width = dat.head.max_width = d->width;
-  dat.head.height = dat.head.max_height = d->height;
+  dat.head.width = dat.head.max_width = width;
+  dat.head.height = dat.head.max_height = height;
   dat.head.style[0] = '\0';
-  dat.rank = d->buf[slot].rank;
-  dat.buf.buf = dt_alloc_align(64, sizeof(uint32_t) * d->width * d->height);
-
-  d->exporting++;
+  dat.rank = rank;
+  dat.buf.buf = dt_alloc_align(64, sizeof(uint32_t) * width * height);
+  dat.buf.invalidated = TRUE;
 
-  const int32_t rank = dat.rank;
   const gchar *query = dt_collection_get_query(darktable.collection);
 
-  if(rank<0 || rank>=d->col_count || !query)
-  {
-    d->exporting--;
-    dt_pthread_mutex_unlock(&d->lock);
-    goto error;
-  }
-
-  dt_pthread_mutex_unlock(&d->lock);
-
-  // get random image id from sql
+  // get image id from sql
   int32_t id = 0;
 
-  sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rank);
-  DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, 1);
-  if(sqlite3_step(stmt) == SQLITE_ROW) id = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
+  if(query && dat.buf.buf)
+  {
+    sqlite3_stmt *stmt;
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rank);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, 1);
+    if(sqlite3_step(stmt) == SQLITE_ROW) id = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
 
   // this is a little slow, might be worth to do an option:
   const gboolean high_quality = !dt_conf_get_bool("ui/performance");
@@ -215,42 +233,52 @@ static int process_image(dt_slideshow_t *d, dt_slideshow_slot_t slot)
     dt_imageio_export_with_flags(id, "unused", &buf, (dt_imageio_module_data_t *)&dat, TRUE, TRUE,
                                  high_quality, TRUE, FALSE, NULL, FALSE, FALSE, DT_COLORSPACE_DISPLAY,
                                  NULL, DT_INTENT_LAST, NULL, NULL, 1, 1, NULL);
+  }
 
-    // lock to copy back into the slot the rendered buffer, not that this is done only if
-    // the slot rank is still the same as the local buffer rank. This can be false if the
-    // buffers have been shifted to advance to next image.
-    dt_pthread_mutex_lock(&d->lock);
-    if(dat.rank == d->buf[slot].rank)
+  // hand the rendered buffer over to the slot, but only if the slot still waits for this rank.
+  // it has been retargeted if the window moved away from this image in the meantime.
+  dt_pthread_mutex_lock(&d->lock);
+  dt_slideshow_buf_t *slot = _slot(d, rank);
+  const gboolean wanted = slot->rank == rank && slot->processing;
+  if(wanted)
+  {
+    slot->processing = FALSE;
+    slot->invalidated = FALSE;
+    // the buffer still holds an image of an older rank, if the export failed the slot stays empty
+    dt_free_align(slot->buf);
+    slot->buf = NULL;
+    if(!dat.buf.invalidated)
     {
-      memcpy(d->buf[slot].buf, dat.buf.buf, sizeof(uint32_t) * dat.buf.width * dat.buf.height);
-      d->buf[slot].width = dat.buf.width;
-      d->buf[slot].height = dat.buf.height;
-      d->buf[slot].invalidated = FALSE;
+      slot->buf = dat.buf.buf;
+      slot->width = dat.buf.width;
+      slot->height = dat.buf.height;
+      dat.buf.buf = NULL;
     }
-    d->exporting--;
-    dt_pthread_mutex_unlock(&d->lock);
   }
+  const gboolean on_screen = wanted && rank == d->current;
+  dt_pthread_mutex_unlock(&d->lock);
 
   dt_free_align(dat.buf.buf);
-  return 0;
 
- error:
-  dt_free_align(dat.buf.buf);
-  return 1;
+  if(on_screen) dt_control_queue_redraw_center();
+
+  return id && wanted ? 0 : 1;
 }
 
-static gboolean _is_idle(dt_slideshow_t *d)
+static gboolean _next_ready(dt_slideshow_t *d)
 {
-  return !((d->buf[S_LEFT].invalidated && d->buf[S_LEFT].rank <= d->col_count)
-           || (d->buf[S_CURRENT].invalidated && d->buf[S_CURRENT].rank <= d->col_count)
-           || (d->buf[S_RIGHT].invalidated && d->buf[S_RIGHT].rank <= d->col_count));
+  dt_pthread_mutex_lock(&d->lock);
+  const dt_slideshow_buf_t *slot = _slot(d, d->current + 1);
+  const gboolean ready = !slot->invalidated || slot->rank >= d->col_count;
+  dt_pthread_mutex_unlock(&d->lock);
+  return ready;
 }
 
 static gboolean auto_advance(gpointer user_data)
 {
   dt_slideshow_t *d = (dt_slideshow_t *)user_data;
   if(!d->auto_advance) return FALSE;
-  if(!_is_idle(d)) return TRUE; // never try to advance if still exporting, but call me back again
+  if(!_next_ready(d)) return TRUE; // never try to advance if the next image is not there yet, call me back again
   _step_state(d, S_REQUEST_STEP);
   return FALSE;
 }
@@ -259,23 +287,25 @@ static int32_t process_job_run(dt_job_t *job)
 {
   dt_slideshow_t *d = dt_control_job_get_params(job);
 
-  if(d->buf[S_CURRENT].invalidated && d->buf[S_CURRENT].rank <= d->col_count)
-  {
-    process_image(d, S_CURRENT);
-    dt_control_queue_redraw_center();
-  }
-  else if(d->buf[S_RIGHT].invalidated && d->buf[S_RIGHT].rank <= d->col_count)
-  {
-    process_image(d, S_RIGHT);
-  }
-  else if(d->buf[S_LEFT].invalidated && d->buf[S_LEFT].rank >= 0)
+  // render pending slots, closest to the current image first, until there are none left
+  dt_pthread_mutex_lock(&d->lock);
+  while(d->running)
   {
-    process_image(d, S_LEFT);
-  }
+    dt_slideshow_buf_t *slot = _next_pending(d);
+    if(!slot) break;
+
+    slot->processing = TRUE;
+    const int32_t rank = slot->rank;
+    const uint32_t width = d->width;
+    const uint32_t height = d->height;
+    dt_pthread_mutex_unlock(&d->lock);
 
-  // any other slot to fill?
-  if(!_is_idle(d))
-    requeue_job(d);
+    process_image(d, rank, width, height);
+
+    dt_pthread_mutex_lock(&d->lock);
+  }
+  d->exporting--;
+  dt_pthread_mutex_unlock(&d->lock);
 
   return 0;
 }
@@ -290,10 +320,26 @@ static dt_job_t *process_job_create(dt_slideshow_t *d)
 
 static void _refresh_display(dt_slideshow_t *d)
 {
-  if(!d->buf[S_CURRENT].invalidated && d->buf[S_CURRENT].rank >= 0)
+  const dt_slideshow_buf_t *slot = _slot(d, d->current);
+  if(!slot->invalidated && slot->rank >= 0)
     dt_control_queue_redraw_center();
 }
 
+// move the window to the new current image, called with the lock held
+static void _move_to(dt_slideshow_t *d, const int32_t rank)
+{
+  d->current = rank;
+  _ring_update(d);
+
+  if(_slot(d, d->current)->invalidated)
+    d->misses++;
+  else
+    d->hits++;
+
+  _refresh_display(d);
+  _schedule(d);
+}
+
 // state machine stepping
 static void _step_state(dt_slideshow_t *d, dt_slideshow_event_t event)
 {
@@ -301,13 +347,9 @@ static void _step_state(dt_slideshow_t *d, dt_slideshow_event_t event)
 
   if(event == S_REQUEST_STEP)
   {
-    if(d->buf[S_CURRENT].rank < d->col_count - 1)
+    if(d->current < d->col_count - 1)
     {
-      shift_left(d);
-      d->buf[S_RIGHT].rank = d->buf[S_CURRENT].rank + 1;
-      d->buf[S_RIGHT].invalidated = d->buf[S_RIGHT].rank < d->col_count;
-      _refresh_display(d);
-      requeue_job(d);
+      _move_to(d, d->current + 1);
     }
     else
     {
@@ -317,13 +359,9 @@ static void _step_state(dt_slideshow_t *d, dt_slideshow_event_t event)
   }
   else if(event == S_REQUEST_STEP_BACK)
   {
-    if(d->buf[S_CURRENT].rank > 0)
+    if(d->current > 0)
     {
-      shift_right(d);
-      d->buf[S_LEFT].rank = d->buf[S_CURRENT].rank - 1;
-      d->buf[S_LEFT].invalidated = d->buf[S_LEFT].rank >= 0;
-      _refresh_display(d);
-      requeue_job(d);
+      _move_to(d, d->current - 1);
     }
     else
     {
@@ -385,6 +423,7 @@ void enter(dt_view_t *self)
   dt_control_change_cursor(GDK_BLANK_CURSOR);
   d->mouse_timeout = 0;
   d->exporting = 0;
+  d->hits = d->misses = 0;
 
   dt_ui_panel_show(darktable.gui->ui, DT_UI_PANEL_LEFT, FALSE, TRUE);
   dt_ui_panel_show(darktable.gui->ui, DT_UI_PANEL_RIGHT, FALSE, TRUE);
@@ -396,7 +435,7 @@ void enter(dt_view_t *self)
   // also hide arrows
   dt_control_queue_redraw();
 
-  // alloc screen-size double buffer
+  // render at screen size
   GtkWidget *window = dt_ui_main_window(darktable.gui->ui);
   GdkRectangle rect;
 
@@ -416,12 +455,22 @@ void enter(dt_view_t *self)
   d->width = rect.width * darktable.gui->ppd;
   d->height = rect.height * darktable.gui->ppd;
 
-  for(int k=S_LEFT; k<S_SLOT_LAST; k++)
+  // as many images ahead as requested, as long as the ring and the buffers of the jobs rendering into it fit
+  // into the memory budget
+  const size_t slot_size = sizeof(uint32_t) * d->width * d->height;
+  const size_t budget = (size_t)MAX(dt_conf_get_int("slideshow_lookahead_memory"), 0) << 20;
+  d->lookahead = CLAMP(dt_conf_get_int("slideshow_lookahead"), 1, S_LOOKAHEAD_MAX);
+  while(d->lookahead > 1 && (2 * d->lookahead + 1 + _max_jobs(d->lookahead)) * slot_size > budget)
+    d->lookahead--;
+  d->slots = 2 * d->lookahead + 1;
+
+  for(int k = 0; k < S_SLOT_MAX; k++)
   {
-    d->buf[k].buf = dt_alloc_align(64, sizeof(uint32_t) * d->width * d->height);
-    d->buf[k].width =  d->width;
-    d->buf[k].height = d->height;
+    d->buf[k].buf = NULL;
+    d->buf[k].width = d->buf[k].height = 0;
+    d->buf[k].rank = G_MININT;
     d->buf[k].invalidated = TRUE;
+    d->buf[k].processing = FALSE;
   }
 
   // if one selected start with it, otherwise start at the current lighttable offset
@@ -441,21 +490,21 @@ void enter(dt_view_t *self)
     sqlite3_finalize(stmt);
   }
 
-  d->buf[S_CURRENT].rank = selrank == -1 ? dt_thumbtable_get_offset(dt_ui_thumbtable(darktable.gui->ui)) : selrank;
-  d->buf[S_LEFT].rank = d->buf[S_CURRENT].rank - 1;
-  d->buf[S_RIGHT].rank = d->buf[S_CURRENT].rank + 1;
+  d->current = selrank == -1 ? dt_thumbtable_get_offset(dt_ui_thumbtable(darktable.gui->ui)) : selrank;
 
   d->col_count = dt_collection_get_count(darktable.collection);
 
   d->auto_advance = FALSE;
+  d->running = TRUE;
   d->delay = dt_conf_get_int("slideshow_delay");
-  // restart from beginning, will first increment counter by step and then prefetch
+
+  // start the jobs for the first window
+  _ring_update(d);
+  _schedule(d);
   dt_pthread_mutex_unlock(&d->lock);
 
   gtk_widget_grab_focus(dt_ui_center(darktable.gui->ui));
 
-  // start first job
-  dt_control_add_job(darktable.control, DT_JOB_QUEUE_USER_BG, process_job_create(d));
   dt_control_log(_("waiting to start slideshow"));
 }
 
@@ -468,15 +517,21 @@ void leave(dt_view_t *self)
   dt_control_change_cursor(GDK_LEFT_PTR);
   d->auto_advance = FALSE;
 
-  // exporting could be in action, just wait for the last to finish
-  // otherwise we will crash releasing lock and memory.
-  while(d->exporting > 0) sleep(1);
+  // queued jobs stop right away, but exporting could be in action, just wait for the last
+  // to finish otherwise we will crash releasing lock and memory.
+  dt_pthread_mutex_lock(&d->lock);
+  d->running = FALSE;
+  dt_pthread_mutex_unlock(&d->lock);
+  while(d->exporting > 0) g_usleep(10000);
+
+  dt_print(DT_DEBUG_PERF, "[slideshow] look-ahead of %d images: %d of %d steps found the image ready\n",
+           d->lookahead, d->hits, d->hits + d->misses);
 
-  dt_thumbtable_set_offset(dt_ui_thumbtable(darktable.gui->ui), d->buf[S_CURRENT].rank, FALSE);
+  dt_thumbtable_set_offset(dt_ui_thumbtable(darktable.gui->ui), d->current, FALSE);
 
   dt_pthread_mutex_lock(&d->lock);
 
-  for(int k=S_LEFT; k<S_SLOT_LAST; k++)
+  for(int k = 0; k < S_SLOT_MAX; k++)
   {
     dt_free_align(d->buf[k].buf);
     d->buf[k].buf = NULL;
@@ -492,9 +547,9 @@ void expose(dt_view_t *self, cairo_t *cr, int32_t width, int32_t height, int32_t
   dt_pthread_mutex_lock(&d->lock);
   cairo_paint(cr);
 
-  const dt_slideshow_buf_t *slot = &(d->buf[S_CURRENT]);
+  const dt_slideshow_buf_t *slot = _slot(d, d->current);
 
-  if(slot->buf && slot->rank >= 0 && !slot->invalidated)
+  if(slot->buf && slot->rank == d->current && slot->rank >= 0 && !slot->invalidated)
   {
     // cope with possible resize of the window
     const float tr_width = d->width < slot->width ? 0.f : (d->width - slot->width) * .5f / darktable.gui->ppd;
@@ -51,10 +51,153 @@
 
 #define DECORATION_SIZE_LIMIT 40
 
+// upper bound for the memory held by the surface cache of dt_view_image_get_surface
+#define DT_VIEW_SURFACE_CACHE_MAX_SIZE ((size_t)64 << 20)
+
+typedef struct dt_view_surface_cache_entry_t
+{
+  // everything the content of the surface depends on
+  int imgid;
+  int width, height;
+  dt_mipmap_size_t mip;
+  const uint8_t *buf; // the mipmap buffer the surface was made from
+  int buf_wd, buf_ht;
+  dt_colorspaces_color_profile_type_t color_space;
+  gboolean quality;
+  gboolean color_managed;
+  gboolean focus_peaking;
+  cairo_filter_t filter;
+  float ppd_thb;
+
+  cairo_surface_t *surface;
+  size_t size;
+} dt_view_surface_cache_entry_t;
+
 static void dt_view_manager_load_modules(dt_view_manager_t *vm);
 static int dt_view_load_module(void *v, const char *libname, const char *module_name);
 static void dt_view_unload_module(dt_view_t *view);
 
+static void _surface_cache_entry_free(gpointer data)
+{
+  dt_view_surface_cache_entry_t *e = (dt_view_surface_cache_entry_t *)data;
+  cairo_surface_destroy(e->surface);
+  free(e);
+}
+
+// drop all surfaces of imgid, or all of them for imgid <= 0
+static void _surface_cache_invalidate(dt_view_manager_t *vm, const int imgid)
+{
+  dt_pthread_mutex_lock(&vm->surface_cache.lock);
+  vm->surface_cache.generation++;
+  GList *iter = vm->surface_cache.entries;
+  while(iter)
+  {
+    GList *next = g_list_next(iter);
+    dt_view_surface_cache_entry_t *e = (dt_view_surface_cache_entry_t *)iter->data;
+    if(imgid <= 0 || e->imgid == imgid)
+    {
+      vm->surface_cache.size -= e->size;
+      _surface_cache_entry_free(e);
+      vm->surface_cache.entries = g_list_delete_link(vm->surface_cache.entries, iter);
+    }
+    iter = next;
+  }
+  dt_pthread_mutex_unlock(&vm->surface_cache.lock);
+}
+
+static void _surface_cache_mipmap_updated_callback(gpointer instance, int imgid, gpointer user_data)
+{
+  _surface_cache_invalidate((dt_view_manager_t *)user_data, imgid);
+}
+
+static void _surface_cache_profile_changed_callback(gpointer instance, gpointer user_data)
+{
+  _surface_cache_invalidate((dt_view_manager_t *)user_data, -1);
+}
+
+static void _surface_cache_profile_user_changed_callback(gpointer instance, uint8_t profile_type, gpointer user_data)
+{
+  if(profile_type == DT_COLORSPACES_PROFILE_TYPE_DISPLAY)
+    _surface_cache_invalidate((dt_view_manager_t *)user_data, -1);
+}
+
+static gboolean _surface_cache_entry_equal(const dt_view_surface_cache_entry_t *a,
+                                           const dt_view_surface_cache_entry_t *b)
+{
+  return a->imgid == b->imgid && a->width == b->width && a->height == b->height && a->mip == b->mip
+         && a->buf == b->buf && a->buf_wd == b->buf_wd && a->buf_ht == b->buf_ht
+         && a->color_space == b->color_space && a->quality == b->quality && a->color_managed == b->color_managed
+         && a->focus_peaking == b->focus_peaking && a->filter == b->filter && a->ppd_thb == b->ppd_thb;
+}
+
+// callers paint onto the surfaces they get (focus clusters, ...), so the cache only ever hands out copies
+static cairo_surface_t *_surface_copy(cairo_surface_t *src)
+{
+  const int wd = cairo_image_surface_get_width(src);
+  const int ht = cairo_image_surface_get_height(src);
+  cairo_surface_t *dst = cairo_image_surface_create(CAIRO_FORMAT_RGB24, wd, ht);
+  if(cairo_surface_status(dst) != CAIRO_STATUS_SUCCESS) return dst;
+  cairo_surface_flush(src);
+  cairo_surface_flush(dst);
+  memcpy(cairo_image_surface_get_data(dst), cairo_image_surface_get_data(src),
+         (size_t)cairo_image_surface_get_stride(src) * ht);
+  cairo_surface_mark_dirty(dst);
+  return dst;
+}
+
+static cairo_surface_t *_surface_cache_get(dt_view_manager_t *vm, const dt_view_surface_cache_entry_t *key,
+                                           uint32_t *generation)
+{
+  cairo_surface_t *surface = NULL;
+  dt_pthread_mutex_lock(&vm->surface_cache.lock);
+  *generation = vm->surface_cache.generation;
+  for(GList *iter = vm->surface_cache.entries; iter; iter = g_list_next(iter))
+  {
+    dt_view_surface_cache_entry_t *e = (dt_view_surface_cache_entry_t *)iter->data;
+    if(_surface_cache_entry_equal(e, key))
+    {
+      vm->surface_cache.entries = g_list_remove_link(vm->surface_cache.entries, iter);
+      vm->surface_cache.entries = g_list_concat(iter, vm->surface_cache.entries);
+      surface = _surface_copy(e->surface);
+      break;
+    }
+  }
+  dt_pthread_mutex_unlock(&vm->surface_cache.lock);
+  return surface;
+}
+
+static void _surface_cache_put(dt_view_manager_t *vm, const dt_view_surface_cache_entry_t *key,
+                               const uint32_t generation, cairo_surface_t *surface)
+{
+  const size_t size = (size_t)cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+  if(size > DT_VIEW_SURFACE_CACHE_MAX_SIZE / 4) return;
+
+  dt_pthread_mutex_lock(&vm->surface_cache.lock);
+  // an invalidation came in while the surface was built, it might already be outdated
+  if(generation != vm->surface_cache.generation)
+  {
+    dt_pthread_mutex_unlock(&vm->surface_cache.lock);
+    return;
+  }
+
+  dt_view_surface_cache_entry_t *e = (dt_view_surface_cache_entry_t *)malloc(sizeof(dt_view_surface_cache_entry_t));
+  *e = *key;
+  e->surface = _surface_copy(surface);
+  e->size = size;
+  vm->surface_cache.entries = g_list_prepend(vm->surface_cache.entries, e);
+  vm->surface_cache.size += size;
+
+  while(vm->surface_cache.size > DT_VIEW_SURFACE_CACHE_MAX_SIZE)
+  {
+    GList *last = g_list_last(vm->surface_cache.entries);
+    dt_view_surface_cache_entry_t *old = (dt_view_surface_cache_entry_t *)last->data;
+    vm->surface_cache.size -= old->size;
+    _surface_cache_entry_free(old);
+    vm->surface_cache.entries = g_list_delete_link(vm->surface_cache.entries, last);
+  }
+  dt_pthread_mutex_unlock(&vm->surface_cache.lock);
+}
+
 void dt_view_manager_init(dt_view_manager_t *vm)
 {
   /* prepare statements */
@@ -89,6 +232,17 @@ void dt_view_manager_init(dt_view_manager_t *vm)
 
   vm->current_view = NULL;
   vm->audio.audio_player_id = -1;
+
+  vm->surface_cache.entries = NULL;
+  vm->surface_cache.size = 0;
+  vm->surface_cache.generation = 0;
+  dt_pthread_mutex_init(&vm->surface_cache.lock, NULL);
+  DT_DEBUG_CONTROL_SIGNAL_CONNECT(darktable.signals, DT_SIGNAL_DEVELOP_MIPMAP_UPDATED,
+                            G_CALLBACK(_surface_cache_mipmap_updated_callback), vm);
+  DT_DEBUG_CONTROL_SIGNAL_CONNECT(darktable.signals, DT_SIGNAL_CONTROL_PROFILE_CHANGED,
+                            G_CALLBACK(_surface_cache_profile_changed_callback), vm);
+  DT_DEBUG_CONTROL_SIGNAL_CONNECT(darktable.signals, DT_SIGNAL_CONTROL_PROFILE_USER_CHANGED,
+                            G_CALLBACK(_surface_cache_profile_user_changed_callback), vm);
 }
 
 void dt_view_manager_gui_init(dt_view_manager_t *vm)
@@ -105,6 +259,15 @@ void dt_view_manager_cleanup(dt_view_manager_t *vm)
   for(GList *iter = vm->views; iter; iter = g_list_next(iter)) dt_view_unload_module((dt_view_t *)iter->data);
   g_list_free_full(vm->views, free);
   vm->views = NULL;
+
+  DT_DEBUG_CONTROL_SIGNAL_DISCONNECT(darktable.signals, G_CALLBACK(_surface_cache_mipmap_updated_callback), vm);
+  DT_DEBUG_CONTROL_SIGNAL_DISCONNECT(darktable.signals, G_CALLBACK(_surface_cache_profile_changed_callback), vm);
+  DT_DEBUG_CONTROL_SIGNAL_DISCONNECT(darktable.signals, G_CALLBACK(_surface_cache_profile_user_changed_callback),
+                                     vm);
+  g_list_free_full(vm->surface_cache.entries, _surface_cache_entry_free);
+  vm->surface_cache.entries = NULL;
+  vm->surface_cache.size = 0;
+  dt_pthread_mutex_destroy(&vm->surface_cache.lock);
 }
 
 const dt_view_t *dt_view_manager_get_current_view(dt_view_manager_t *vm)
@@ -1018,6 +1181,38 @@ dt_view_surface_value_t dt_view_image_get_surface(int imgid, int width, int heig
     return DT_VIEW_SURFACE_KO;
   }
 
+  // if we already painted this very buffer the same way, hand out a copy of that surface.
+  // skulls and smaller mips will be replaced soon anyway, so they are not worth keeping
+  const gboolean color_managed = dt_conf_get_bool("cache_color_managed");
+  const dt_view_surface_cache_entry_t key = { .imgid = imgid,
+                                              .width = width,
+                                              .height = height,
+                                              .mip = mip,
+                                              .buf = buf.buf,
+                                              .buf_wd = buf_wd,
+                                              .buf_ht = buf_ht,
+                                              .color_space = buf.color_space,
+                                              .quality = quality,
+                                              .color_managed = color_managed,
+                                              .focus_peaking = darktable.gui->show_focus_peaking,
+                                              .filter = darktable.gui->filter_image,
+                                              .ppd_thb = darktable.gui->ppd_thb };
+  const gboolean cacheable = mip == buf.size && !(buf_wd <= 8 && buf_ht <= 8);
+  uint32_t generation = 0;
+  if(cacheable)
+  {
+    *surface = _surface_cache_get(darktable.view_manager, &key, &generation);
+    if(*surface)
+    {
+      dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
+      if((darktable.unmuted & (DT_DEBUG_LIGHTTABLE | DT_DEBUG_PERF)) == (DT_DEBUG_LIGHTTABLE | DT_DEBUG_PERF))
+        dt_print(DT_DEBUG_LIGHTTABLE | DT_DEBUG_PERF,
+                 "[dt_view_image_get_surface]  id %i, dots %ix%i, mip %ix%i, surf from cache in %0.04f sec\n",
+                 imgid, width, height, buf_wd, buf_ht, dt_get_wtime() - tt);
+      return DT_VIEW_SURFACE_OK;
+    }
+  }
+
   // so we create a new image surface to return
   const float scale = fminf(width / (float)buf_wd, height / (float)buf_ht) * darktable.gui->ppd_thb;
   const int img_width = buf_wd * scale;
@@ -1031,8 +1226,9 @@ dt_view_surface_value_t dt_view_image_get_surface(int imgid, int width, int heig
   {
     gboolean have_lock = FALSE;
     cmsHTRANSFORM transform = NULL;
+    const dt_colorspaces_display_lut_t *lut = NULL;
 
-    if(dt_conf_get_bool("cache_color_managed"))
+    if(color_managed)
     {
       pthread_rwlock_rdlock(&darktable.color_profiles->xprofile_lock);
       have_lock = TRUE;
@@ -1043,11 +1239,13 @@ dt_view_surface_value_t dt_view_image_get_surface(int imgid, int width, int heig
          && darktable.color_profiles->transform_srgb_to_display)
       {
         transform = darktable.color_profiles->transform_srgb_to_display;
+        lut = darktable.color_profiles->lut_srgb_to_display;
       }
       else if(buf.color_space == DT_COLORSPACE_ADOBERGB
               && darktable.color_profiles->transform_adobe_rgb_to_display)
       {
         transform = darktable.color_profiles->transform_adobe_rgb_to_display;
+        lut = darktable.color_profiles->lut_adobe_rgb_to_display;
       }
       else
       {
@@ -1067,14 +1265,18 @@ dt_view_surface_value_t dt_view_image_get_surface(int imgid, int width, int heig
     }
 
 #ifdef _OPENMP
-#pragma omp parallel for schedule(static) default(none) shared(buf, rgbbuf, transform)
+#pragma omp parallel for schedule(static) default(none) shared(buf, rgbbuf, transform, lut)
 #endif
     for(int i = 0; i < buf.height; i++)
     {
       const uint8_t *in = buf.buf + i * buf.width * 4;
       uint8_t *out = rgbbuf + i * buf.width * 4;
 
-      if(transform)
+      if(lut)
+      {
+        dt_colorspaces_display_lut_apply(lut, in, out, buf.width);
+      }
+      else if(transform)
       {
         cmsDoTransform(transform, in, out, buf.width);
       }
@@ -1139,6 +1341,8 @@ dt_view_surface_value_t dt_view_image_get_surface(int imgid, int width, int heig
   else
     ret = DT_VIEW_SURFACE_OK;
 
+  if(cacheable && rgbbuf) _surface_cache_put(darktable.view_manager, &key, generation, *surface);
+
   dt_mipmap_cache_release(darktable.mipmap_cache, &buf);
   if(rgbbuf) free(rgbbuf);
 
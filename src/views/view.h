@@ -234,6 +234,15 @@ typedef struct dt_view_manager_t
     sqlite3_stmt *get_grouped;
   } statements;
 
+  // small lru of ready-to-paint surfaces handed out by dt_view_image_get_surface
+  struct
+  {
+    GList *entries;      // most recently used first
+    size_t size;         // bytes held by the surfaces in the list
+    uint32_t generation; // bumped on every invalidation
+    dt_pthread_mutex_t lock;
+  } surface_cache;
+
   struct
   {
     GPid audio_player_pid;   // the pid of the child process